@@ -0,0 +1,391 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Throughput benchmark of vspmfilter, run by "make bench".
+ *
+ * Every input x output format pair of the vspmfilter pad templates is
+ * converted at each resolution, in each allocation mode, by 1 to N
+ * pipelines running at the same time:
+ *
+ *   videotestsrc ! video/x-raw,format=IN,WxH ! vspmfilter ! format=OUT ! fakesink
+ *
+ * One JSON object is printed per run. The frame latency is measured
+ * between the sink and src pads of vspmfilter. The CPU time is the one of
+ * the whole process, including videotestsrc */
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+  GstElement *pipeline;
+  GstElement *filter;
+  GHashTable *pending;    /* PTS -> sink pad time */
+  GArray *latency;        /* gint64, microseconds */
+  GMutex lock;
+} BenchPipeline;
+
+typedef struct {
+  const gchar *name;
+  gboolean outbuf_alloc;
+  gboolean dmabuf_use;
+} BenchMode;
+
+static const BenchMode bench_modes[] = {
+  { "default", FALSE, FALSE },
+  { "outbuf", TRUE, FALSE },
+  { "dmabuf", TRUE, TRUE },
+};
+
+static gint frames = 100;
+static gchar *formats_in = NULL;
+static gchar *formats_out = NULL;
+static gchar *resolutions = (gchar *) "320x240,640x480,1280x720,1920x1080,3840x2160";
+static gchar *modes = (gchar *) "default,outbuf,dmabuf";
+static gint max_pipelines = 4;
+
+static GOptionEntry entries[] = {
+  { "frames", 'n', 0, G_OPTION_ARG_INT, &frames,
+      "Frames per pipeline and run (default 100)", "N" },
+  { "in", 0, 0, G_OPTION_ARG_STRING, &formats_in,
+      "Comma separated input formats (default all)", "FORMATS" },
+  { "out", 0, 0, G_OPTION_ARG_STRING, &formats_out,
+      "Comma separated output formats (default all)", "FORMATS" },
+  { "resolutions", 'r', 0, G_OPTION_ARG_STRING, &resolutions,
+      "Comma separated WxH (default QVGA to 4K)", "LIST" },
+  { "modes", 'm', 0, G_OPTION_ARG_STRING, &modes,
+      "Comma separated default, outbuf, dmabuf (default all)", "LIST" },
+  { "pipelines", 'p', 0, G_OPTION_ARG_INT, &max_pipelines,
+      "Run with 1, 2, 4... up to N concurrent pipelines (default 4)", "N" },
+  { NULL }
+};
+
+static gint64
+bench_cpu_time (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return (gint64) ts.tv_sec * G_USEC_PER_SEC + ts.tv_nsec / 1000;
+}
+
+static GstPadProbeReturn
+bench_sink_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BenchPipeline *bp = user_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  gint64 *start = g_new (gint64, 1);
+
+  *start = g_get_monotonic_time ();
+  g_mutex_lock (&bp->lock);
+  g_hash_table_insert (bp->pending, GSIZE_TO_POINTER (GST_BUFFER_PTS (buf)),
+      start);
+  g_mutex_unlock (&bp->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GstPadProbeReturn
+bench_src_probe (GstPad * pad, GstPadProbeInfo * info, gpointer user_data)
+{
+  BenchPipeline *bp = user_data;
+  GstBuffer *buf = GST_PAD_PROBE_INFO_BUFFER (info);
+  gint64 *start, latency;
+
+  g_mutex_lock (&bp->lock);
+  start = g_hash_table_lookup (bp->pending,
+      GSIZE_TO_POINTER (GST_BUFFER_PTS (buf)));
+  if (start) {
+    latency = g_get_monotonic_time () - *start;
+    g_array_append_val (bp->latency, latency);
+    g_hash_table_remove (bp->pending, GSIZE_TO_POINTER (GST_BUFFER_PTS (buf)));
+  }
+  g_mutex_unlock (&bp->lock);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+bench_pipeline_init (BenchPipeline * bp, const gchar * in, const gchar * out,
+    gint width, gint height, const BenchMode * mode)
+{
+  gchar *desc;
+  GstPad *pad;
+  GError *err = NULL;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d ! "
+      "video/x-raw,format=%s,width=%d,height=%d,framerate=30/1 ! "
+      "vspmfilter name=f outbuf-alloc=%d dmabuf-use=%d ! "
+      "video/x-raw,format=%s ! fakesink sync=false",
+      frames, in, width, height, mode->outbuf_alloc, mode->dmabuf_use, out);
+  bp->pipeline = gst_parse_launch (desc, &err);
+  g_free (desc);
+  if (bp->pipeline == NULL) {
+    g_printerr ("%s\n", err ? err->message : "could not build the pipeline");
+    g_clear_error (&err);
+    return FALSE;
+  }
+
+  bp->filter = gst_bin_get_by_name (GST_BIN (bp->pipeline), "f");
+  bp->pending = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+  bp->latency = g_array_new (FALSE, FALSE, sizeof (gint64));
+  g_mutex_init (&bp->lock);
+
+  pad = gst_element_get_static_pad (bp->filter, "sink");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, bench_sink_probe, bp,
+      NULL);
+  gst_object_unref (pad);
+  pad = gst_element_get_static_pad (bp->filter, "src");
+  gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, bench_src_probe, bp,
+      NULL);
+  gst_object_unref (pad);
+
+  return TRUE;
+}
+
+static void
+bench_pipeline_clear (BenchPipeline * bp)
+{
+  if (bp->pipeline == NULL)
+    return;
+  gst_element_set_state (bp->pipeline, GST_STATE_NULL);
+  gst_object_unref (bp->filter);
+  gst_object_unref (bp->pipeline);
+  g_hash_table_unref (bp->pending);
+  g_array_unref (bp->latency);
+  g_mutex_clear (&bp->lock);
+  bp->pipeline = NULL;
+}
+
+static gint
+bench_compare (gconstpointer a, gconstpointer b)
+{
+  gint64 x = *(const gint64 *) a, y = *(const gint64 *) b;
+
+  return (x > y) - (x < y);
+}
+
+static gint64
+bench_percentile (GArray * sorted, gdouble p)
+{
+  guint i;
+
+  if (sorted->len == 0)
+    return -1;
+  i = (guint) (p * (sorted->len - 1) + 0.5);
+  return g_array_index (sorted, gint64, i);
+}
+
+/* Run n pipelines at the same time and print the result of the run */
+static void
+bench_run (const gchar * in, const gchar * out, gint width, gint height,
+    const BenchMode * mode, gint n)
+{
+  BenchPipeline *bp = g_new0 (BenchPipeline, n);
+  GArray *latency = g_array_new (FALSE, FALSE, sizeof (gint64));
+  const gchar *status = "ok";
+  gchar *error = NULL;
+  gint64 wall, cpu;
+  guint64 cma_bytes = 0;
+  guint done = 0;
+  gint i;
+
+  for (i = 0; i < n; i++) {
+    if (!bench_pipeline_init (&bp[i], in, out, width, height, mode)) {
+      status = "error";
+      goto print;
+    }
+  }
+
+  wall = g_get_monotonic_time ();
+  cpu = bench_cpu_time ();
+  for (i = 0; i < n; i++)
+    gst_element_set_state (bp[i].pipeline, GST_STATE_PLAYING);
+
+  for (i = 0; i < n; i++) {
+    GstBus *bus = gst_element_get_bus (bp[i].pipeline);
+    GstMessage *msg;
+
+    msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+        GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+    if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+      GError *err = NULL;
+
+      gst_message_parse_error (msg, &err, NULL);
+      if (error == NULL)
+        error = g_strdup (err->message);
+      g_clear_error (&err);
+      status = "error";
+    }
+    gst_message_unref (msg);
+    gst_object_unref (bus);
+  }
+  wall = g_get_monotonic_time () - wall;
+  cpu = bench_cpu_time () - cpu;
+
+  /* the pools still hold their buffers until the pipelines stop */
+  {
+    GstStructure *stats = NULL;
+
+    g_object_get (bp[0].filter, "stats", &stats, NULL);
+    if (stats) {
+      gst_structure_get_uint64 (stats, "cma-bytes", &cma_bytes);
+      gst_structure_free (stats);
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    g_array_append_vals (latency, bp[i].latency->data, bp[i].latency->len);
+    done += bp[i].latency->len;
+  }
+  g_array_sort (latency, bench_compare);
+
+print:
+  g_print ("{\"in\":\"%s\",\"out\":\"%s\",\"width\":%d,\"height\":%d,"
+      "\"mode\":\"%s\",\"pipelines\":%d,\"frames\":%u,\"status\":\"%s\"",
+      in, out, width, height, mode->name, n, done, status);
+  if (error) {
+    gchar *escaped = g_strescape (error, NULL);
+
+    g_print (",\"error\":\"%s\"", escaped);
+    g_free (escaped);
+  }
+  if (done > 0) {
+    g_print (",\"fps\":%.2f,\"cpu_us_per_frame\":%.1f,"
+        "\"latency_us\":{\"p50\":%" G_GINT64_FORMAT ",\"p90\":%"
+        G_GINT64_FORMAT ",\"p99\":%" G_GINT64_FORMAT ",\"max\":%"
+        G_GINT64_FORMAT "},\"cma_bytes\":%" G_GUINT64_FORMAT,
+        done * (gdouble) G_USEC_PER_SEC / wall, (gdouble) cpu / done,
+        bench_percentile (latency, 0.50), bench_percentile (latency, 0.90),
+        bench_percentile (latency, 0.99), bench_percentile (latency, 1.0),
+        cma_bytes);
+  }
+  g_print ("}\n");
+
+  for (i = 0; i < n; i++)
+    bench_pipeline_clear (&bp[i]);
+  g_free (bp);
+  g_array_unref (latency);
+  g_free (error);
+}
+
+/* The formats of a pad template of vspmfilter, or the ones asked for */
+static gchar **
+bench_formats (GstElementFactory * factory, GstPadDirection direction,
+    const gchar * wanted)
+{
+  const GList *l;
+  GPtrArray *list;
+
+  if (wanted)
+    return g_strsplit (wanted, ",", -1);
+
+  list = g_ptr_array_new ();
+  for (l = gst_element_factory_get_static_pad_templates (factory); l;
+      l = l->next) {
+    GstStaticPadTemplate *templ = l->data;
+    GstCaps *caps;
+    guint i, j;
+
+    if (templ->direction != direction)
+      continue;
+    caps = gst_static_caps_get (&templ->static_caps);
+    for (i = 0; i < gst_caps_get_size (caps); i++) {
+      const GValue *v = gst_structure_get_value (gst_caps_get_structure (caps,
+              i), "format");
+
+      if (v && GST_VALUE_HOLDS_LIST (v)) {
+        for (j = 0; j < gst_value_list_get_size (v); j++)
+          g_ptr_array_add (list, g_value_dup_string (gst_value_list_get_value
+                  (v, j)));
+      } else if (v && G_VALUE_HOLDS_STRING (v)) {
+        g_ptr_array_add (list, g_value_dup_string (v));
+      }
+    }
+    gst_caps_unref (caps);
+  }
+  g_ptr_array_add (list, NULL);
+
+  return (gchar **) g_ptr_array_free (list, FALSE);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstElementFactory *factory;
+  gchar **in, **out, **res, **mode;
+  guint i, j, k, m;
+  gint n;
+
+  ctx = g_option_context_new ("- vspmfilter benchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  factory = gst_element_factory_find ("vspmfilter");
+  if (factory == NULL) {
+    g_printerr ("vspmfilter not found, check GST_PLUGIN_PATH\n");
+    return 1;
+  }
+
+  in = bench_formats (factory, GST_PAD_SINK, formats_in);
+  out = bench_formats (factory, GST_PAD_SRC, formats_out);
+  res = g_strsplit (resolutions, ",", -1);
+  mode = g_strsplit (modes, ",", -1);
+
+  for (i = 0; in[i]; i++) {
+    for (j = 0; out[j]; j++) {
+      for (k = 0; res[k]; k++) {
+        gint width, height;
+
+        if (sscanf (res[k], "%dx%d", &width, &height) != 2)
+          continue;
+        for (m = 0; mode[m]; m++) {
+          const BenchMode *bm = NULL;
+          guint b;
+
+          for (b = 0; b < G_N_ELEMENTS (bench_modes); b++)
+            if (!strcmp (mode[m], bench_modes[b].name))
+              bm = &bench_modes[b];
+          if (bm == NULL)
+            continue;
+          for (n = 1; n <= max_pipelines; n *= 2)
+            bench_run (in[i], out[j], width, height, bm, n);
+        }
+      }
+    }
+  }
+
+  g_strfreev (in);
+  g_strfreev (out);
+  g_strfreev (res);
+  g_strfreev (mode);
+  gst_object_unref (factory);
+
+  return 0;
+}
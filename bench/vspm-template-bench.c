@@ -0,0 +1,180 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* CPU cost of the per-frame job setup of vspmfilter, run by
+ * "make bench-template".
+ *
+ * For each conversion, building the VSP job parameters of a frame (what
+ * every frame did before the job template) is timed against matching the
+ * template and patching the plane addresses in (what a frame does now).
+ * Nothing is queued to the hardware. One JSON object is printed per
+ * conversion.
+ *
+ * The element source is included for its static functions */
+
+#include "../gstvspmfilter.c"
+
+#include <time.h>
+
+typedef struct {
+  GstVideoFormat in_format;
+  gint in_width, in_height;
+  GstVideoFormat out_format;
+  gint out_width, out_height;
+  gboolean borders;
+  gboolean split_frame;
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+  { GST_VIDEO_FORMAT_NV12, 1920, 1080, GST_VIDEO_FORMAT_BGRA, 1920, 1080 },
+  { GST_VIDEO_FORMAT_NV12, 1920, 1080, GST_VIDEO_FORMAT_NV12, 1280, 720 },
+  { GST_VIDEO_FORMAT_YUY2, 1280, 720, GST_VIDEO_FORMAT_RGB, 1920, 1200,
+      TRUE },
+  { GST_VIDEO_FORMAT_NV12, 3840, 2160, GST_VIDEO_FORMAT_BGRA, 1920, 1080,
+      FALSE, TRUE },
+  { GST_VIDEO_FORMAT_I420, 7680, 64, GST_VIDEO_FORMAT_NV12, 3000, 32 },
+};
+
+static gint iterations = 200000;
+
+static GOptionEntry entries[] = {
+  { "iterations", 'n', 0, G_OPTION_ARG_INT, &iterations,
+      "Frames timed per conversion and path (default 200000)", "N" },
+  { NULL }
+};
+
+static gint64
+bench_time_ns (void)
+{
+  struct timespec ts;
+
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+  return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void
+bench_case (GstVspmFilter * space, const BenchCase * c)
+{
+  GstVspmFilterJobTemplate *tmpl;
+  GstVideoInfo in_info, out_info;
+  GstVideoFrame in_frame, out_frame;
+  GstBuffer *inbuf, *outbuf;
+  guint8 *src_addr[3] = { (guint8 *) 0x10000000, (guint8 *) 0x11000000,
+    (guint8 *) 0x12000000 };
+  guint8 *dst_addr[3] = { (guint8 *) 0x20000000, (guint8 *) 0x21000000,
+    (guint8 *) 0x22000000 };
+  gsize frame = 0;
+  gint dst_x = 0, dst_y = 0, dst_width, dst_height;
+  gint64 start, build_ns, patch_ns;
+  guint n_stripes;
+  gint i;
+
+  gst_video_info_set_format (&in_info, c->in_format, c->in_width,
+      c->in_height);
+  gst_video_info_set_format (&out_info, c->out_format, c->out_width,
+      c->out_height);
+  inbuf = gst_buffer_new_allocate (NULL, in_info.size, NULL);
+  outbuf = gst_buffer_new_allocate (NULL, out_info.size, NULL);
+  gst_video_frame_map (&in_frame, &in_info, inbuf, GST_MAP_READ);
+  gst_video_frame_map (&out_frame, &out_info, outbuf, GST_MAP_WRITE);
+
+  space->split_frame = c->split_frame;
+  dst_width = c->out_width;
+  dst_height = c->out_height;
+  if (c->borders)
+    gst_vspm_filter_get_borders (&in_frame, c->in_width, c->in_height,
+        &out_frame, &dst_x, &dst_y, &dst_width, &dst_height);
+
+  tmpl = g_new0 (GstVspmFilterJobTemplate, 1);
+
+  /* every frame building its parameters */
+  start = bench_time_ns ();
+  for (i = 0; i < iterations; i++)
+    gst_vspm_filter_build_job_template (space, tmpl, &in_frame, &out_frame,
+        0, 0, c->in_width, c->in_height, dst_x, dst_y, dst_width,
+        dst_height);
+  build_ns = bench_time_ns () - start;
+  n_stripes = tmpl->n_stripes;
+
+  /* every frame matching the template and patching its addresses */
+  start = bench_time_ns ();
+  for (i = 0; i < iterations; i++) {
+    if (!gst_vspm_filter_job_template_matches (space, tmpl, &in_frame,
+            &out_frame, 0, 0, c->in_width, c->in_height, dst_x, dst_y,
+            dst_width, dst_height))
+      gst_vspm_filter_build_job_template (space, tmpl, &in_frame,
+          &out_frame, 0, 0, c->in_width, c->in_height, dst_x, dst_y,
+          dst_width, dst_height);
+    /* a new frame from the pools every time */
+    tmpl->src_par.addr     = src_addr[0] + frame;
+    tmpl->src_par.addr_c0  = src_addr[1] + frame;
+    tmpl->src_par.addr_c1  = src_addr[2] + frame;
+    tmpl->dst_par.addr     = dst_addr[0] + frame;
+    tmpl->dst_par.addr_c0  = dst_addr[1] + frame;
+    tmpl->dst_par.addr_c1  = dst_addr[2] + frame;
+    frame = (frame + 0x100000) & 0xf00000;
+  }
+  patch_ns = bench_time_ns () - start;
+
+  printf ("{\"in\": \"%s\", \"in-size\": \"%dx%d\", \"out\": \"%s\", "
+      "\"out-size\": \"%dx%d\", \"borders\": %s, \"stripes\": %u, "
+      "\"build-ns\": %.1f, \"patch-ns\": %.1f, \"speedup\": %.1f}\n",
+      gst_video_format_to_string (c->in_format), c->in_width, c->in_height,
+      gst_video_format_to_string (c->out_format), c->out_width,
+      c->out_height, c->borders ? "true" : "false", n_stripes,
+      (gdouble) build_ns / iterations, (gdouble) patch_ns / iterations,
+      (gdouble) build_ns / MAX (patch_ns, 1));
+
+  g_free (tmpl);
+  gst_video_frame_unmap (&out_frame);
+  gst_video_frame_unmap (&in_frame);
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (inbuf);
+}
+
+int
+main (int argc, char **argv)
+{
+  GOptionContext *ctx;
+  GError *err = NULL;
+  GstVspmFilter *space;
+  guint i;
+
+  ctx = g_option_context_new ("- vspmfilter job template microbenchmark");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &err)) {
+    g_printerr ("%s\n", err->message);
+    g_clear_error (&err);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+  iterations = MAX (iterations, 1);
+
+  space = g_object_new (GST_TYPE_VIDEO_CONVERT, NULL);
+  gst_object_ref_sink (space);
+
+  for (i = 0; i < G_N_ELEMENTS (bench_cases); i++)
+    bench_case (space, &bench_cases[i]);
+
+  gst_object_unref (space);
+
+  return 0;
+}
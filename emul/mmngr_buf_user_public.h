@@ -0,0 +1,38 @@
+/* Software stand-in for libmmngr
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* dmabuf export and import of the mmngr stand-in, for builds with
+ * --enable-vspm-emulation */
+
+#ifndef __MMNGR_BUF_USER_PUBLIC_H__
+#define __MMNGR_BUF_USER_PUBLIC_H__
+
+#include <stddef.h>
+
+int mmngr_export_start_in_user (int *pid, size_t size,
+    unsigned long hard_addr, int *pbuf);
+int mmngr_export_end_in_user (int id);
+int mmngr_import_start_in_user (int *pid, size_t *psize,
+    unsigned long *phard_addr, int buf);
+int mmngr_import_end_in_user (int id);
+int mmngr_import_start_in_user_ext (int *pid, size_t *psize,
+    unsigned int *phard_addr, int buf, void **puser_virt_addr);
+int mmngr_import_end_in_user_ext (int id);
+
+#endif /* __MMNGR_BUF_USER_PUBLIC_H__ */
@@ -0,0 +1,407 @@
+/* Software stand-in for libmmngr
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* mmngr areas are memfd mappings, given hardware addresses from a 32-bit
+ * window of their own. MM_IOC_VTOP only translates addresses inside
+ * those areas; like on the target, other memory has to be imported.
+ * A dmabuf is exported for a whole area, so with dmabuf-use only the
+ * first plane of a multi-planar buffer can be exported */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "mmngr_user_public.h"
+#include "mmngr_buf_user_public.h"
+#include "mmngr_emul.h"
+
+/* the layout of the real driver, see gstvspmfilter.h */
+struct MM_PARAM {
+  unsigned long size;
+  unsigned long long phy_addr;
+  unsigned long hard_addr;
+  unsigned long user_virt_addr;
+  unsigned long kernel_virt_addr;
+  unsigned long flag;
+};
+
+#define MM_IOC_MAGIC 'm'
+#define MM_IOC_VTOP _IOWR(MM_IOC_MAGIC, 7, struct MM_PARAM)
+
+#define EMUL_HARD_BASE   0x40000000UL
+#define EMUL_HARD_END    0xf0000000UL
+#define EMUL_DEV_FD      0x7ffe
+
+typedef struct _MmArea MmArea;
+struct _MmArea {
+  MmArea *next;           /* sorted by hard_addr */
+  int id;
+  unsigned long hard_addr;
+  size_t size;
+  void *virt;
+  int memfd;
+  ino_t ino;
+};
+
+typedef struct _MmHandle MmHandle;
+struct _MmHandle {
+  MmHandle *next;
+  int id;
+};
+
+static pthread_mutex_t mm_lock = PTHREAD_MUTEX_INITIALIZER;
+static MmArea *mm_areas;
+static MmHandle *mm_handles;   /* exports and imports */
+static int mm_next_id = 1;
+static int mm_dev_open;
+
+static MmArea *
+mm_find_hard (unsigned long hard_addr, size_t len)
+{
+  MmArea *a;
+
+  for (a = mm_areas; a; a = a->next) {
+    if (hard_addr >= a->hard_addr && hard_addr - a->hard_addr < a->size)
+      return (len <= a->size - (hard_addr - a->hard_addr)) ? a : NULL;
+  }
+  return NULL;
+}
+
+static MmArea *
+mm_find_virt (unsigned long virt)
+{
+  MmArea *a;
+
+  for (a = mm_areas; a; a = a->next) {
+    unsigned long base = (unsigned long) a->virt;
+
+    if (virt >= base && virt - base < a->size)
+      return a;
+  }
+  return NULL;
+}
+
+/* First fit in the hardware window, keeping mm_areas sorted */
+static int
+mm_insert (MmArea *area)
+{
+  MmArea **link = &mm_areas;
+  unsigned long start = EMUL_HARD_BASE;
+
+  while (*link) {
+    if ((*link)->hard_addr - start >= area->size)
+      break;
+    start = (*link)->hard_addr + (*link)->size;
+    link = &(*link)->next;
+  }
+  if (start >= EMUL_HARD_END || EMUL_HARD_END - start < area->size)
+    return -1;
+
+  area->hard_addr = start;
+  area->next = *link;
+  *link = area;
+  return 0;
+}
+
+static int
+mm_handle_new (void)
+{
+  MmHandle *h = calloc (1, sizeof (MmHandle));
+
+  if (h == NULL)
+    return -1;
+  h->id = mm_next_id++;
+  h->next = mm_handles;
+  mm_handles = h;
+  return h->id;
+}
+
+static int
+mm_handle_free (int id)
+{
+  MmHandle **link;
+
+  for (link = &mm_handles; *link; link = &(*link)->next) {
+    if ((*link)->id == id) {
+      MmHandle *h = *link;
+
+      *link = h->next;
+      free (h);
+      return R_MM_OK;
+    }
+  }
+  return R_MM_PARE;
+}
+
+int
+mmngr_alloc_in_user (MMNGR_ID *pid, size_t size, unsigned long *pphy_addr,
+    unsigned long *phard_addr, unsigned long *puser_virt_addr,
+    unsigned long flag)
+{
+  long page_size = sysconf (_SC_PAGESIZE);
+  struct stat st;
+  MmArea *area;
+
+  (void) flag;
+  if (pid == NULL || size == 0 || phard_addr == NULL ||
+      puser_virt_addr == NULL)
+    return R_MM_PARE;
+
+  area = calloc (1, sizeof (MmArea));
+  if (area == NULL)
+    return R_MM_NOMEM;
+  area->size = (size + page_size - 1) & ~(page_size - 1);
+
+  area->memfd = memfd_create ("mmngr-emul", MFD_CLOEXEC);
+  if (area->memfd < 0)
+    goto nomem;
+  if (ftruncate (area->memfd, area->size) < 0 ||
+      fstat (area->memfd, &st) < 0)
+    goto nomem_fd;
+  area->ino = st.st_ino;
+  area->virt = mmap (NULL, area->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+      area->memfd, 0);
+  if (area->virt == MAP_FAILED)
+    goto nomem_fd;
+
+  pthread_mutex_lock (&mm_lock);
+  if (mm_insert (area) < 0) {
+    pthread_mutex_unlock (&mm_lock);
+    munmap (area->virt, area->size);
+    goto nomem_fd;
+  }
+  area->id = mm_next_id++;
+  pthread_mutex_unlock (&mm_lock);
+
+  *pid = area->id;
+  if (pphy_addr)
+    *pphy_addr = area->hard_addr;
+  *phard_addr = area->hard_addr;
+  *puser_virt_addr = (unsigned long) area->virt;
+  return R_MM_OK;
+
+nomem_fd:
+  close (area->memfd);
+nomem:
+  free (area);
+  return R_MM_NOMEM;
+}
+
+int
+mmngr_free_in_user (MMNGR_ID id)
+{
+  MmArea **link, *area = NULL;
+
+  pthread_mutex_lock (&mm_lock);
+  for (link = &mm_areas; *link; link = &(*link)->next) {
+    if ((*link)->id == id) {
+      area = *link;
+      *link = area->next;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&mm_lock);
+
+  if (area == NULL)
+    return R_MM_PARE;
+  munmap (area->virt, area->size);
+  close (area->memfd);
+  free (area);
+  return R_MM_OK;
+}
+
+int
+mmngr_export_start_in_user (int *pid, size_t size, unsigned long hard_addr,
+    int *pbuf)
+{
+  MmArea *area;
+  int ret = R_MM_PARE;
+
+  pthread_mutex_lock (&mm_lock);
+  area = mm_find_hard (hard_addr, size);
+  if (area && area->hard_addr == hard_addr) {
+    *pbuf = dup (area->memfd);
+    *pid = mm_handle_new ();
+    ret = (*pbuf >= 0 && *pid >= 0) ? R_MM_OK : R_MM_FATAL;
+  } else if (area) {
+    fprintf (stderr, "mmngr-emul: can not export 0x%lx, only whole areas "
+        "can be exported\n", hard_addr);
+  }
+  pthread_mutex_unlock (&mm_lock);
+
+  return ret;
+}
+
+int
+mmngr_export_end_in_user (int id)
+{
+  int ret;
+
+  /* the fd belongs to the importer, which closes it */
+  pthread_mutex_lock (&mm_lock);
+  ret = mm_handle_free (id);
+  pthread_mutex_unlock (&mm_lock);
+
+  return ret;
+}
+
+int
+mmngr_import_start_in_user_ext (int *pid, size_t *psize,
+    unsigned int *phard_addr, int buf, void **puser_virt_addr)
+{
+  struct stat st;
+  MmArea *a;
+  int ret = R_MM_PARE;
+
+  if (fstat (buf, &st) < 0)
+    return R_MM_PARE;
+
+  pthread_mutex_lock (&mm_lock);
+  for (a = mm_areas; a; a = a->next) {
+    if (a->ino == st.st_ino) {
+      *pid = mm_handle_new ();
+      *psize = a->size;
+      *phard_addr = (unsigned int) a->hard_addr;
+      if (puser_virt_addr)
+        *puser_virt_addr = a->virt;
+      ret = (*pid >= 0) ? R_MM_OK : R_MM_FATAL;
+      break;
+    }
+  }
+  pthread_mutex_unlock (&mm_lock);
+
+  return ret;
+}
+
+int
+mmngr_import_end_in_user_ext (int id)
+{
+  int ret;
+
+  pthread_mutex_lock (&mm_lock);
+  ret = mm_handle_free (id);
+  pthread_mutex_unlock (&mm_lock);
+
+  return ret;
+}
+
+int
+mmngr_import_start_in_user (int *pid, size_t *psize,
+    unsigned long *phard_addr, int buf)
+{
+  unsigned int hard_addr;
+  int ret;
+
+  ret = mmngr_import_start_in_user_ext (pid, psize, &hard_addr, buf, NULL);
+  if (ret == R_MM_OK)
+    *phard_addr = hard_addr;
+  return ret;
+}
+
+int
+mmngr_import_end_in_user (int id)
+{
+  return mmngr_import_end_in_user_ext (id);
+}
+
+int
+mmngr_emul_open (const char *path, int flags)
+{
+  (void) path;
+  (void) flags;
+
+  pthread_mutex_lock (&mm_lock);
+  mm_dev_open++;
+  pthread_mutex_unlock (&mm_lock);
+
+  return EMUL_DEV_FD;
+}
+
+int
+mmngr_emul_close (int fd)
+{
+  if (fd != EMUL_DEV_FD)
+    return close (fd);
+
+  pthread_mutex_lock (&mm_lock);
+  mm_dev_open--;
+  pthread_mutex_unlock (&mm_lock);
+
+  return 0;
+}
+
+/* MM_IOC_VTOP gets two MM_PARAM, as find_physical_address passes them */
+int
+mmngr_emul_ioctl (int fd, unsigned long request, void *arg)
+{
+  struct MM_PARAM *p = arg;
+  int i, ret = 0;
+
+  if (fd != EMUL_DEV_FD || request != MM_IOC_VTOP || p == NULL) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  pthread_mutex_lock (&mm_lock);
+  for (i = 0; i < 2; i++) {
+    MmArea *a;
+
+    p[i].hard_addr = 0;
+    if (p[i].user_virt_addr == 0)
+      continue;
+    a = mm_find_virt (p[i].user_virt_addr);
+    if (a == NULL) {
+      ret = -1;
+      continue;
+    }
+    p[i].hard_addr = a->hard_addr +
+        (p[i].user_virt_addr - (unsigned long) a->virt);
+    p[i].phy_addr = p[i].hard_addr;
+  }
+  pthread_mutex_unlock (&mm_lock);
+
+  if (ret)
+    errno = EFAULT;
+  return ret;
+}
+
+void *
+mmngr_emul_lookup (unsigned long hard_addr, size_t len)
+{
+  MmArea *a;
+  void *virt = NULL;
+
+  pthread_mutex_lock (&mm_lock);
+  a = mm_find_hard (hard_addr, len);
+  if (a)
+    virt = (char *) a->virt + (hard_addr - a->hard_addr);
+  pthread_mutex_unlock (&mm_lock);
+
+  return virt;
+}
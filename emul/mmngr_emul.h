@@ -0,0 +1,36 @@
+/* Software stand-in for libmmngr
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Entry points of the mmngr stand-in with no Renesas counterpart: the
+ * /dev/rgnmm device, and the address lookup vspm_emul.c runs jobs with */
+
+#ifndef __MMNGR_EMUL_H__
+#define __MMNGR_EMUL_H__
+
+#include <stddef.h>
+
+int mmngr_emul_open (const char *path, int flags);
+int mmngr_emul_ioctl (int fd, unsigned long request, void *arg);
+int mmngr_emul_close (int fd);
+
+/* CPU address of len bytes at a hardware address, NULL when they are
+ * not all inside one mmngr area */
+void *mmngr_emul_lookup (unsigned long hard_addr, size_t len);
+
+#endif /* __MMNGR_EMUL_H__ */
@@ -0,0 +1,44 @@
+/* Software stand-in for libmmngr
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The part of the mmngr API which the plugin uses, for builds with
+ * --enable-vspm-emulation */
+
+#ifndef __MMNGR_USER_PUBLIC_H__
+#define __MMNGR_USER_PUBLIC_H__
+
+#include <stddef.h>
+
+#define R_MM_OK                     (0)
+#define R_MM_FATAL                  (-1)
+#define R_MM_SEQERR                 (-2)
+#define R_MM_PARE                   (-3)
+#define R_MM_NOMEM                  (-4)
+
+#define MMNGR_VA_SUPPORT            (0)
+#define MMNGR_VA_SUPPORT_CACHED     (1)
+
+typedef int MMNGR_ID;
+
+int mmngr_alloc_in_user (MMNGR_ID *pid, size_t size,
+    unsigned long *pphy_addr, unsigned long *phard_addr,
+    unsigned long *puser_virt_addr, unsigned long flag);
+int mmngr_free_in_user (MMNGR_ID id);
+
+#endif /* __MMNGR_USER_PUBLIC_H__ */
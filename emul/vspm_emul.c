@@ -0,0 +1,938 @@
+/* Software stand-in for libvspm
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* VSPM_lib_Entry runs the job in software on a worker thread per VSP
+ * channel, then calls the completion callback from that thread like the
+ * driver does. The pipe is the one the plugin builds: up to four RPFs,
+ * the UDS on the RPF which connects to it, the BRU over a virtual layer
+ * and the WPF. Pixels travel as A, C0, C1, C2 bytes, in RGB or YUV as
+ * the RPF reads them; the RPF and WPF csc flags convert between the two.
+ *
+ * A format is read in memory order after the swap: the plugin passes all
+ * swap bits set for data in memory order, the bits which are cleared
+ * swap the bytes of each 16-byte unit. RGB565 words are little endian. */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vspm_public.h"
+#include "mmngr_emul.h"
+
+#define EMUL_CHANNELS    2
+#define EMUL_QUEUE_MAX   32
+#define EMUL_SWAP_ALL    (VSP_SWAP_B | VSP_SWAP_W | VSP_SWAP_L | VSP_SWAP_LL)
+
+typedef struct {
+  int width, height;
+  int yuv;
+  unsigned char *px;      /* A, C0, C1, C2 per pixel */
+} EmulImage;
+
+typedef struct _EmulJob EmulJob;
+struct _EmulJob {
+  EmulJob *next;
+  unsigned long id;
+  unsigned long user_data;
+  PFN_VSPM_COMPLETE_CALLBACK cb;
+
+  /* copies, the caller may reuse its parameters once the job is queued */
+  VSPM_VSP_PAR par;
+  T_VSP_IN src[4];
+  T_VSP_ALPHA alpha[4];
+  T_VSP_MULT mult[4];
+  T_VSP_OUT dst;
+  T_VSP_CTRL ctrl;
+  T_VSP_UDS uds;
+  T_VSP_BRU bru;
+  T_VSP_BLEND_VIRTUAL virt;
+};
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  EmulJob *head, *tail;
+  int depth;
+  int quit;
+} EmulChannel;
+
+typedef struct {
+  EmulChannel ch[EMUL_CHANNELS];
+} EmulVspm;
+
+static pthread_mutex_t emul_id_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long emul_next_id = 1;
+
+/* formats */
+
+typedef struct {
+  unsigned short format;
+  int yuv;
+  int planes;
+  int bpp;                /* bytes per pixel of the first plane */
+  int sub_x, sub_y;       /* chroma subsampling */
+} EmulFormat;
+
+static const EmulFormat emul_formats[] = {
+  { VSP_IN_RGB565,             0, 1, 2, 1, 1 },
+  { VSP_IN_RGB888,             0, 1, 3, 1, 1 },
+  { VSP_IN_BGR888,             0, 1, 3, 1, 1 },
+  { VSP_IN_ARGB8888,           0, 1, 4, 1, 1 },
+  { VSP_IN_ABGR8888,           0, 1, 4, 1, 1 },
+  { VSP_IN_RGBA8888,           0, 1, 4, 1, 1 },
+  { VSP_IN_YUV444_INTERLEAVED, 1, 1, 3, 1, 1 },
+  { VSP_IN_YUV422_INT0_YUY2,   1, 1, 2, 2, 1 },
+  { VSP_IN_YUV422_INT0_UYVY,   1, 1, 2, 2, 1 },
+  { VSP_IN_YUV422_INT0_YVYU,   1, 1, 2, 2, 1 },
+  { VSP_IN_YUV444_SEMI_PLANAR, 1, 2, 1, 1, 1 },
+  { VSP_IN_YUV422_SEMI_NV16,   1, 2, 1, 2, 1 },
+  { VSP_IN_YUV420_SEMI_NV12,   1, 2, 1, 2, 2 },
+  { VSP_IN_YUV420_SEMI_NV21,   1, 2, 1, 2, 2 },
+  { VSP_IN_YUV444_PLANAR,      1, 3, 1, 1, 1 },
+  { VSP_IN_YUV420_PLANAR,      1, 3, 1, 2, 2 },
+};
+
+static const EmulFormat *
+emul_format (unsigned short format)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof (emul_formats) / sizeof (emul_formats[0]); i++)
+    if (emul_formats[i].format == format)
+      return &emul_formats[i];
+  return NULL;
+}
+
+/* The planes of a picture, as CPU addresses */
+typedef struct {
+  const EmulFormat *fmt;
+  unsigned char *p[3];    /* 16-byte aligned, see delta */
+  int delta[3];           /* of the plane start from p */
+  int stride, stride_c;
+  int eff;                /* byte index swap, see the top of the file */
+} EmulPlanes;
+
+static int
+emul_map_planes (EmulPlanes *pl, unsigned short format, void *addr[3],
+    int stride, int stride_c, int width, int rows, unsigned char swap)
+{
+  int i, crows, len, row;
+  unsigned long base;
+
+  pl->fmt = emul_format (format);
+  if (pl->fmt == NULL) {
+    fprintf (stderr, "vspm-emul: unsupported format 0x%04x\n", format);
+    return R_VSPM_PARAERR;
+  }
+  pl->stride = stride;
+  pl->stride_c = stride_c;
+  pl->eff = (swap ^ EMUL_SWAP_ALL) & EMUL_SWAP_ALL;
+
+  crows = (rows + pl->fmt->sub_y - 1) / pl->fmt->sub_y;
+  for (i = 0; i < 3; i++) {
+    pl->p[i] = NULL;
+    if (i >= pl->fmt->planes)
+      continue;
+    /* whole 16-byte units, for the swap. A stripe of a picture starts
+     * anywhere in a unit and stops short of the end of the last row */
+    base = (unsigned long) addr[i] & ~15UL;
+    pl->delta[i] = (int) ((unsigned long) addr[i] - base);
+    if (i == 0)
+      row = width * pl->fmt->bpp;
+    else
+      row = (width + pl->fmt->sub_x - 1) / pl->fmt->sub_x *
+          (pl->fmt->planes == 2 ? 2 : 1);
+    len = (i == 0) ? stride * (rows - 1) : stride_c * (crows - 1);
+    len = (pl->delta[i] + len + row + 15) & ~15;
+    pl->p[i] = mmngr_emul_lookup (base, len);
+    if (pl->p[i] == NULL) {
+      fprintf (stderr, "vspm-emul: plane %d at 0x%lx (%d bytes) is not "
+          "mmngr memory\n", i, (unsigned long) addr[i], len);
+      return R_VSPM_NG;
+    }
+  }
+  return R_VSPM_OK;
+}
+
+#define RD(pl, n, off) \
+    ((pl)->p[n][((off) + (pl)->delta[n]) ^ (pl)->eff])
+#define WR(pl, n, off, v) \
+    ((pl)->p[n][((off) + (pl)->delta[n]) ^ (pl)->eff] = (unsigned char) (v))
+
+static void
+emul_read_pixel (const EmulPlanes *pl, int x, int y, unsigned char *px)
+{
+  size_t off, c;
+  unsigned int v;
+
+  px[0] = 0xff;
+  switch (pl->fmt->format) {
+    case VSP_IN_RGB565:
+      off = (size_t) y * pl->stride + x * 2;
+      v = RD (pl, 0, off) | (RD (pl, 0, off + 1) << 8);
+      px[1] = ((v >> 11) & 0x1f) << 3 | ((v >> 13) & 0x07);
+      px[2] = ((v >> 5) & 0x3f) << 2 | ((v >> 9) & 0x03);
+      px[3] = (v & 0x1f) << 3 | ((v >> 2) & 0x07);
+      break;
+    case VSP_IN_RGB888:
+    case VSP_IN_YUV444_INTERLEAVED:
+      off = (size_t) y * pl->stride + x * 3;
+      px[1] = RD (pl, 0, off);
+      px[2] = RD (pl, 0, off + 1);
+      px[3] = RD (pl, 0, off + 2);
+      break;
+    case VSP_IN_BGR888:
+      off = (size_t) y * pl->stride + x * 3;
+      px[3] = RD (pl, 0, off);
+      px[2] = RD (pl, 0, off + 1);
+      px[1] = RD (pl, 0, off + 2);
+      break;
+    case VSP_IN_ARGB8888:
+      off = (size_t) y * pl->stride + x * 4;
+      px[0] = RD (pl, 0, off);
+      px[1] = RD (pl, 0, off + 1);
+      px[2] = RD (pl, 0, off + 2);
+      px[3] = RD (pl, 0, off + 3);
+      break;
+    case VSP_IN_ABGR8888:
+      off = (size_t) y * pl->stride + x * 4;
+      px[0] = RD (pl, 0, off);
+      px[3] = RD (pl, 0, off + 1);
+      px[2] = RD (pl, 0, off + 2);
+      px[1] = RD (pl, 0, off + 3);
+      break;
+    case VSP_IN_RGBA8888:
+      off = (size_t) y * pl->stride + x * 4;
+      px[1] = RD (pl, 0, off);
+      px[2] = RD (pl, 0, off + 1);
+      px[3] = RD (pl, 0, off + 2);
+      px[0] = RD (pl, 0, off + 3);
+      break;
+    case VSP_IN_YUV422_INT0_YUY2:
+      off = (size_t) y * pl->stride + (x & ~1) * 2;
+      px[1] = RD (pl, 0, off + (x & 1) * 2);
+      px[2] = RD (pl, 0, off + 1);
+      px[3] = RD (pl, 0, off + 3);
+      break;
+    case VSP_IN_YUV422_INT0_UYVY:
+      off = (size_t) y * pl->stride + (x & ~1) * 2;
+      px[1] = RD (pl, 0, off + 1 + (x & 1) * 2);
+      px[2] = RD (pl, 0, off);
+      px[3] = RD (pl, 0, off + 2);
+      break;
+    case VSP_IN_YUV422_INT0_YVYU:
+      off = (size_t) y * pl->stride + (x & ~1) * 2;
+      px[1] = RD (pl, 0, off + (x & 1) * 2);
+      px[3] = RD (pl, 0, off + 1);
+      px[2] = RD (pl, 0, off + 3);
+      break;
+    case VSP_IN_YUV444_SEMI_PLANAR:
+    case VSP_IN_YUV422_SEMI_NV16:
+    case VSP_IN_YUV420_SEMI_NV12:
+    case VSP_IN_YUV420_SEMI_NV21:
+      px[1] = RD (pl, 0, (size_t) y * pl->stride + x);
+      c = (size_t) (y / pl->fmt->sub_y) * pl->stride_c +
+          (x / pl->fmt->sub_x) * 2;
+      if (pl->fmt->format == VSP_IN_YUV420_SEMI_NV21) {
+        px[3] = RD (pl, 1, c);
+        px[2] = RD (pl, 1, c + 1);
+      } else {
+        px[2] = RD (pl, 1, c);
+        px[3] = RD (pl, 1, c + 1);
+      }
+      break;
+    case VSP_IN_YUV444_PLANAR:
+    case VSP_IN_YUV420_PLANAR:
+      px[1] = RD (pl, 0, (size_t) y * pl->stride + x);
+      c = (size_t) (y / pl->fmt->sub_y) * pl->stride_c + x / pl->fmt->sub_x;
+      px[2] = RD (pl, 1, c);
+      px[3] = RD (pl, 2, c);
+      break;
+  }
+}
+
+/* Luma or RGB of a pixel, chroma of the packed 4:2:2 formats is written
+ * with the even pixel from the pair average */
+static void
+emul_write_pixel (EmulPlanes *pl, int x, int y, const unsigned char *px,
+    const unsigned char *pair)
+{
+  size_t off;
+  unsigned int v;
+
+  switch (pl->fmt->format) {
+    case VSP_OUT_RGB565:
+      off = (size_t) y * pl->stride + x * 2;
+      v = (px[1] >> 3) << 11 | (px[2] >> 2) << 5 | (px[3] >> 3);
+      WR (pl, 0, off, v & 0xff);
+      WR (pl, 0, off + 1, v >> 8);
+      break;
+    case VSP_OUT_RGB888:
+    case VSP_OUT_YUV444_INTERLEAVED:
+      off = (size_t) y * pl->stride + x * 3;
+      WR (pl, 0, off, px[1]);
+      WR (pl, 0, off + 1, px[2]);
+      WR (pl, 0, off + 2, px[3]);
+      break;
+    case VSP_OUT_BGR888:
+      off = (size_t) y * pl->stride + x * 3;
+      WR (pl, 0, off, px[3]);
+      WR (pl, 0, off + 1, px[2]);
+      WR (pl, 0, off + 2, px[1]);
+      break;
+    case VSP_OUT_PRGB8888:
+      off = (size_t) y * pl->stride + x * 4;
+      WR (pl, 0, off, px[0]);
+      WR (pl, 0, off + 1, px[1]);
+      WR (pl, 0, off + 2, px[2]);
+      WR (pl, 0, off + 3, px[3]);
+      break;
+    case VSP_OUT_PBGR8888:
+      off = (size_t) y * pl->stride + x * 4;
+      WR (pl, 0, off, px[0]);
+      WR (pl, 0, off + 1, px[3]);
+      WR (pl, 0, off + 2, px[2]);
+      WR (pl, 0, off + 3, px[1]);
+      break;
+    case VSP_OUT_RGBP8888:
+      off = (size_t) y * pl->stride + x * 4;
+      WR (pl, 0, off, px[1]);
+      WR (pl, 0, off + 1, px[2]);
+      WR (pl, 0, off + 2, px[3]);
+      WR (pl, 0, off + 3, px[0]);
+      break;
+    case VSP_OUT_YUV422_INT0_YUY2:
+    case VSP_OUT_YUV422_INT0_UYVY:
+    case VSP_OUT_YUV422_INT0_YVYU:
+    {
+      int y_pos = pl->fmt->format == VSP_OUT_YUV422_INT0_UYVY ? 1 : 0;
+      int u_pos, v_pos;
+
+      off = (size_t) y * pl->stride + (x & ~1) * 2;
+      WR (pl, 0, off + y_pos + (x & 1) * 2, px[1]);
+      if (pair == NULL)
+        break;
+      switch (pl->fmt->format) {
+        case VSP_OUT_YUV422_INT0_YUY2: u_pos = 1; v_pos = 3; break;
+        case VSP_OUT_YUV422_INT0_UYVY: u_pos = 0; v_pos = 2; break;
+        default:                       u_pos = 3; v_pos = 1; break;
+      }
+      WR (pl, 0, off + u_pos, pair[2]);
+      WR (pl, 0, off + v_pos, pair[3]);
+      break;
+    }
+    default:
+      /* semi-planar and planar luma */
+      WR (pl, 0, (size_t) y * pl->stride + x, px[1]);
+      break;
+  }
+}
+
+/* colour conversion, limited range */
+
+static unsigned char
+emul_clamp (int v)
+{
+  return v < 0 ? 0 : (v > 255 ? 255 : v);
+}
+
+static void
+emul_csc (EmulImage *img, int to_yuv, unsigned char iturbt)
+{
+  int bt709 = (iturbt == VSP_ITURBT_709);
+  size_t i, n = (size_t) img->width * img->height;
+
+  for (i = 0; i < n; i++) {
+    unsigned char *px = img->px + i * 4;
+    int a = px[1], b = px[2], c = px[3];
+
+    if (to_yuv) {
+      if (bt709) {
+        px[1] = emul_clamp (((47 * a + 157 * b + 16 * c + 128) >> 8) + 16);
+        px[2] = emul_clamp (((-26 * a - 87 * b + 112 * c + 128) >> 8) + 128);
+        px[3] = emul_clamp (((112 * a - 102 * b - 10 * c + 128) >> 8) + 128);
+      } else {
+        px[1] = emul_clamp (((66 * a + 129 * b + 25 * c + 128) >> 8) + 16);
+        px[2] = emul_clamp (((-38 * a - 74 * b + 112 * c + 128) >> 8) + 128);
+        px[3] = emul_clamp (((112 * a - 94 * b - 18 * c + 128) >> 8) + 128);
+      }
+    } else {
+      a -= 16;
+      b -= 128;
+      c -= 128;
+      if (bt709) {
+        px[1] = emul_clamp ((298 * a + 459 * c + 128) >> 8);
+        px[2] = emul_clamp ((298 * a - 55 * b - 136 * c + 128) >> 8);
+        px[3] = emul_clamp ((298 * a + 541 * b + 128) >> 8);
+      } else {
+        px[1] = emul_clamp ((298 * a + 409 * c + 128) >> 8);
+        px[2] = emul_clamp ((298 * a - 100 * b - 208 * c + 128) >> 8);
+        px[3] = emul_clamp ((298 * a + 516 * b + 128) >> 8);
+      }
+    }
+  }
+  img->yuv = to_yuv;
+}
+
+static int
+emul_image_init (EmulImage *img, int width, int height, int yuv)
+{
+  img->width = width;
+  img->height = height;
+  img->yuv = yuv;
+  img->px = malloc ((size_t) width * height * 4);
+  return img->px ? R_VSPM_OK : R_VSPM_NG;
+}
+
+/* RPF alpha: the fixed one for VSP_ALPHA_NUM5, else the one of the pixel,
+ * then multiplied by the ratio */
+static unsigned char
+emul_input_alpha (const T_VSP_ALPHA *alpha, unsigned char pixel)
+{
+  unsigned int a = pixel;
+
+  if (alpha == NULL)
+    return pixel;
+  if (alpha->asel == VSP_ALPHA_NUM5)
+    a = alpha->afix;
+  if (alpha->mult && alpha->mult->a_mmd == VSP_MULT_RATIO)
+    a = a * alpha->mult->ratio / 255;
+  return a;
+}
+
+/* RPF */
+static long
+emul_read_input (const T_VSP_IN *in, EmulImage *img)
+{
+  EmulPlanes pl;
+  void *addr[3] = { in->addr, in->addr_c0, in->addr_c1 };
+  int x, y;
+  long ret;
+
+  if (in->width == 0 || in->height == 0)
+    return R_VSPM_PARAERR;
+
+  /* virtual input: a plane of vircolor, ARGB like the BRU virtual layer */
+  if (in->vir == VSP_VIR) {
+    unsigned char color[4];
+    size_t i, n;
+
+    if (emul_image_init (img, in->width, in->height, 0))
+      return R_VSPM_NG;
+    color[0] = emul_input_alpha (in->alpha_blend, in->vircolor >> 24);
+    color[1] = in->vircolor >> 16;
+    color[2] = in->vircolor >> 8;
+    color[3] = in->vircolor;
+    n = (size_t) img->width * img->height;
+    for (i = 0; i < n; i++)
+      memcpy (img->px + i * 4, color, 4);
+    return R_VSPM_OK;
+  }
+
+  ret = emul_map_planes (&pl, in->format, addr, in->stride, in->stride_c,
+      in->x_offset + in->width, in->y_offset + in->height, in->swap);
+  if (ret)
+    return ret;
+  if (emul_image_init (img, in->width, in->height, pl.fmt->yuv))
+    return R_VSPM_NG;
+
+  for (y = 0; y < in->height; y++) {
+    for (x = 0; x < in->width; x++) {
+      unsigned char *px = img->px + ((size_t) y * img->width + x) * 4;
+
+      emul_read_pixel (&pl, in->x_offset + x, in->y_offset + y, px);
+      px[0] = emul_input_alpha (in->alpha_blend, px[0]);
+    }
+  }
+
+  if (in->csc == VSP_CSC_ON)
+    emul_csc (img, !img->yuv, in->iturbt);
+
+  return R_VSPM_OK;
+}
+
+/* UDS, bilinear or nearest neighbour; ratios are input/output in 4.12 */
+static long
+emul_scale (EmulImage *img, const T_VSP_UDS *uds)
+{
+  EmulImage out;
+  int x, y, k;
+
+  if (uds->x_ratio == 0 || uds->y_ratio == 0 ||
+      uds->out_cwidth == 0 || uds->out_cheight == 0)
+    return R_VSPM_PARAERR;
+  if (emul_image_init (&out, uds->out_cwidth, uds->out_cheight, img->yuv))
+    return R_VSPM_NG;
+
+  for (y = 0; y < out.height; y++) {
+    long fy = (long) y * uds->y_ratio + uds->y_ratio / 2 - 2048;
+    int y0, y1, wy;
+
+    if (fy < 0)
+      fy = 0;
+    y0 = fy >> 12;
+    wy = (fy & 4095) >> 4;
+    if (y0 >= img->height - 1) {
+      y0 = img->height - 1;
+      wy = 0;
+    }
+    y1 = y0 + (wy ? 1 : 0);
+
+    for (x = 0; x < out.width; x++) {
+      long fx = (long) x * uds->x_ratio + uds->x_ratio / 2 - 2048;
+      unsigned char *d = out.px + ((size_t) y * out.width + x) * 4;
+      const unsigned char *s00, *s01, *s10, *s11;
+      int x0, x1, wx;
+
+      if (fx < 0)
+        fx = 0;
+      x0 = fx >> 12;
+      wx = (fx & 4095) >> 4;
+      if (x0 >= img->width - 1) {
+        x0 = img->width - 1;
+        wx = 0;
+      }
+      x1 = x0 + (wx ? 1 : 0);
+
+      if (uds->complement == VSP_COMPLEMENT_NN) {
+        x1 = x0 = (wx >= 128) ? x1 : x0;
+        y1 = y0 = (wy >= 128) ? y1 : y0;
+        wx = wy = 0;
+      }
+
+      s00 = img->px + ((size_t) y0 * img->width + x0) * 4;
+      s01 = img->px + ((size_t) y0 * img->width + x1) * 4;
+      s10 = img->px + ((size_t) y1 * img->width + x0) * 4;
+      s11 = img->px + ((size_t) y1 * img->width + x1) * 4;
+      for (k = 0; k < 4; k++) {
+        int top = s00[k] * (256 - wx) + s01[k] * wx;
+        int bottom = s10[k] * (256 - wx) + s11[k] * wx;
+
+        d[k] = (top * (256 - wy) + bottom * wy + 32768) >> 16;
+      }
+    }
+  }
+
+  free (img->px);
+  *img = out;
+  return R_VSPM_OK;
+}
+
+/* BRU: the layers in lay_order, bottom first, blended by source alpha */
+static long
+emul_blend (EmulJob *job, EmulImage *layers, EmulImage *canvas)
+{
+  const T_VSP_BRU *bru = &job->bru;
+  const T_VSP_BLEND_VIRTUAL *virt = &job->virt;
+  unsigned char color[4];
+  int i, k, x, y;
+  size_t n;
+
+  if (bru->blend_virtual == NULL || virt->width == 0 || virt->height == 0)
+    return R_VSPM_PARAERR;
+  if (emul_image_init (canvas, virt->width, virt->height, layers[0].yuv))
+    return R_VSPM_NG;
+
+  color[0] = virt->color >> 24;
+  color[1] = virt->color >> 16;
+  color[2] = virt->color >> 8;
+  color[3] = virt->color;
+  n = (size_t) canvas->width * canvas->height;
+  for (i = 0; (size_t) i < n; i++)
+    memcpy (canvas->px + (size_t) i * 4, color, 4);
+
+  for (k = 0; k < 5; k++) {
+    int lay = (bru->lay_order >> (4 * k)) & 0xf;
+    const T_VSP_IN *in;
+    const EmulImage *l;
+
+    if (lay < VSP_LAY_1 || lay > VSP_LAY_4 || lay > job->par.rpf_num)
+      continue;
+    in = &job->src[lay - 1];
+    l = &layers[lay - 1];
+
+    for (y = 0; y < l->height; y++) {
+      int cy = in->y_position + y;
+
+      if (cy >= canvas->height)
+        break;
+      for (x = 0; x < l->width; x++) {
+        int cx = in->x_position + x;
+        const unsigned char *s = l->px + ((size_t) y * l->width + x) * 4;
+        unsigned char *d;
+        int a = s[0];
+
+        if (cx >= canvas->width)
+          break;
+        d = canvas->px + ((size_t) cy * canvas->width + cx) * 4;
+        d[1] = (s[1] * a + d[1] * (255 - a) + 127) / 255;
+        d[2] = (s[2] * a + d[2] * (255 - a) + 127) / 255;
+        d[3] = (s[3] * a + d[3] * (255 - a) + 127) / 255;
+        d[0] = a + d[0] * (255 - a) / 255;
+      }
+    }
+  }
+
+  return R_VSPM_OK;
+}
+
+static long
+emul_clip (EmulImage *img, int x, int y)
+{
+  EmulImage out;
+  int j;
+
+  if (x >= img->width || y >= img->height)
+    return R_VSPM_PARAERR;
+  if (emul_image_init (&out, img->width - x, img->height - y, img->yuv))
+    return R_VSPM_NG;
+  for (j = 0; j < out.height; j++)
+    memcpy (out.px + (size_t) j * out.width * 4,
+        img->px + ((size_t) (y + j) * img->width + x) * 4,
+        (size_t) out.width * 4);
+
+  free (img->px);
+  *img = out;
+  return R_VSPM_OK;
+}
+
+/* WPF */
+static long
+emul_write_output (const T_VSP_OUT *out, EmulImage *img)
+{
+  EmulPlanes pl;
+  void *addr[3] = { out->addr, out->addr_c0, out->addr_c1 };
+  int width, height, x, y, cx, cy, sx, sy, i, j;
+  long ret;
+
+  ret = emul_map_planes (&pl, out->format, addr, out->stride, out->stride_c,
+      out->width, out->height, out->swap);
+  if (ret)
+    return ret;
+
+  /* clipping: the picture written starts at x_offset, y_offset */
+  if (out->x_offset || out->y_offset) {
+    ret = emul_clip (img, out->x_offset, out->y_offset);
+    if (ret)
+      return ret;
+  }
+
+  if (out->csc == VSP_CSC_ON)
+    emul_csc (img, !img->yuv, out->iturbt);
+
+  width = img->width < out->width ? img->width : out->width;
+  height = img->height < out->height ? img->height : out->height;
+  sx = pl.fmt->sub_x;
+  sy = pl.fmt->sub_y;
+
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x++) {
+      unsigned char px[4], pair[4];
+      const unsigned char *p = img->px + ((size_t) y * img->width + x) * 4;
+
+      memcpy (px, p, 4);
+      if (out->pxa == VSP_PAD_P)
+        px[0] = out->pad;
+      if (pl.fmt->planes == 1 && sx == 2 && !(x & 1)) {
+        const unsigned char *q = (x + 1 < width) ? p + 4 : p;
+
+        pair[2] = (p[2] + q[2] + 1) / 2;
+        pair[3] = (p[3] + q[3] + 1) / 2;
+        emul_write_pixel (&pl, x, y, px, pair);
+      } else {
+        emul_write_pixel (&pl, x, y, px, NULL);
+      }
+    }
+  }
+
+  if (pl.fmt->planes == 1)
+    return R_VSPM_OK;
+
+  /* chroma planes, averaged over each subsampled block */
+  for (cy = 0; cy * sy < height; cy++) {
+    for (cx = 0; cx * sx < width; cx++) {
+      int u = 0, v = 0, cnt = 0;
+      size_t off;
+
+      for (j = 0; j < sy && cy * sy + j < height; j++) {
+        for (i = 0; i < sx && cx * sx + i < width; i++) {
+          const unsigned char *p = img->px +
+              ((size_t) (cy * sy + j) * img->width + cx * sx + i) * 4;
+
+          u += p[2];
+          v += p[3];
+          cnt++;
+        }
+      }
+      u = (u + cnt / 2) / cnt;
+      v = (v + cnt / 2) / cnt;
+
+      if (pl.fmt->planes == 2) {
+        off = (size_t) cy * pl.stride_c + cx * 2;
+        if (pl.fmt->format == VSP_OUT_YUV420_SEMI_NV21) {
+          WR (&pl, 1, off, v);
+          WR (&pl, 1, off + 1, u);
+        } else {
+          WR (&pl, 1, off, u);
+          WR (&pl, 1, off + 1, v);
+        }
+      } else {
+        off = (size_t) cy * pl.stride_c + cx;
+        WR (&pl, 1, off, u);
+        WR (&pl, 2, off, v);
+      }
+    }
+  }
+
+  return R_VSPM_OK;
+}
+
+static long
+emul_run (EmulJob *job)
+{
+  EmulImage layers[4];
+  EmulImage canvas = { 0, 0, 0, NULL };
+  EmulImage *result;
+  int i, n = job->par.rpf_num;
+  int uds_done = 0;
+  long ret = R_VSPM_OK;
+
+  memset (layers, 0, sizeof (layers));
+
+  for (i = 0; i < n && ret == R_VSPM_OK; i++) {
+    ret = emul_read_input (&job->src[i], &layers[i]);
+    if (ret == R_VSPM_OK && (job->src[i].connect & VSP_UDS_USE) &&
+        (job->par.use_module & VSP_UDS_USE) && !uds_done) {
+      ret = emul_scale (&layers[i], &job->uds);
+      uds_done = 1;
+    }
+  }
+
+  if (ret == R_VSPM_OK) {
+    if (job->par.use_module & VSP_BRU_USE) {
+      ret = emul_blend (job, layers, &canvas);
+      result = &canvas;
+    } else {
+      result = &layers[0];
+    }
+    if (ret == R_VSPM_OK)
+      ret = emul_write_output (&job->dst, result);
+  }
+
+  for (i = 0; i < 4; i++)
+    free (layers[i].px);
+  free (canvas.px);
+
+  return ret;
+}
+
+static void *
+emul_channel_thread (void *data)
+{
+  EmulChannel *ch = data;
+  EmulJob *job;
+  long result;
+
+  for (;;) {
+    pthread_mutex_lock (&ch->lock);
+    while (ch->head == NULL && !ch->quit)
+      pthread_cond_wait (&ch->cond, &ch->lock);
+    job = ch->head;
+    if (job == NULL) {
+      pthread_mutex_unlock (&ch->lock);
+      break;
+    }
+    ch->head = job->next;
+    if (ch->head == NULL)
+      ch->tail = NULL;
+    pthread_mutex_unlock (&ch->lock);
+
+    result = emul_run (job);
+    if (job->cb)
+      job->cb (job->id, result, job->user_data);
+
+    pthread_mutex_lock (&ch->lock);
+    ch->depth--;
+    pthread_mutex_unlock (&ch->lock);
+    free (job);
+  }
+
+  return NULL;
+}
+
+long
+VSPM_lib_DriverInitialize (unsigned long *handle)
+{
+  EmulVspm *vspm;
+  int i;
+
+  if (handle == NULL)
+    return R_VSPM_PARAERR;
+  vspm = calloc (1, sizeof (EmulVspm));
+  if (vspm == NULL)
+    return R_VSPM_NG;
+
+  for (i = 0; i < EMUL_CHANNELS; i++) {
+    EmulChannel *ch = &vspm->ch[i];
+
+    pthread_mutex_init (&ch->lock, NULL);
+    pthread_cond_init (&ch->cond, NULL);
+    if (pthread_create (&ch->thread, NULL, emul_channel_thread, ch) != 0) {
+      vspm->ch[i].quit = 1;
+      while (i--) {
+        pthread_mutex_lock (&vspm->ch[i].lock);
+        vspm->ch[i].quit = 1;
+        pthread_cond_signal (&vspm->ch[i].cond);
+        pthread_mutex_unlock (&vspm->ch[i].lock);
+        pthread_join (vspm->ch[i].thread, NULL);
+      }
+      free (vspm);
+      return R_VSPM_NG;
+    }
+  }
+
+  *handle = (unsigned long) vspm;
+  return R_VSPM_OK;
+}
+
+/* The queued jobs still run, as the driver waits for the hardware */
+long
+VSPM_lib_DriverQuit (unsigned long handle)
+{
+  EmulVspm *vspm = (EmulVspm *) handle;
+  int i;
+
+  if (vspm == NULL)
+    return R_VSPM_PARAERR;
+
+  for (i = 0; i < EMUL_CHANNELS; i++) {
+    EmulChannel *ch = &vspm->ch[i];
+
+    pthread_mutex_lock (&ch->lock);
+    ch->quit = 1;
+    pthread_cond_signal (&ch->cond);
+    pthread_mutex_unlock (&ch->lock);
+    pthread_join (ch->thread, NULL);
+    pthread_cond_destroy (&ch->cond);
+    pthread_mutex_destroy (&ch->lock);
+  }
+  free (vspm);
+
+  return R_VSPM_OK;
+}
+
+long
+VSPM_lib_Entry (unsigned long handle, unsigned long *puwJobId,
+    char bJobPriority, VSPM_IP_PAR *ptIpParam, unsigned long uwUserData,
+    PFN_VSPM_COMPLETE_CALLBACK pfnNotifyComplete)
+{
+  EmulVspm *vspm = (EmulVspm *) handle;
+  const VSPM_VSP_PAR *par;
+  const T_VSP_IN *src[4];
+  EmulChannel *ch;
+  EmulJob *job;
+  int i;
+
+  (void) bJobPriority;
+  if (vspm == NULL || puwJobId == NULL || ptIpParam == NULL)
+    return R_VSPM_PARAERR;
+  par = ptIpParam->unionIpParam.ptVsp;
+  if (par == NULL || par->dst_par == NULL || par->rpf_num < 1 ||
+      par->rpf_num > 4)
+    return R_VSPM_PARAERR;
+  src[0] = par->src1_par;
+  src[1] = par->src2_par;
+  src[2] = par->src3_par;
+  src[3] = par->src4_par;
+  for (i = 0; i < par->rpf_num; i++)
+    if (src[i] == NULL)
+      return R_VSPM_PARAERR;
+  if ((par->use_module & (VSP_UDS_USE | VSP_BRU_USE)) &&
+      par->ctrl_par == NULL)
+    return R_VSPM_PARAERR;
+  if ((par->use_module & VSP_UDS_USE) && par->ctrl_par->uds == NULL)
+    return R_VSPM_PARAERR;
+  if ((par->use_module & VSP_BRU_USE) && (par->ctrl_par->bru == NULL ||
+          par->ctrl_par->bru->blend_virtual == NULL))
+    return R_VSPM_PARAERR;
+
+  switch (ptIpParam->uhType) {
+    case VSPM_TYPE_VSP_CH0:
+      ch = &vspm->ch[0];
+      break;
+    case VSPM_TYPE_VSP_CH1:
+      ch = &vspm->ch[1];
+      break;
+    case VSPM_TYPE_VSP_AUTO:
+      ch = (vspm->ch[1].depth < vspm->ch[0].depth) ?
+          &vspm->ch[1] : &vspm->ch[0];
+      break;
+    default:
+      return R_VSPM_PARAERR;
+  }
+
+  job = calloc (1, sizeof (EmulJob));
+  if (job == NULL)
+    return R_VSPM_NG;
+  job->par = *par;
+  for (i = 0; i < par->rpf_num; i++) {
+    job->src[i] = *src[i];
+    if (src[i]->alpha_blend) {
+      job->alpha[i] = *src[i]->alpha_blend;
+      job->src[i].alpha_blend = &job->alpha[i];
+      if (job->alpha[i].mult) {
+        job->mult[i] = *job->alpha[i].mult;
+        job->alpha[i].mult = &job->mult[i];
+      }
+    }
+  }
+  job->dst = *par->dst_par;
+  if (par->use_module & VSP_UDS_USE)
+    job->uds = *par->ctrl_par->uds;
+  if (par->use_module & VSP_BRU_USE) {
+    job->bru = *par->ctrl_par->bru;
+    job->virt = *par->ctrl_par->bru->blend_virtual;
+  }
+  job->user_data = uwUserData;
+  job->cb = pfnNotifyComplete;
+
+  pthread_mutex_lock (&emul_id_lock);
+  job->id = emul_next_id++;
+  pthread_mutex_unlock (&emul_id_lock);
+  *puwJobId = job->id;
+
+  pthread_mutex_lock (&ch->lock);
+  if (ch->depth >= EMUL_QUEUE_MAX) {
+    pthread_mutex_unlock (&ch->lock);
+    free (job);
+    return R_VSPM_QUE_FULL;
+  }
+  ch->depth++;
+  if (ch->tail)
+    ch->tail->next = job;
+  else
+    ch->head = job;
+  ch->tail = job;
+  pthread_cond_signal (&ch->cond);
+  pthread_mutex_unlock (&ch->lock);
+
+  return R_VSPM_OK;
+}
@@ -0,0 +1,323 @@
+/* Software stand-in for libvspm
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The part of the VSPM API which the plugin uses, for builds with
+ * --enable-vspm-emulation. Names and fields follow the Renesas header,
+ * the values are only meaningful to vspm_emul.c */
+
+#ifndef __VSPM_PUBLIC_H__
+#define __VSPM_PUBLIC_H__
+
+/* return codes */
+#define R_VSPM_OK                   (0)
+#define R_VSPM_NG                   (-1)
+#define R_VSPM_PARAERR              (-2)
+#define R_VSPM_QUE_FULL             (-3)
+#define R_VSPM_ALREADY_USED         (-4)
+
+/* IP types of VSPM_IP_PAR */
+#define VSPM_TYPE_VSP_AUTO          (0x0000)
+#define VSPM_TYPE_VSP_CH0           (0x0001)
+#define VSPM_TYPE_VSP_CH1           (0x0002)
+
+/* use_module and connect */
+#define VSP_UDS_USE                 (0x0002)
+#define VSP_BRU_USE                 (0x0800)
+
+/* formats: bytes per pixel of the first plane in bits 8-11 */
+#define VSP_IN_RGB565               (0x0206)
+#define VSP_IN_RGB888               (0x0315)
+#define VSP_IN_BGR888               (0x0318)
+#define VSP_IN_ARGB8888             (0x0413)
+#define VSP_IN_ABGR8888             (0x0419)
+#define VSP_IN_RGBA8888             (0x0414)
+#define VSP_IN_YUV444_INTERLEAVED   (0x0340)
+#define VSP_IN_YUV422_INT0_YUY2     (0x0247)
+#define VSP_IN_YUV422_INT0_UYVY     (0x0248)
+#define VSP_IN_YUV422_INT0_YVYU     (0x0249)
+#define VSP_IN_YUV444_SEMI_PLANAR   (0x0141)
+#define VSP_IN_YUV422_SEMI_NV16     (0x0142)
+#define VSP_IN_YUV420_SEMI_NV12     (0x0143)
+#define VSP_IN_YUV420_SEMI_NV21     (0x0144)
+#define VSP_IN_YUV444_PLANAR        (0x014a)
+#define VSP_IN_YUV420_PLANAR        (0x014c)
+
+#define VSP_OUT_RGB565              (0x0206)
+#define VSP_OUT_RGB888              (0x0315)
+#define VSP_OUT_BGR888              (0x0318)
+#define VSP_OUT_PRGB8888            (0x0413)
+#define VSP_OUT_PBGR8888            (0x0419)
+#define VSP_OUT_RGBP8888            (0x0414)
+#define VSP_OUT_YUV444_INTERLEAVED  (0x0340)
+#define VSP_OUT_YUV422_INT0_YUY2    (0x0247)
+#define VSP_OUT_YUV422_INT0_UYVY    (0x0248)
+#define VSP_OUT_YUV422_INT0_YVYU    (0x0249)
+#define VSP_OUT_YUV444_SEMI_PLANAR  (0x0141)
+#define VSP_OUT_YUV422_SEMI_NV16    (0x0142)
+#define VSP_OUT_YUV420_SEMI_NV12    (0x0143)
+#define VSP_OUT_YUV420_SEMI_NV21    (0x0144)
+#define VSP_OUT_YUV444_PLANAR       (0x014a)
+#define VSP_OUT_YUV420_PLANAR       (0x014c)
+
+/* data swapping, in units of 8 bytes */
+#define VSP_SWAP_NO                 (0x00)
+#define VSP_SWAP_B                  (0x01)
+#define VSP_SWAP_W                  (0x02)
+#define VSP_SWAP_L                  (0x04)
+#define VSP_SWAP_LL                 (0x08)
+
+/* T_VSP_IN */
+#define VSP_LAYER_PARENT            (0x00)
+#define VSP_LAYER_CHILD             (0x01)
+#define VSP_CIPM_0_HOLD             (0x00)
+#define VSP_CEXT_EXPAN              (0x00)
+#define VSP_CSC_OFF                 (0x00)
+#define VSP_CSC_ON                  (0x01)
+#define VSP_ITURBT_601              (0x00)
+#define VSP_ITURBT_709              (0x01)
+#define VSP_ITU_COLOR               (0x00)
+#define VSP_FULL_COLOR              (0x01)
+#define VSP_NO_VIR                  (0x00)
+#define VSP_VIR                     (0x01)
+
+/* T_VSP_ALPHA */
+#define VSP_ALPHA_NO                (0x00)
+#define VSP_ALPHA_NUM1              (0x00)
+#define VSP_ALPHA_NUM5              (0x04)
+#define VSP_AEXT_EXPAN              (0x00)
+#define VSP_IROP_NOP                (0x00)
+#define VSP_MSKEN_ALPHA             (0x00)
+
+/* T_VSP_MULT */
+#define VSP_MULT_THROUGH            (0x00)
+#define VSP_MULT_RATIO              (0x01)
+
+/* T_VSP_OUT */
+#define VSP_PAD_P                   (0x00)
+#define VSP_PAD_IN                  (0x01)
+#define VSP_CSC_ROUND_DOWN          (0x00)
+#define VSP_CONVERSION_ROUNDDOWN    (0x00)
+#define VSP_CLMD_NO                 (0x00)
+#define VSP_NO_DITHER               (0x00)
+
+/* T_VSP_UDS */
+#define VSP_FMD_NO                  (0x00)
+#define VSP_AMD                     (0x01)
+#define VSP_CLIP_OFF                (0x00)
+#define VSP_ALPHA_ON                (0x01)
+#define VSP_COMPLEMENT_BIL          (0x00)
+#define VSP_COMPLEMENT_NN           (0x01)
+
+/* T_VSP_BRU, T_VSP_BLEND_CONTROL */
+#define VSP_LAY_NO                  (0x00)
+#define VSP_LAY_1                   (0x01)
+#define VSP_LAY_2                   (0x02)
+#define VSP_LAY_3                   (0x03)
+#define VSP_LAY_4                   (0x04)
+#define VSP_LAY_VIRTUAL             (0x05)
+#define VSP_DIVISION_OFF            (0x00)
+#define VSP_RBC_BLEND               (0x00)
+#define VSP_FORM_BLEND0             (0x00)
+#define VSP_FORM_ALPHA0             (0x00)
+#define VSP_COEFFICIENT_BLENDX4     (0x04)
+#define VSP_COEFFICIENT_BLENDY5     (0x05)
+#define VSP_COEFFICIENT_ALPHAX5     (0x05)
+#define VSP_COEFFICIENT_ALPHAY5     (0x05)
+
+typedef struct {
+  unsigned char p_mmd;
+  unsigned char a_mmd;
+  unsigned char ratio;
+} T_VSP_MULT;
+
+typedef struct {
+  void *addr_a;
+  unsigned char alphan;
+  unsigned long alpha1;
+  unsigned long alpha2;
+  unsigned short astride;
+  unsigned char aswap;
+  unsigned char asel;
+  unsigned char aext;
+  unsigned char anum0;
+  unsigned char anum1;
+  unsigned char afix;
+  unsigned char irop;
+  unsigned char msken;
+  unsigned char bsel;
+  unsigned long mgcolor;
+  unsigned long mscolor0;
+  unsigned long mscolor1;
+  T_VSP_MULT *mult;
+} T_VSP_ALPHA;
+
+typedef struct T_VSP_OSDLUT T_VSP_OSDLUT;
+typedef struct T_VSP_CLRCNV T_VSP_CLRCNV;
+
+typedef struct {
+  void *addr;
+  void *addr_c0;
+  void *addr_c1;
+  unsigned short stride;
+  unsigned short stride_c;
+  unsigned short width;
+  unsigned short height;
+  unsigned short width_ex;
+  unsigned short height_ex;
+  unsigned short x_offset;
+  unsigned short y_offset;
+  unsigned short format;
+  unsigned char swap;
+  unsigned short x_position;
+  unsigned short y_position;
+  unsigned char pwd;
+  unsigned char cipm;
+  unsigned char cext;
+  unsigned char csc;
+  unsigned char iturbt;
+  unsigned char clrcng;
+  unsigned char vir;
+  unsigned long vircolor;
+  T_VSP_OSDLUT *osd_lut;
+  T_VSP_ALPHA *alpha_blend;
+  T_VSP_CLRCNV *clrcnv;
+  unsigned long connect;
+} T_VSP_IN;
+
+typedef struct {
+  void *addr;
+  void *addr_c0;
+  void *addr_c1;
+  unsigned short stride;
+  unsigned short stride_c;
+  unsigned short width;
+  unsigned short height;
+  unsigned short x_offset;
+  unsigned short y_offset;
+  unsigned short format;
+  unsigned char swap;
+  unsigned char pxa;
+  unsigned char pad;
+  unsigned short x_coffset;
+  unsigned short y_coffset;
+  unsigned char csc;
+  unsigned char iturbt;
+  unsigned char clrcng;
+  unsigned char cbrm;
+  unsigned char abrm;
+  unsigned char athres;
+  unsigned char clmd;
+  unsigned char dith;
+} T_VSP_OUT;
+
+typedef struct {
+  unsigned char fmd;
+  unsigned long filcolor;
+  unsigned char amd;
+  unsigned char clip;
+  unsigned char alpha;
+  unsigned char complement;
+  unsigned char athres0;
+  unsigned char athres1;
+  unsigned char anum0;
+  unsigned char anum1;
+  unsigned char anum2;
+  unsigned short x_ratio;
+  unsigned short y_ratio;
+  unsigned short out_cwidth;
+  unsigned short out_cheight;
+  unsigned long connect;
+} T_VSP_UDS;
+
+typedef struct {
+  unsigned short width;
+  unsigned short height;
+  unsigned short x_position;
+  unsigned short y_position;
+  unsigned char pwd;
+  unsigned long color;
+} T_VSP_BLEND_VIRTUAL;
+
+typedef struct {
+  unsigned char rbc;
+  unsigned char crop;
+  unsigned char arop;
+  unsigned char blend_formula;
+  unsigned char blend_coefx;
+  unsigned char blend_coefy;
+  unsigned char aformula;
+  unsigned char acoefx;
+  unsigned char acoefy;
+  unsigned char acoefx_fix;
+  unsigned char acoefy_fix;
+} T_VSP_BLEND_CONTROL;
+
+typedef struct {
+  unsigned long lay_order;
+  unsigned char adiv;
+  T_VSP_BLEND_VIRTUAL *blend_virtual;
+  T_VSP_BLEND_CONTROL *blend_unit_a;
+  T_VSP_BLEND_CONTROL *blend_unit_b;
+  T_VSP_BLEND_CONTROL *blend_unit_c;
+  T_VSP_BLEND_CONTROL *blend_unit_d;
+  T_VSP_BLEND_CONTROL *blend_unit_e;
+  unsigned long connect;
+} T_VSP_BRU;
+
+typedef struct {
+  void *sru;
+  T_VSP_UDS *uds;
+  void *lut;
+  void *clu;
+  void *hst;
+  void *hsi;
+  T_VSP_BRU *bru;
+  void *hgo;
+  void *hgt;
+} T_VSP_CTRL;
+
+typedef struct {
+  unsigned char rpf_num;
+  unsigned long use_module;
+  T_VSP_IN *src1_par;
+  T_VSP_IN *src2_par;
+  T_VSP_IN *src3_par;
+  T_VSP_IN *src4_par;
+  T_VSP_OUT *dst_par;
+  T_VSP_CTRL *ctrl_par;
+} VSPM_VSP_PAR;
+
+typedef struct {
+  unsigned short uhType;
+  union {
+    VSPM_VSP_PAR *ptVsp;
+    void *ptFdp;
+  } unionIpParam;
+} VSPM_IP_PAR;
+
+typedef void (*PFN_VSPM_COMPLETE_CALLBACK) (unsigned long uwJobId,
+    long wResult, unsigned long uwUserData);
+
+long VSPM_lib_DriverInitialize (unsigned long *handle);
+long VSPM_lib_DriverQuit (unsigned long handle);
+long VSPM_lib_Entry (unsigned long handle, unsigned long *puwJobId,
+    char bJobPriority, VSPM_IP_PAR *ptIpParam, unsigned long uwUserData,
+    PFN_VSPM_COMPLETE_CALLBACK pfnNotifyComplete);
+
+#endif /* __VSPM_PUBLIC_H__ */
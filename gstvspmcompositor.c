@@ -0,0 +1,1061 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:element-vspmcompositor
+ *
+ * Blend up to four video streams in a single VSP job, one stream per RPF
+ * input. Each sink pad has xpos/ypos/width/height/alpha/zorder properties;
+ * a layer whose width/height differ from its input is scaled by the VSP
+ * first.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 vspmcompositor name=c sink_1::xpos=1280 sink_1::ypos=720 \
+ *     sink_1::width=640 sink_1::height=360 ! video/x-raw,format=BGRA ! waylandsink \
+ *     videotestsrc ! video/x-raw,width=1920,height=1080 ! c. \
+ *     videotestsrc pattern=ball ! video/x-raw,width=1920,height=1080 ! c.
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "gstvspmcompositor.h"
+
+#include <string.h>
+
+#include "mmngr_user_public.h"
+
+GST_DEBUG_CATEGORY_STATIC (vspmcompositor_debug);
+#define GST_CAT_DEFAULT vspmcompositor_debug
+
+#define DEFAULT_PAD_XPOS   0
+#define DEFAULT_PAD_YPOS   0
+#define DEFAULT_PAD_WIDTH  0
+#define DEFAULT_PAD_HEIGHT 0
+#define DEFAULT_PAD_ALPHA  1.0
+#define DEFAULT_BACKGROUND 0xff000000
+
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_XPOS,
+  PROP_PAD_YPOS,
+  PROP_PAD_WIDTH,
+  PROP_PAD_HEIGHT,
+  PROP_PAD_ALPHA
+};
+
+enum
+{
+  PROP_0,
+  PROP_BACKGROUND
+};
+
+G_DEFINE_TYPE (GstVspmCompositorPad, gst_vspm_compositor_pad,
+    GST_TYPE_VIDEO_AGGREGATOR_PAD);
+#define gst_vspm_compositor_parent_class parent_class
+G_DEFINE_TYPE (GstVspmCompositor, gst_vspm_compositor,
+    GST_TYPE_VIDEO_AGGREGATOR);
+
+static void
+gst_vspm_compositor_scaled_free (GstVspmCompositorScaled * scaled)
+{
+  if (scaled->mmng_pid >= 0) {
+    mmngr_free_in_user (scaled->mmng_pid);
+    scaled->mmng_pid = -1;
+  }
+}
+
+static void
+gst_vspm_compositor_pad_bounce_clear (GstVspmCompositorPad * cpad)
+{
+  if (cpad->bounce_pool) {
+    gst_buffer_pool_set_active (cpad->bounce_pool, FALSE);
+    gst_object_unref (cpad->bounce_pool);
+    cpad->bounce_pool = NULL;
+  }
+}
+
+static void
+gst_vspm_compositor_pad_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVspmCompositorPad *pad = GST_VSPM_COMPOSITOR_PAD (object);
+
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+      g_value_set_int (value, pad->xpos);
+      break;
+    case PROP_PAD_YPOS:
+      g_value_set_int (value, pad->ypos);
+      break;
+    case PROP_PAD_WIDTH:
+      g_value_set_int (value, pad->width);
+      break;
+    case PROP_PAD_HEIGHT:
+      g_value_set_int (value, pad->height);
+      break;
+    case PROP_PAD_ALPHA:
+      g_value_set_double (value, pad->alpha);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vspm_compositor_pad_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVspmCompositorPad *pad = GST_VSPM_COMPOSITOR_PAD (object);
+
+  GST_OBJECT_LOCK (pad);
+  switch (prop_id) {
+    case PROP_PAD_XPOS:
+      pad->xpos = g_value_get_int (value);
+      break;
+    case PROP_PAD_YPOS:
+      pad->ypos = g_value_get_int (value);
+      break;
+    case PROP_PAD_WIDTH:
+      pad->width = g_value_get_int (value);
+      break;
+    case PROP_PAD_HEIGHT:
+      pad->height = g_value_get_int (value);
+      break;
+    case PROP_PAD_ALPHA:
+      pad->alpha = g_value_get_double (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+  GST_OBJECT_UNLOCK (pad);
+}
+
+static void
+gst_vspm_compositor_pad_finalize (GObject * object)
+{
+  GstVspmCompositorPad *pad = GST_VSPM_COMPOSITOR_PAD (object);
+
+  gst_vspm_compositor_scaled_free (&pad->scaled);
+  gst_vspm_compositor_pad_bounce_clear (pad);
+
+  G_OBJECT_CLASS (gst_vspm_compositor_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_vspm_compositor_pad_class_init (GstVspmCompositorPadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->set_property = gst_vspm_compositor_pad_set_property;
+  gobject_class->get_property = gst_vspm_compositor_pad_get_property;
+  gobject_class->finalize = gst_vspm_compositor_pad_finalize;
+
+  g_object_class_install_property (gobject_class, PROP_PAD_XPOS,
+      g_param_spec_int ("xpos", "X Position", "X position of the layer",
+          G_MININT, G_MAXINT, DEFAULT_PAD_XPOS,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_YPOS,
+      g_param_spec_int ("ypos", "Y Position", "Y position of the layer",
+          G_MININT, G_MAXINT, DEFAULT_PAD_YPOS,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_WIDTH,
+      g_param_spec_int ("width", "Width",
+          "Width of the layer, scaled by the VSP (0 = input width)",
+          0, G_MAXINT, DEFAULT_PAD_WIDTH,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_HEIGHT,
+      g_param_spec_int ("height", "Height",
+          "Height of the layer, scaled by the VSP (0 = input height)",
+          0, G_MAXINT, DEFAULT_PAD_HEIGHT,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_PAD_ALPHA,
+      g_param_spec_double ("alpha", "Alpha", "Alpha of the layer",
+          0.0, 1.0, DEFAULT_PAD_ALPHA,
+          G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_vspm_compositor_pad_init (GstVspmCompositorPad * pad)
+{
+  pad->xpos = DEFAULT_PAD_XPOS;
+  pad->ypos = DEFAULT_PAD_YPOS;
+  pad->width = DEFAULT_PAD_WIDTH;
+  pad->height = DEFAULT_PAD_HEIGHT;
+  pad->alpha = DEFAULT_PAD_ALPHA;
+  pad->scaled.mmng_pid = -1;
+}
+
+/* Size of the layer on the output, with the object lock of the pad held */
+static void
+gst_vspm_compositor_pad_get_output_size (GstVspmCompositorPad * cpad,
+    gint * width, gint * height)
+{
+  GstVideoAggregatorPad *vpad = GST_VIDEO_AGGREGATOR_PAD (cpad);
+
+  *width = cpad->width > 0 ? cpad->width : GST_VIDEO_INFO_WIDTH (&vpad->info);
+  *height =
+      cpad->height > 0 ? cpad->height : GST_VIDEO_INFO_HEIGHT (&vpad->info);
+}
+
+/* callback function */
+static void
+gst_vspm_compositor_cb (unsigned long uwJobId, long wResult,
+    unsigned long uwUserData)
+{
+  GstVspmCompositor *comp = (GstVspmCompositor *) uwUserData;
+
+  if (wResult != 0) {
+    GST_ERROR ("VSPM: error end. (%ld)\n", wResult);
+  }
+  comp->result = wResult;
+  sem_post (&comp->smp_wait);
+}
+
+static gboolean
+gst_vspm_compositor_run (GstVspmCompositor * comp, VSPM_VSP_PAR * vsp_par)
+{
+  VSPM_IP_PAR vspm_ip;
+  unsigned long jobid;
+  long ercd;
+
+  memset (&vspm_ip, 0, sizeof (VSPM_IP_PAR));
+  vspm_ip.uhType             = VSPM_TYPE_VSP_AUTO;
+  vspm_ip.unionIpParam.ptVsp = vsp_par;
+
+  ercd = VSPM_lib_Entry (comp->vspm_handle, &jobid, 126, &vspm_ip,
+      (unsigned long) comp, gst_vspm_compositor_cb);
+  if (ercd) {
+    GST_ERROR_OBJECT (comp, "VSPM_lib_Entry() Failed!! ercd=%ld", ercd);
+    return FALSE;
+  }
+
+  /* Wait for callback */
+  sem_wait (&comp->smp_wait);
+
+  return comp->result == 0;
+}
+
+/* Alpha of a layer: the one of its pixels for the formats which have one,
+ * scaled by the alpha of the pad, else the alpha of the pad alone */
+static void
+gst_vspm_compositor_set_alpha (T_VSP_ALPHA * alpha_par, T_VSP_MULT * mult_par,
+    const GstVideoFormatInfo * finfo, gdouble alpha)
+{
+  unsigned char afix = (unsigned char) (alpha * 255);
+
+  if (!GST_VIDEO_FORMAT_INFO_HAS_ALPHA (finfo)) {
+    alpha_par->afix = afix;
+    return;
+  }
+
+  alpha_par->asel = VSP_ALPHA_NUM1;
+  if (afix < 0xff) {
+    memset (mult_par, 0, sizeof (T_VSP_MULT));
+    mult_par->p_mmd = VSP_MULT_THROUGH;
+    mult_par->a_mmd = VSP_MULT_RATIO;
+    mult_par->ratio = afix;
+    alpha_par->mult = mult_par;
+  }
+}
+
+/* Scale a layer into the intermediate buffer of its pad. The RPF can not
+ * scale by itself and the blending pipe has no UDS, so this is a job of
+ * its own */
+static gboolean
+gst_vspm_compositor_scale_layer (GstVspmCompositor * comp,
+    GstVspmCompositorPad * cpad, GstVideoFrame * frame, void *src_addr[3],
+    gint width, gint height)
+{
+  GstVspmCompositorScaled *scaled = &cpad->scaled;
+  GstVideoFormat format = GST_VIDEO_FRAME_FORMAT (frame);
+  gint in_width = GST_VIDEO_FRAME_WIDTH (frame);
+  gint in_height = GST_VIDEO_FRAME_HEIGHT (frame);
+  VSPM_VSP_PAR vsp_par;
+  T_VSP_IN src_par;
+  T_VSP_ALPHA src_alpha_par;
+  T_VSP_MULT mult_par;
+  T_VSP_OUT dst_par;
+  T_VSP_CTRL ctrl_par;
+  T_VSP_UDS uds_par;
+  guint in_format, in_swap, out_format, out_swap;
+  void *dst_addr[3] = { 0 };
+  GstVideoInfo info;
+  guint i;
+
+  if (gst_vspm_set_colorspace (format, &in_format, &in_swap) ||
+      gst_vspm_set_colorspace_output (format, &out_format, &out_swap)) {
+    GST_ERROR_OBJECT (cpad, "format %s is non-support for scaling",
+        gst_video_format_to_string (format));
+    return FALSE;
+  }
+
+  /* (Re)allocate the intermediate buffer when the layer changed */
+  if (scaled->mmng_pid < 0 || scaled->info.format != format ||
+      scaled->info.width != width || scaled->info.height != height) {
+    gst_vspm_compositor_scaled_free (scaled);
+
+    gst_video_info_set_format (&info, format, width, height);
+    gst_vspm_filter_set_buffer_info (&scaled->info, &info, NULL);
+    if (R_MM_OK != mmngr_alloc_in_user (&scaled->mmng_pid,
+                                        scaled->info.outbuf_size,
+                                        &scaled->pphy_addr,
+                                        &scaled->phard_addr,
+                                        &scaled->puser_virt_addr,
+                                        MMNGR_VA_SUPPORT_CACHED)) {
+      GST_ERROR_OBJECT (cpad,
+          "mmngr_alloc_in_user failed to allocate memory (%d)",
+          scaled->info.outbuf_size);
+      scaled->mmng_pid = -1;
+      return FALSE;
+    }
+  }
+
+  for (i = 0; i < scaled->info.n_planes; i++)
+    dst_addr[i] = (void *) (scaled->phard_addr + scaled->info.plane_offset[i]);
+
+  gst_vspm_init_in_par (&src_par, &src_alpha_par, src_addr,
+      GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0),
+      GST_VIDEO_FRAME_PLANE_STRIDE (frame, 1),
+      in_width, in_height, in_format, in_swap);
+  src_par.connect = VSP_UDS_USE;
+  /* the alpha of the pad is applied when blending */
+  gst_vspm_compositor_set_alpha (&src_alpha_par, &mult_par, frame->info.finfo,
+      1.0);
+
+  gst_vspm_init_out_par (&dst_par, dst_addr,
+      scaled->info.plane_stride[0], scaled->info.plane_stride[1],
+      width, height, out_format, out_swap);
+
+  memset (&uds_par, 0, sizeof (T_VSP_UDS));
+  uds_par.fmd          = VSP_FMD_NO;
+  uds_par.amd          = VSP_AMD;
+  uds_par.clip         = VSP_CLIP_OFF;
+  uds_par.alpha        = VSP_ALPHA_ON;
+  uds_par.complement   = VSP_COMPLEMENT_BIL;
+  /* in range, the caller checked it with gst_vspm_uds_fits */
+  uds_par.x_ratio      = (unsigned short)( (in_width << 12) / width );
+  uds_par.y_ratio      = (unsigned short)( (in_height << 12) / height );
+  uds_par.out_cwidth   = (unsigned short)width;
+  uds_par.out_cheight  = (unsigned short)height;
+
+  memset (&ctrl_par, 0, sizeof (T_VSP_CTRL));
+  ctrl_par.uds = &uds_par;
+
+  memset (&vsp_par, 0, sizeof (VSPM_VSP_PAR));
+  vsp_par.rpf_num      = 1;
+  vsp_par.use_module   = VSP_UDS_USE;
+  vsp_par.src1_par     = &src_par;
+  vsp_par.dst_par      = &dst_par;
+  vsp_par.ctrl_par     = &ctrl_par;
+
+  return gst_vspm_compositor_run (comp, &vsp_par);
+}
+
+/* Copy a layer the VSP can not address to an mmngr buffer of the pad, set
+ * up again when the layer caps change. bounce is left mapped and addr
+ * holds its plane addresses */
+static gboolean
+gst_vspm_compositor_pad_bounce_in (GstVspmCompositor * comp,
+    GstVspmCompositorPad * cpad, GstVideoFrame * frame,
+    GstVideoFrame * bounce, void *addr[3])
+{
+  GstStructure *config;
+  GstCaps *caps;
+  GstBuffer *buf = NULL;
+  guint i;
+
+  if (cpad->bounce_pool &&
+      !gst_video_info_is_equal (&cpad->bounce_info, &frame->info))
+    gst_vspm_compositor_pad_bounce_clear (cpad);
+
+  if (cpad->bounce_pool == NULL) {
+    cpad->bounce_info = frame->info;
+    cpad->bounce_pool =
+        gst_vspmfilter_buffer_pool_new (GST_ELEMENT (comp), FALSE);
+    caps = gst_video_info_to_caps (&cpad->bounce_info);
+    config = gst_buffer_pool_get_config (cpad->bounce_pool);
+    gst_buffer_pool_config_set_params (config, caps,
+        GST_VIDEO_INFO_SIZE (&cpad->bounce_info), 0, 0);
+    gst_caps_unref (caps);
+    if (!gst_buffer_pool_set_config (cpad->bounce_pool, config) ||
+        !gst_buffer_pool_set_active (cpad->bounce_pool, TRUE)) {
+      GST_WARNING_OBJECT (cpad, "failed to set up the bounce pool");
+      gst_vspm_compositor_pad_bounce_clear (cpad);
+      return FALSE;
+    }
+  }
+
+  if (gst_buffer_pool_acquire_buffer (cpad->bounce_pool, &buf, NULL) !=
+      GST_FLOW_OK)
+    return FALSE;
+  if (!gst_video_frame_map (bounce, &cpad->bounce_info, buf,
+          GST_MAP_READWRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  /* the frame holds its own reference */
+  gst_buffer_unref (buf);
+
+  if (!gst_video_frame_copy (bounce, frame))
+    goto error;
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (bounce); i++) {
+    addr[i] = gst_vspm_frame_plane_address (comp->mmngr_fd, bounce, i);
+    if (!addr[i])
+      goto error;
+  }
+
+  GST_LOG_OBJECT (cpad, "layer staged in bounce buffer %p", bounce->buffer);
+
+  return TRUE;
+
+error:
+  gst_video_frame_unmap (bounce);
+  return FALSE;
+}
+
+/* A sink pad as aggregate_frames found it, taken under the object lock so
+ * that the imports and the jobs run without it */
+typedef struct {
+  GstVspmCompositorPad *cpad;
+  GstVideoFrame *frame;
+  gint xpos, ypos;
+  gint width, height;
+  gdouble alpha;
+  /* mapped until the blending job is done */
+  GstVideoFrame bounce;
+  gboolean bounced;
+} GstVspmCompositorLayer;
+
+/* Fill the output with the background colour when no layer is to be
+ * blended: an RPF in virtual mode generates it, no memory is read */
+static gboolean
+gst_vspm_compositor_fill_background (GstVspmCompositor * comp,
+    guint background, void *dst_addr[3], GstVideoFrame * out_frame,
+    guint out_format, guint out_swap)
+{
+  VSPM_VSP_PAR vsp_par;
+  T_VSP_IN src_par;
+  T_VSP_ALPHA src_alpha_par;
+  T_VSP_OUT dst_par;
+  T_VSP_CTRL ctrl_par;
+  void *src_addr[3] = { 0 };
+  guint in_format, in_swap;
+
+  gst_vspm_set_colorspace (GST_VIDEO_FORMAT_ARGB, &in_format, &in_swap);
+  gst_vspm_init_in_par (&src_par, &src_alpha_par, src_addr, 0, 0,
+      GST_VIDEO_FRAME_WIDTH (out_frame), GST_VIDEO_FRAME_HEIGHT (out_frame),
+      in_format, in_swap);
+  src_par.vir          = VSP_VIR;
+  src_par.vircolor     = background;
+  src_alpha_par.asel   = VSP_ALPHA_NUM1;
+
+  gst_vspm_init_out_par (&dst_par, dst_addr,
+      GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0),
+      GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 1),
+      GST_VIDEO_FRAME_WIDTH (out_frame), GST_VIDEO_FRAME_HEIGHT (out_frame),
+      out_format, out_swap);
+  dst_par.csc = GST_VIDEO_FORMAT_INFO_IS_YUV (out_frame->info.finfo) ?
+      VSP_CSC_ON : VSP_CSC_OFF;
+
+  memset (&ctrl_par, 0, sizeof (T_VSP_CTRL));
+
+  memset (&vsp_par, 0, sizeof (VSPM_VSP_PAR));
+  vsp_par.rpf_num      = 1;
+  vsp_par.use_module   = 0;
+  vsp_par.src1_par     = &src_par;
+  vsp_par.dst_par      = &dst_par;
+  vsp_par.ctrl_par     = &ctrl_par;
+
+  return gst_vspm_compositor_run (comp, &vsp_par);
+}
+
+static GstFlowReturn
+gst_vspm_compositor_aggregate_frames (GstVideoAggregator * vagg,
+    GstBuffer * outbuf)
+{
+  static const unsigned long lay[VSPM_COMPOSITOR_MAX_LAYERS] = {
+    VSP_LAY_1, VSP_LAY_2, VSP_LAY_3, VSP_LAY_4
+  };
+  GstVspmCompositor *comp = GST_VSPM_COMPOSITOR (vagg);
+  GstVideoFrame out_frame;
+  VSPM_VSP_PAR vsp_par;
+  T_VSP_IN src_par[VSPM_COMPOSITOR_MAX_LAYERS];
+  T_VSP_ALPHA src_alpha_par[VSPM_COMPOSITOR_MAX_LAYERS];
+  T_VSP_MULT mult_par[VSPM_COMPOSITOR_MAX_LAYERS];
+  T_VSP_BLEND_CONTROL blend_par[VSPM_COMPOSITOR_MAX_LAYERS];
+  T_VSP_BLEND_CONTROL *blend_unit[VSPM_COMPOSITOR_MAX_LAYERS] = { NULL, };
+  T_VSP_IN *src[VSPM_COMPOSITOR_MAX_LAYERS] = { NULL, };
+  T_VSP_BLEND_VIRTUAL virt_par;
+  T_VSP_BRU bru_par;
+  T_VSP_OUT dst_par;
+  T_VSP_CTRL ctrl_par;
+  void *dst_addr[3] = { 0 };
+  guint out_format, out_swap;
+  gint out_width, out_height;
+  GArray *snapshot = NULL;
+  guint background;
+  guint n_layers = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+  GList *l;
+  guint i, j;
+
+  if (!gst_video_frame_map (&out_frame, &vagg->info, outbuf, GST_MAP_WRITE))
+    return GST_FLOW_ERROR;
+
+  out_width = GST_VIDEO_FRAME_WIDTH (&out_frame);
+  out_height = GST_VIDEO_FRAME_HEIGHT (&out_frame);
+
+  if (gst_vspm_set_colorspace_output (GST_VIDEO_FRAME_FORMAT (&out_frame),
+          &out_format, &out_swap)) {
+    GST_ERROR_OBJECT (comp, "output format is non-support.");
+    ret = GST_FLOW_NOT_NEGOTIATED;
+    goto done;
+  }
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&out_frame); i++) {
+    dst_addr[i] = gst_vspm_frame_plane_address (comp->mmngr_fd, &out_frame, i);
+    if (!dst_addr[i]) {
+      GST_ERROR_OBJECT (comp,
+          "Can not find physical address of output buffer for planar %u", i + 1);
+      ret = GST_FLOW_ERROR;
+      goto done;
+    }
+  }
+
+  /* sink pads are kept sorted by zorder. The prepared frames stay valid
+   * until aggregate_frames returns */
+  snapshot = g_array_new (FALSE, FALSE, sizeof (GstVspmCompositorLayer));
+  GST_OBJECT_LOCK (vagg);
+  background = comp->background;
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *vpad = l->data;
+    GstVspmCompositorPad *cpad = GST_VSPM_COMPOSITOR_PAD (vpad);
+    GstVspmCompositorLayer layer;
+
+    layer.frame = gst_video_aggregator_pad_get_prepared_frame (vpad);
+    if (layer.frame == NULL)
+      continue;
+
+    GST_OBJECT_LOCK (cpad);
+    gst_vspm_compositor_pad_get_output_size (cpad, &layer.width,
+        &layer.height);
+    layer.xpos = cpad->xpos;
+    layer.ypos = cpad->ypos;
+    layer.alpha = cpad->alpha;
+    GST_OBJECT_UNLOCK (cpad);
+    layer.bounced = FALSE;
+
+    if (layer.alpha == 0.0)
+      continue;
+
+    layer.cpad = gst_object_ref (cpad);
+    g_array_append_val (snapshot, layer);
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  for (j = 0; j < snapshot->len && n_layers < VSPM_COMPOSITOR_MAX_LAYERS;
+      j++) {
+    GstVspmCompositorLayer *layer =
+        &g_array_index (snapshot, GstVspmCompositorLayer, j);
+    GstVspmCompositorPad *cpad = layer->cpad;
+    GstVideoFrame *frame = layer->frame;
+    void *addr[3] = { 0 };
+    gint stride, stride_c;
+    gint width = layer->width, height = layer->height;
+    gint xpos = layer->xpos, ypos = layer->ypos;
+    gint x_offset = 0, y_offset = 0;
+    guint format, swap;
+
+    if (gst_vspm_set_colorspace (GST_VIDEO_FRAME_FORMAT (frame), &format,
+            &swap))
+      continue;
+
+    for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (frame); i++) {
+      addr[i] = gst_vspm_frame_plane_address (comp->mmngr_fd, frame, i);
+      if (!addr[i])
+        break;
+    }
+    if (i < GST_VIDEO_FRAME_N_PLANES (frame)) {
+      if (!gst_vspm_compositor_pad_bounce_in (comp, cpad, frame,
+              &layer->bounce, addr)) {
+        GST_ELEMENT_ERROR (comp, RESOURCE, FAILED, (NULL),
+            ("Could not copy the layer of %s to an mmngr buffer",
+                GST_PAD_NAME (cpad)));
+        ret = GST_FLOW_ERROR;
+        break;
+      }
+      layer->bounced = TRUE;
+      frame = &layer->bounce;
+    }
+    stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+    stride_c = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 1);
+
+    if (width != GST_VIDEO_FRAME_WIDTH (frame) ||
+        height != GST_VIDEO_FRAME_HEIGHT (frame)) {
+      if (!gst_vspm_uds_fits (GST_VIDEO_FRAME_WIDTH (frame),
+              GST_VIDEO_FRAME_HEIGHT (frame), width, height)) {
+        GST_WARNING_OBJECT (cpad, "skipping layer, can not scale %dx%d to "
+            "%dx%d", GST_VIDEO_FRAME_WIDTH (frame),
+            GST_VIDEO_FRAME_HEIGHT (frame), width, height);
+        continue;
+      }
+      if (!gst_vspm_compositor_scale_layer (comp, cpad, frame, addr,
+              width, height)) {
+        ret = GST_FLOW_ERROR;
+        break;
+      }
+      for (i = 0; i < cpad->scaled.info.n_planes; i++)
+        addr[i] = (void *) (cpad->scaled.phard_addr +
+            cpad->scaled.info.plane_offset[i]);
+      stride = cpad->scaled.info.plane_stride[0];
+      stride_c = cpad->scaled.info.plane_stride[1];
+    }
+
+    /* Clip the layer to the output, cropping its source when it starts
+     * outside */
+    if (xpos < 0) {
+      x_offset = -xpos;
+      width += xpos;
+      xpos = 0;
+    }
+    if (ypos < 0) {
+      y_offset = -ypos;
+      height += ypos;
+      ypos = 0;
+    }
+    width = MIN (width, out_width - xpos);
+    height = MIN (height, out_height - ypos);
+    if (width <= 0 || height <= 0)
+      continue;
+
+    gst_vspm_init_in_par (&src_par[n_layers],
+        &src_alpha_par[n_layers], addr, stride, stride_c, width, height,
+        format, swap);
+    src_par[n_layers].x_offset   = x_offset;
+    src_par[n_layers].y_offset   = y_offset;
+    src_par[n_layers].x_position = xpos;
+    src_par[n_layers].y_position = ypos;
+    src_par[n_layers].pwd        = VSP_LAYER_CHILD;
+    /* blending is done in RGB */
+    src_par[n_layers].csc        =
+        GST_VIDEO_FORMAT_INFO_IS_YUV (frame->info.finfo) ?
+        VSP_CSC_ON : VSP_CSC_OFF;
+    src_par[n_layers].connect    = VSP_BRU_USE;
+    gst_vspm_compositor_set_alpha (&src_alpha_par[n_layers],
+        &mult_par[n_layers], frame->info.finfo, layer->alpha);
+
+    memset (&blend_par[n_layers], 0, sizeof (T_VSP_BLEND_CONTROL));
+    blend_par[n_layers].rbc           = VSP_RBC_BLEND;
+    blend_par[n_layers].crop          = VSP_IROP_NOP;
+    blend_par[n_layers].arop          = VSP_IROP_NOP;
+    blend_par[n_layers].blend_formula = VSP_FORM_BLEND0;
+    blend_par[n_layers].blend_coefx   = VSP_COEFFICIENT_BLENDX4;
+    blend_par[n_layers].blend_coefy   = VSP_COEFFICIENT_BLENDY5;
+    blend_par[n_layers].aformula      = VSP_FORM_ALPHA0;
+    blend_par[n_layers].acoefx        = VSP_COEFFICIENT_ALPHAX5;
+    blend_par[n_layers].acoefy        = VSP_COEFFICIENT_ALPHAY5;
+
+    src[n_layers] = &src_par[n_layers];
+    blend_unit[n_layers] = &blend_par[n_layers];
+    n_layers++;
+  }
+
+  if (ret != GST_FLOW_OK)
+    goto done;
+
+  if (n_layers == 0) {
+    /* nothing to blend, the frame is all background */
+    if (!gst_vspm_compositor_fill_background (comp, background, dst_addr,
+            &out_frame, out_format, out_swap))
+      ret = GST_FLOW_ERROR;
+    goto done;
+  }
+
+  /* The background is the virtual layer at the bottom */
+  memset (&virt_par, 0, sizeof (T_VSP_BLEND_VIRTUAL));
+  virt_par.width         = out_width;
+  virt_par.height        = out_height;
+  virt_par.pwd           = VSP_LAYER_PARENT;
+  virt_par.color         = background;
+
+  memset (&bru_par, 0, sizeof (T_VSP_BRU));
+  bru_par.lay_order      = VSP_LAY_VIRTUAL;
+  for (i = 0; i < n_layers; i++)
+    bru_par.lay_order   |= lay[i] << (4 * (i + 1));
+  bru_par.adiv           = VSP_DIVISION_OFF;
+  bru_par.blend_virtual  = &virt_par;
+  bru_par.blend_unit_a   = blend_unit[0];
+  bru_par.blend_unit_b   = blend_unit[1];
+  bru_par.blend_unit_c   = blend_unit[2];
+  bru_par.blend_unit_d   = blend_unit[3];
+  bru_par.connect        = 0;
+
+  memset (&ctrl_par, 0, sizeof (T_VSP_CTRL));
+  ctrl_par.bru = &bru_par;
+
+  gst_vspm_init_out_par (&dst_par, dst_addr,
+      GST_VIDEO_FRAME_PLANE_STRIDE (&out_frame, 0),
+      GST_VIDEO_FRAME_PLANE_STRIDE (&out_frame, 1),
+      out_width, out_height, out_format, out_swap);
+  dst_par.csc = GST_VIDEO_FORMAT_INFO_IS_YUV (out_frame.info.finfo) ?
+      VSP_CSC_ON : VSP_CSC_OFF;
+
+  memset (&vsp_par, 0, sizeof (VSPM_VSP_PAR));
+  vsp_par.rpf_num        = n_layers;
+  vsp_par.use_module     = VSP_BRU_USE;
+  vsp_par.src1_par       = src[0];
+  vsp_par.src2_par       = src[1];
+  vsp_par.src3_par       = src[2];
+  vsp_par.src4_par       = src[3];
+  vsp_par.dst_par        = &dst_par;
+  vsp_par.ctrl_par       = &ctrl_par;
+
+  if (!gst_vspm_compositor_run (comp, &vsp_par))
+    ret = GST_FLOW_ERROR;
+
+done:
+  if (snapshot) {
+    for (j = 0; j < snapshot->len; j++) {
+      GstVspmCompositorLayer *layer =
+          &g_array_index (snapshot, GstVspmCompositorLayer, j);
+
+      if (layer->bounced)
+        gst_video_frame_unmap (&layer->bounce);
+      gst_object_unref (layer->cpad);
+    }
+    g_array_free (snapshot, TRUE);
+  }
+  gst_video_frame_unmap (&out_frame);
+
+  return ret;
+}
+
+/* Output size covering all the layers, as the software compositor does */
+static GstCaps *
+gst_vspm_compositor_fixate_src_caps (GstAggregator * agg, GstCaps * caps)
+{
+  GstVideoAggregator *vagg = GST_VIDEO_AGGREGATOR (agg);
+  gint best_width = -1, best_height = -1;
+  gint best_fps_n = -1, best_fps_d = -1;
+  gdouble best_fps = 0.;
+  GstStructure *s;
+  GList *l;
+
+  caps = gst_caps_make_writable (caps);
+
+  GST_OBJECT_LOCK (vagg);
+  for (l = GST_ELEMENT (vagg)->sinkpads; l; l = l->next) {
+    GstVideoAggregatorPad *vpad = l->data;
+    GstVspmCompositorPad *cpad = GST_VSPM_COMPOSITOR_PAD (vpad);
+    gint fps_n, fps_d;
+    gint width, height;
+    gdouble cur_fps;
+
+    fps_n = GST_VIDEO_INFO_FPS_N (&vpad->info);
+    fps_d = GST_VIDEO_INFO_FPS_D (&vpad->info);
+
+    GST_OBJECT_LOCK (cpad);
+    gst_vspm_compositor_pad_get_output_size (cpad, &width, &height);
+    if (width > 0 && height > 0) {
+      width += MAX (cpad->xpos, 0);
+      height += MAX (cpad->ypos, 0);
+    }
+    GST_OBJECT_UNLOCK (cpad);
+
+    if (width <= 0 || height <= 0)
+      continue;
+
+    best_width = MAX (best_width, width);
+    best_height = MAX (best_height, height);
+
+    if (fps_d == 0)
+      cur_fps = 0.0;
+    else
+      gst_util_fraction_to_double (fps_n, fps_d, &cur_fps);
+
+    if (best_fps < cur_fps) {
+      best_fps = cur_fps;
+      best_fps_n = fps_n;
+      best_fps_d = fps_d;
+    }
+  }
+  GST_OBJECT_UNLOCK (vagg);
+
+  if (best_fps_n <= 0 || best_fps_d <= 0 || best_fps == 0.0) {
+    best_fps_n = 25;
+    best_fps_d = 1;
+  }
+
+  s = gst_caps_get_structure (caps, 0);
+  if (best_width > 0 && best_height > 0) {
+    gst_structure_fixate_field_nearest_int (s, "width", best_width);
+    gst_structure_fixate_field_nearest_int (s, "height", best_height);
+  }
+  gst_structure_fixate_field_nearest_fraction (s, "framerate", best_fps_n,
+      best_fps_d);
+
+  return gst_caps_fixate (caps);
+}
+
+/* The VSP writes into our own mmngr pool, whose addresses are known */
+static gboolean
+gst_vspm_compositor_decide_allocation (GstAggregator * agg, GstQuery * query)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstCaps *caps;
+  guint size, min = 0, max = 0;
+
+  gst_query_parse_allocation (query, &caps, NULL);
+  if (caps == NULL)
+    return FALSE;
+
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, NULL, &min, &max);
+  min = MAX (min, 2);
+
+  pool = gst_vspmfilter_buffer_pool_new (GST_ELEMENT (agg), FALSE);
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, 0, min, max);
+  gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    GST_WARNING_OBJECT (agg, "failed to set buffer pool configuration");
+    gst_object_unref (pool);
+    return FALSE;
+  }
+
+  size = GST_VSPMFILTER_BUFFER_POOL_CAST (pool)->buf_info.outbuf_size;
+  if (gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_set_nth_allocation_pool (query, 0, pool, size, min, max);
+  else
+    gst_query_add_allocation_pool (query, pool, size, min, max);
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+/* Offer upstream a pool of mmngr buffers, whose hardware addresses are
+ * known without any translation; other memory is copied to a bounce
+ * buffer of the pad */
+static gboolean
+gst_vspm_compositor_propose_allocation (GstAggregator * agg,
+    GstAggregatorPad * pad, GstQuery * decide_query, GstQuery * query)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstCaps *caps;
+  GstVideoInfo info;
+  gboolean need_pool;
+  guint size;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  if (!need_pool)
+    return TRUE;
+
+  pool = gst_vspmfilter_buffer_pool_new (GST_ELEMENT (agg), FALSE);
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, info.size, 2, 0);
+  gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    GST_WARNING_OBJECT (pad, "failed to set input pool configuration");
+    gst_object_unref (pool);
+    return TRUE;
+  }
+
+  size = GST_VSPMFILTER_BUFFER_POOL_CAST (pool)->buf_info.outbuf_size;
+  gst_query_add_allocation_pool (query, pool, size, 2, 0);
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static gboolean
+gst_vspm_compositor_start (GstAggregator * agg)
+{
+  GstVspmCompositor *comp = GST_VSPM_COMPOSITOR (agg);
+
+  if (!gst_vspm_session_acquire (&comp->vspm_handle, &comp->mmngr_fd)) {
+    GST_ELEMENT_ERROR (comp, RESOURCE, OPEN_READ_WRITE,
+        ("Could not open the VSPM driver"), (NULL));
+    return FALSE;
+  }
+  comp->is_init_vspm = TRUE;
+
+  return GST_AGGREGATOR_CLASS (parent_class)->start (agg);
+}
+
+static gboolean
+gst_vspm_compositor_stop (GstAggregator * agg)
+{
+  GstVspmCompositor *comp = GST_VSPM_COMPOSITOR (agg);
+  GList *l;
+
+  GST_OBJECT_LOCK (agg);
+  for (l = GST_ELEMENT (agg)->sinkpads; l; l = l->next)
+    gst_vspm_compositor_pad_bounce_clear (GST_VSPM_COMPOSITOR_PAD (l->data));
+  GST_OBJECT_UNLOCK (agg);
+
+  if (comp->is_init_vspm) {
+    gst_vspm_session_release ();
+    comp->is_init_vspm = FALSE;
+    comp->mmngr_fd = -1;
+  }
+
+  return GST_AGGREGATOR_CLASS (parent_class)->stop (agg);
+}
+
+static GstPad *
+gst_vspm_compositor_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * req_name, const GstCaps * caps)
+{
+  guint n_pads;
+
+  GST_OBJECT_LOCK (element);
+  n_pads = element->numsinkpads;
+  GST_OBJECT_UNLOCK (element);
+
+  if (n_pads >= VSPM_COMPOSITOR_MAX_LAYERS) {
+    GST_WARNING_OBJECT (element, "the VSP blends at most %d layers",
+        VSPM_COMPOSITOR_MAX_LAYERS);
+    return NULL;
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->request_new_pad (element, templ,
+      req_name, caps);
+}
+
+static void
+gst_vspm_compositor_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVspmCompositor *comp = GST_VSPM_COMPOSITOR (object);
+
+  switch (prop_id) {
+    case PROP_BACKGROUND:
+      comp->background = g_value_get_uint (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vspm_compositor_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVspmCompositor *comp = GST_VSPM_COMPOSITOR (object);
+
+  switch (prop_id) {
+    case PROP_BACKGROUND:
+      g_value_set_uint (value, comp->background);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vspm_compositor_finalize (GObject * object)
+{
+  GstVspmCompositor *comp = GST_VSPM_COMPOSITOR (object);
+
+  sem_destroy (&comp->smp_wait);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gst_vspm_compositor_class_init (GstVspmCompositorClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = (GstElementClass *) klass;
+  GstAggregatorClass *agg_class = (GstAggregatorClass *) klass;
+  GstVideoAggregatorClass *videoaggregator_class =
+      (GstVideoAggregatorClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (vspmcompositor_debug, "vspmcompositor", 0,
+      "Video compositor with VSPM");
+
+  gobject_class->set_property = gst_vspm_compositor_set_property;
+  gobject_class->get_property = gst_vspm_compositor_get_property;
+  gobject_class->finalize = gst_vspm_compositor_finalize;
+
+  caps = gst_vspm_caps_new (FALSE);
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_pad_template_new_with_gtype ("sink_%u", GST_PAD_SINK,
+          GST_PAD_REQUEST, caps, GST_TYPE_VSPM_COMPOSITOR_PAD));
+  gst_caps_unref (caps);
+
+  caps = gst_vspm_caps_new (TRUE);
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_pad_template_new_with_gtype ("src", GST_PAD_SRC,
+          GST_PAD_ALWAYS, caps, GST_TYPE_AGGREGATOR_PAD));
+  gst_caps_unref (caps);
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "Video Compositor with VSPM",
+      "Filter/Editor/Video/Compositor",
+      "Blends up to four video streams in one VSP job",
+      "Renesas Corporation");
+
+  g_object_class_install_property (gobject_class, PROP_BACKGROUND,
+      g_param_spec_uint ("background", "Background",
+        "Background color as ARGB8888",
+        0, G_MAXUINT32, DEFAULT_BACKGROUND,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  gstelement_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_vspm_compositor_request_new_pad);
+  agg_class->start = GST_DEBUG_FUNCPTR (gst_vspm_compositor_start);
+  agg_class->stop = GST_DEBUG_FUNCPTR (gst_vspm_compositor_stop);
+  agg_class->fixate_src_caps =
+      GST_DEBUG_FUNCPTR (gst_vspm_compositor_fixate_src_caps);
+  agg_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_vspm_compositor_decide_allocation);
+  agg_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_vspm_compositor_propose_allocation);
+  videoaggregator_class->aggregate_frames =
+      GST_DEBUG_FUNCPTR (gst_vspm_compositor_aggregate_frames);
+}
+
+static void
+gst_vspm_compositor_init (GstVspmCompositor * comp)
+{
+  comp->mmngr_fd = -1;
+  comp->is_init_vspm = FALSE;
+  comp->background = DEFAULT_BACKGROUND;
+  sem_init (&comp->smp_wait, 0, 0);
+}
@@ -0,0 +1,107 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_VSPM_COMPOSITOR_H__
+#define __GST_VSPM_COMPOSITOR_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideoaggregator.h>
+
+#include <semaphore.h>
+
+#include "gstvspmfilter.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VSPM_COMPOSITOR_PAD          (gst_vspm_compositor_pad_get_type())
+#define GST_VSPM_COMPOSITOR_PAD(obj)          (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VSPM_COMPOSITOR_PAD,GstVspmCompositorPad))
+#define GST_VSPM_COMPOSITOR_PAD_CLASS(klass)  (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VSPM_COMPOSITOR_PAD,GstVspmCompositorPadClass))
+#define GST_IS_VSPM_COMPOSITOR_PAD(obj)       (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VSPM_COMPOSITOR_PAD))
+
+#define GST_TYPE_VSPM_COMPOSITOR              (gst_vspm_compositor_get_type())
+#define GST_VSPM_COMPOSITOR(obj)              (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VSPM_COMPOSITOR,GstVspmCompositor))
+#define GST_VSPM_COMPOSITOR_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VSPM_COMPOSITOR,GstVspmCompositorClass))
+#define GST_IS_VSPM_COMPOSITOR(obj)           (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VSPM_COMPOSITOR))
+
+/* number of RPF inputs the VSP blends in one job */
+#define VSPM_COMPOSITOR_MAX_LAYERS 4
+
+typedef struct _GstVspmCompositor GstVspmCompositor;
+typedef struct _GstVspmCompositorClass GstVspmCompositorClass;
+typedef struct _GstVspmCompositorPad GstVspmCompositorPad;
+typedef struct _GstVspmCompositorPadClass GstVspmCompositorPadClass;
+
+/* Intermediate buffer for a layer which has to be scaled before blending */
+typedef struct {
+  VspmBufferInfo info;
+  int mmng_pid;
+  unsigned long pphy_addr;
+  unsigned long phard_addr;
+  unsigned long puser_virt_addr;
+} GstVspmCompositorScaled;
+
+struct _GstVspmCompositorPad
+{
+  GstVideoAggregatorPad parent;
+
+  gint xpos, ypos;
+  gint width, height;
+  gdouble alpha;
+
+  GstVspmCompositorScaled scaled;
+
+  /* mmngr copies of the frames the VSP can not address */
+  GstBufferPool *bounce_pool;
+  GstVideoInfo bounce_info;
+};
+
+struct _GstVspmCompositorPadClass
+{
+  GstVideoAggregatorPadClass parent_class;
+};
+
+/**
+ * GstVspmCompositor:
+ *
+ * Opaque object data structure.
+ */
+struct _GstVspmCompositor
+{
+  GstVideoAggregator parent;
+
+  unsigned long vspm_handle;
+  gboolean is_init_vspm;
+  int mmngr_fd;   /* mmngr open id */
+  guint background;
+  long result;
+  sem_t smp_wait;
+};
+
+struct _GstVspmCompositorClass
+{
+  GstVideoAggregatorClass parent_class;
+};
+
+GType gst_vspm_compositor_pad_get_type (void);
+GType gst_vspm_compositor_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_VSPM_COMPOSITOR_H__ */
@@ -39,6 +39,10 @@
 #endif
 
 #include "gstvspmfilter.h"
+#include "gstvspmmultiscale.h"
+#ifdef HAVE_VSPM_COMPOSITOR
+#include "gstvspmcompositor.h"
+#endif
 
 #include <gst/video/video.h>
 #include <gst/video/gstvideometa.h>
@@ -48,10 +52,21 @@
 #include <string.h>
 #include <stdio.h>
 
-#include "vspm_public.h"
 #include "mmngr_user_public.h"
 #include "mmngr_buf_user_public.h"
 
+#ifdef HAVE_VSPM_EMULATION
+/* No /dev/rgnmm, the stand-in answers MM_IOC_VTOP itself */
+#include "mmngr_emul.h"
+#define mmngr_dev_open(path, flags)   mmngr_emul_open (path, flags)
+#define mmngr_dev_ioctl(fd, req, arg) mmngr_emul_ioctl (fd, req, arg)
+#define mmngr_dev_close(fd)           mmngr_emul_close (fd)
+#else
+#define mmngr_dev_open(path, flags)   open (path, flags)
+#define mmngr_dev_ioctl(fd, req, arg) ioctl (fd, req, arg)
+#define mmngr_dev_close(fd)           close (fd)
+#endif
+
 GST_DEBUG_CATEGORY (vspmfilter_debug);
 #define GST_CAT_DEFAULT vspmfilter_debug
 GST_DEBUG_CATEGORY_EXTERN (GST_CAT_PERFORMANCE);
@@ -59,13 +74,62 @@ GST_DEBUG_CATEGORY_EXTERN (GST_CAT_PERFORMANCE);
 #define VSP_FORMAT_PIXEL_MASK	(0x0f00)
 #define VSP_FORMAT_PIXEL_BIT	(8)
 
-/* number buffers of buffer pool */
+/* default number buffers of buffer pool (max 0 = unlimited) */
 #define MIN_BUFFERS (5)
 #define MAX_BUFFERS (5)
 
 GType gst_vspm_filter_get_type (void);
 
+/* mmngr memory held by the buffer pools of the process */
+static gint vspm_cma_bytes;
+
+/* upper bounds of the statistics histogram buckets, in microseconds */
+static const gint64 vspm_stats_bounds[VSPM_STATS_BUCKETS - 1] = {
+  50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000
+};
+
 static GQuark _colorspace_quark;
+static GQuark _vtop_cache_quark;
+
+/* Physical addresses already translated for a GstMemory, keyed by the
+ * offset of the plane in the memory. Attached as qdata, so it is released
+ * together with the memory */
+typedef struct {
+  guint n_entries;
+  gsize offset[GST_VIDEO_MAX_PLANES];
+  gpointer hard_addr[GST_VIDEO_MAX_PLANES];
+} GstVspmFilterVtopCache;
+
+G_LOCK_DEFINE_STATIC (vtop_cache);
+
+static GQuark _import_quark;
+
+/* mmngr import of a dmabuf memory. Attached as qdata, so the import is
+ * kept for as long as the memory lives */
+typedef struct {
+  int import_pid;
+  unsigned int hard_addr;
+} GstVspmFilterImport;
+
+G_LOCK_DEFINE_STATIC (import_cache);
+
+/* mmngr allocation behind a buffer of GstVspmFilterBufferPool */
+static GQuark _vspm_buffer_quark;
+
+/* VSPM handle and mmngr device shared by all the elements of the
+ * process, opened by the first one going to PAUSED */
+static struct {
+  gint refcount;
+  unsigned long vspm_handle;
+  int mmngr_fd;
+} vspm_session = { 0, 0, -1 };
+G_LOCK_DEFINE_STATIC (vspm_session);
+
+/* Jobs queued on each VSP channel by all the elements of the process */
+static gint vspm_channel_depth[MAX_DEVICES];
+static const unsigned short vspm_channel_type[MAX_DEVICES] = {
+  VSPM_TYPE_VSP_CH0, VSPM_TYPE_VSP_CH1
+};
 
 #define gst_vspm_filter_parent_class parent_class
 G_DEFINE_TYPE (GstVspmFilter, gst_vspm_filter, GST_TYPE_VIDEO_FILTER);
@@ -77,15 +141,10 @@ static void gst_vspm_filter_set_property (GObject * object,
 static void gst_vspm_filter_get_property (GObject * object,
     guint property_id, GValue * value, GParamSpec * pspec);
 static GstFlowReturn
-gst_vspm_filter_transform_buffer (GstVideoFilter * filter,
+gst_vspm_filter_transform_buffer (GstBaseTransform * trans,
                                     GstBuffer * inbuf,
                                     GstBuffer * outbuf);
 
-static GstFlowReturn gst_vspm_filter_allocate_buffer (GstVspmFilter * space);
-static void gst_vspm_filter_free_buffer (GstVspmFilter * space);
-static void gst_vspm_filter_set_buffer_info (GstVspmFilter * space,
-    GstVideoInfo * info, GstVideoAlignment * align);
-
 static gboolean gst_vspm_filter_set_info (GstVideoFilter * filter,
     GstCaps * incaps, GstVideoInfo * in_info, GstCaps * outcaps,
     GstVideoInfo * out_info);
@@ -94,8 +153,17 @@ static GstFlowReturn gst_vspm_filter_transform_frame (GstVideoFilter * filter,
 
 static void gst_vspm_filter_finalize (GObject * obj);
 
-static void gst_vspm_filter_import_fd (GstMemory *mem, gpointer *out, GQueue *import_list);
-static void gst_vspm_filter_release_fd (GQueue *import_list);
+static void gst_vspm_filter_import_fd (GstMemory *mem, gpointer *out);
+static GstFlowReturn gst_vspm_filter_drain (GstVspmFilter * space, gboolean push);
+static void gst_vspm_filter_bounce_finish (GstVspmFilter * space,
+    GstVspmFilterJob * job, GstVideoFrame * out_frame);
+static void gst_vspm_filter_bounce_clear (GstVspmFilter * space);
+#ifdef HAVE_VSPM_SOFTWARE
+static void gst_vspm_filter_vsp_formats (GValue * formats, gboolean output);
+#endif
+static void gst_vspm_filter_passes_clear (GstVspmFilter * space);
+static void gst_vspm_filter_stats_add (GstVspmFilter * space,
+    GstVspmFilterTiming * t, gint64 elapsed);
 
 struct _GstBaseTransformPrivate
 {
@@ -141,13 +209,110 @@ enum
 {
   PROP_0,
   PROP_VSPM_OUTBUF,
-  PROP_VSPM_DMABUF
+  PROP_VSPM_DMABUF,
+  PROP_VSPM_MAX_INFLIGHT,
+  PROP_VSPM_MIN_BUFFERS,
+  PROP_VSPM_MAX_BUFFERS,
+  PROP_VSPM_CROP_LEFT,
+  PROP_VSPM_CROP_RIGHT,
+  PROP_VSPM_CROP_TOP,
+  PROP_VSPM_CROP_BOTTOM,
+  PROP_VSPM_ADD_BORDERS,
+  PROP_VSPM_BORDER_COLOR,
+  PROP_VSPM_CHANNEL,
+  PROP_VSPM_STATS,
+  PROP_VSPM_SOFTWARE_FALLBACK,
+  PROP_VSPM_SPLIT_FRAME
 };
 
+#define DEFAULT_BORDER_COLOR 0xff000000
+#define DEFAULT_SOFTWARE_FALLBACK TRUE
+#define DEFAULT_SPLIT_FRAME FALSE
+
+static void
+gst_vspmfilter_buffer_pool_release_mem (gpointer data)
+{
+  Vspm_dmabuff *vspm_buf = data;
+  gint i;
+
+  for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
+    if (vspm_buf->dmabuf_pid[i] >= 0)
+      mmngr_export_end_in_user(vspm_buf->dmabuf_pid[i]);
+  }
+  mmngr_free_in_user(vspm_buf->mmng_pid);
+  g_atomic_int_add (&vspm_cma_bytes, -(gint) vspm_buf->size);
+  g_free (vspm_buf);
+}
+
 static void
 gst_vspmfilter_buffer_pool_free_buffer (GstBufferPool * bpool, GstBuffer * buffer)
 {
-  /* No processing */
+  GstVspmFilterBufferPool *vspmfltpool = GST_VSPMFILTER_BUFFER_POOL_CAST (bpool);
+  Vspm_dmabuff *vspm_buf;
+  gint i;
+
+  /* Close the dmabuf fds of the buffer before ending their export */
+  vspm_buf = gst_mini_object_steal_qdata (GST_MINI_OBJECT_CAST (buffer),
+      _vspm_buffer_quark);
+  gst_buffer_unref (buffer);
+  if (vspm_buf == NULL)
+    return;
+
+  /* The exports depend on the plane layout, the mmngr area does not. Keep
+   * it for the next configuration, a new resolution often fits in it */
+  for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
+    if (vspm_buf->dmabuf_pid[i] >= 0)
+      mmngr_export_end_in_user(vspm_buf->dmabuf_pid[i]);
+    vspm_buf->dmabuf_pid[i] = -1;
+  }
+
+  g_mutex_lock (&vspmfltpool->spare_lock);
+  vspmfltpool->spare_mem = g_slist_prepend (vspmfltpool->spare_mem, vspm_buf);
+  g_mutex_unlock (&vspmfltpool->spare_lock);
+}
+
+/* Take the smallest spare mmngr area of at least size bytes */
+static Vspm_dmabuff *
+gst_vspmfilter_buffer_pool_take_spare (GstVspmFilterBufferPool * vspmfltpool,
+    guint size)
+{
+  Vspm_dmabuff *best = NULL;
+  GSList *l;
+
+  g_mutex_lock (&vspmfltpool->spare_lock);
+  for (l = vspmfltpool->spare_mem; l; l = l->next) {
+    Vspm_dmabuff *vspm_buf = l->data;
+
+    if (vspm_buf->size >= size && (!best || vspm_buf->size < best->size))
+      best = vspm_buf;
+  }
+  if (best)
+    vspmfltpool->spare_mem = g_slist_remove (vspmfltpool->spare_mem, best);
+  g_mutex_unlock (&vspmfltpool->spare_lock);
+
+  return best;
+}
+
+/* Give back to mmngr the spare areas smaller than size, or all of them
+ * when size is 0 */
+static void
+gst_vspmfilter_buffer_pool_trim_spare (GstVspmFilterBufferPool * vspmfltpool,
+    guint size)
+{
+  GSList *l, *next;
+
+  g_mutex_lock (&vspmfltpool->spare_lock);
+  for (l = vspmfltpool->spare_mem; l; l = next) {
+    Vspm_dmabuff *vspm_buf = l->data;
+
+    next = l->next;
+    if (size == 0 || vspm_buf->size < size) {
+      gst_vspmfilter_buffer_pool_release_mem (vspm_buf);
+      vspmfltpool->spare_mem =
+          g_slist_delete_link (vspmfltpool->spare_mem, l);
+    }
+  }
+  g_mutex_unlock (&vspmfltpool->spare_lock);
 }
 
 static GstFlowReturn
@@ -155,44 +320,216 @@ gst_vspmfilter_buffer_pool_alloc_buffer (GstBufferPool * bpool,
     GstBuffer ** buffer, GstBufferPoolAcquireParams * params)
 {
   GstVspmFilterBufferPool *vspmfltpool = GST_VSPMFILTER_BUFFER_POOL_CAST (bpool);
-  GstVspmFilter * vspmfilter = vspmfltpool->vspmfilter;
-  GstBuffer *tmp;
-  GstFlowReturn result = GST_FLOW_OK;
-  VspmbufArray *vspm_outbuf;
+  VspmBufferInfo *buf_info = &vspmfltpool->buf_info;
+  Vspm_dmabuff *vspm_buf;
+  GstBuffer *buf;
+  guint j;
+  gint page_size;
+  gint dmabuf_fd;
+  gint dmabuf_page_offset;
+  gint dmabuf_plane_size_ext;
 
-  vspm_outbuf = vspmfilter->vspm_outbuf;
-  tmp = g_ptr_array_index (vspm_outbuf->buf_array, vspm_outbuf->current_buffer_index);
-  *buffer = tmp;
+  page_size = getpagesize();
 
-  vspm_outbuf->current_buffer_index ++;
-  if(vspm_outbuf->current_buffer_index >= vspm_outbuf->buf_array->len)
-      vspm_outbuf->current_buffer_index = 0;
+  vspm_buf = gst_vspmfilter_buffer_pool_take_spare (vspmfltpool,
+      buf_info->outbuf_size);
+  if (vspm_buf) {
+    GST_LOG_OBJECT (bpool, "reusing mmngr area of %u bytes", vspm_buf->size);
+  } else {
+    vspm_buf = g_new0 (Vspm_dmabuff, 1);
+    for (j = 0; j < GST_VIDEO_MAX_PLANES; j++)
+      vspm_buf->dmabuf_pid[j] = -1;
 
-  return result;
+    if (R_MM_OK != mmngr_alloc_in_user(&vspm_buf->mmng_pid,
+                                       buf_info->outbuf_size,
+                                       &vspm_buf->pphy_addr,
+                                       &vspm_buf->phard_addr,
+                                       &vspm_buf->puser_virt_addr,
+                                       MMNGR_VA_SUPPORT_CACHED)) {
+      GST_ERROR_OBJECT (vspmfltpool->element,
+            "mmngr_alloc_in_user failed to allocate memory (%d)",
+            buf_info->outbuf_size);
+      g_free (vspm_buf);
+      return GST_FLOW_ERROR;
+    }
+    vspm_buf->size = buf_info->outbuf_size;
+    g_atomic_int_add (&vspm_cma_bytes, vspm_buf->size);
+  }
+
+  if (vspmfltpool->use_dmabuf) {
+    buf = gst_buffer_new ();
+    for (j = 0; j < buf_info->n_planes; j++) {
+      gint res;
+      guint phys_addr;
+      GstMemory *mem;
+      phys_addr = (guint)vspm_buf->phard_addr + buf_info->plane_base[j];
+      /* Calculate offset between physical address and page boundary */
+      dmabuf_page_offset = phys_addr & (page_size - 1);
+      /* When downstream plugins do mapping from dmabuf fd it requires
+      * mapping from boundary page and size align for page size so
+      * memory for plane must increase to handle for this case */
+      dmabuf_plane_size_ext = GST_ROUND_UP_N(
+          buf_info->plane_size[j] + dmabuf_page_offset, page_size);
+      res = mmngr_export_start_in_user (&vspm_buf->dmabuf_pid[j],
+                                        dmabuf_plane_size_ext,
+                                        (unsigned long) GST_ROUND_DOWN_N(phys_addr, page_size),
+                                        &dmabuf_fd);
+      if (res != R_MM_OK) {
+        GST_ERROR_OBJECT (vspmfltpool->element,
+          "mmngr_export_start_in_user failed (phys_addr:0x%08x)",
+          phys_addr);
+        gst_buffer_unref (buf);
+        gst_vspmfilter_buffer_pool_release_mem (vspm_buf);
+        return GST_FLOW_ERROR;
+      }
+
+      /* Set offset's information */
+      mem = gst_dmabuf_allocator_alloc (vspmfltpool->allocator, dmabuf_fd,
+                                        dmabuf_plane_size_ext);
+      mem->offset = dmabuf_page_offset;
+      /* Only allow to access plane size */
+      mem->size = buf_info->plane_size[j];
+      gst_buffer_append_memory (buf, mem);
+    }
+  } else {
+    /* The memory belongs to mmngr, it is released in free_buffer */
+    buf = gst_buffer_new_wrapped_full (0,
+            (gpointer)vspm_buf->puser_virt_addr, (gsize)buf_info->outbuf_size,
+            0, (gsize)buf_info->outbuf_size, NULL, NULL);
+  }
+
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (buf), _vspm_buffer_quark,
+      vspm_buf, gst_vspmfilter_buffer_pool_release_mem);
+  gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE,
+                                 buf_info->format,
+                                 buf_info->width, buf_info->height,
+                                 buf_info->n_planes,
+                                 buf_info->plane_offset, buf_info->plane_stride);
+
+  GST_LOG_OBJECT (bpool, "allocated buffer %p of %d bytes", buf,
+      buf_info->outbuf_size);
+  *buffer = buf;
+
+  return GST_FLOW_OK;
 }
 
-static GstBufferPool *
-gst_vspmfilter_buffer_pool_new (GstVspmFilter * vspmfilter)
+static const gchar **
+gst_vspmfilter_buffer_pool_get_options (GstBufferPool * bpool)
+{
+  static const gchar *options[] = { GST_BUFFER_POOL_OPTION_VIDEO_META,
+    GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT, NULL
+  };
+
+  return options;
+}
+
+static gboolean
+gst_vspmfilter_buffer_pool_set_config (GstBufferPool * bpool,
+    GstStructure * config)
+{
+  GstVspmFilterBufferPool *vspmfltpool = GST_VSPMFILTER_BUFFER_POOL_CAST (bpool);
+  GstCaps *caps;
+  guint min, max;
+  GstVideoInfo info;
+  GstVideoAlignment align;
+
+  if (!gst_buffer_pool_config_get_params (config, &caps, NULL, &min, &max)
+      || caps == NULL) {
+    GST_WARNING_OBJECT (bpool, "no caps in buffer pool configuration");
+    return FALSE;
+  }
+  if (!gst_video_info_from_caps (&info, caps)) {
+    GST_WARNING_OBJECT (bpool, "invalid caps %" GST_PTR_FORMAT, caps);
+    return FALSE;
+  }
+
+  gst_video_alignment_reset (&align);
+  if (gst_buffer_pool_config_has_option (config,
+          GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT))
+    gst_buffer_pool_config_get_video_alignment (config, &align);
+  gst_vspm_filter_set_buffer_info (&vspmfltpool->buf_info, &info, &align);
+
+  /* Spare areas which can not hold a buffer of the new layout are only
+   * holding CMA memory */
+  gst_vspmfilter_buffer_pool_trim_spare (vspmfltpool,
+      vspmfltpool->buf_info.outbuf_size);
+
+  /* The buffer size follows from the plane layout */
+  gst_buffer_pool_config_set_params (config, caps,
+      vspmfltpool->buf_info.outbuf_size, min, max);
+
+  return GST_BUFFER_POOL_CLASS
+      (gst_vspmfilter_buffer_pool_parent_class)->set_config (bpool, config);
+}
+
+GstBufferPool *
+gst_vspmfilter_buffer_pool_new (GstElement * element, gboolean use_dmabuf)
 {
   GstVspmFilterBufferPool *pool;
 
-  g_return_val_if_fail (GST_IS_VIDEO_CONVERT(vspmfilter), NULL);
+  g_return_val_if_fail (GST_IS_ELEMENT(element), NULL);
   pool = g_object_new (GST_TYPE_VSPMFILTER_BUFFER_POOL, NULL);
-  pool->vspmfilter = gst_object_ref (vspmfilter);
+  pool->element = gst_object_ref (element);
+  pool->use_dmabuf = use_dmabuf;
+  if (use_dmabuf)
+    pool->allocator = gst_dmabuf_allocator_new ();
 
   GST_LOG_OBJECT (pool, "new vspmfilter buffer pool %p", pool);
 
   return GST_BUFFER_POOL_CAST (pool);
 }
 
+/* Apply config to *pool, taking ownership of config. A pool can not be
+ * reconfigured while buffers of it are still out (held by a sink or by
+ * queued jobs); it is then replaced by a new pool, which takes over the
+ * spare mmngr areas of the old one */
+gboolean
+gst_vspmfilter_buffer_pool_reconfigure (GstBufferPool ** pool,
+    GstStructure * config)
+{
+  GstVspmFilterBufferPool *old = GST_VSPMFILTER_BUFFER_POOL_CAST (*pool);
+  GstVspmFilterBufferPool *fresh;
+  GstStructure *copy;
+
+  if (gst_buffer_pool_is_active (*pool))
+    gst_buffer_pool_set_active (*pool, FALSE);
+
+  copy = gst_structure_copy (config);
+  if (gst_buffer_pool_set_config (*pool, config)) {
+    gst_structure_free (copy);
+    return TRUE;
+  }
+
+  GST_DEBUG_OBJECT (old->element, "pool %" GST_PTR_FORMAT " is busy, "
+      "replacing it", *pool);
+
+  fresh = GST_VSPMFILTER_BUFFER_POOL_CAST (gst_vspmfilter_buffer_pool_new (
+      old->element, old->use_dmabuf));
+  g_mutex_lock (&old->spare_lock);
+  fresh->spare_mem = old->spare_mem;
+  old->spare_mem = NULL;
+  g_mutex_unlock (&old->spare_lock);
+
+  /* The outstanding buffers keep the old pool alive until they return */
+  gst_object_unref (*pool);
+  *pool = GST_BUFFER_POOL_CAST (fresh);
+
+  return gst_buffer_pool_set_config (*pool, copy);
+}
+
 static void
 gst_vspmfilter_buffer_pool_finalize (GObject * object)
 {
   GstVspmFilterBufferPool *pool = GST_VSPMFILTER_BUFFER_POOL_CAST (object);
 
+  gst_vspmfilter_buffer_pool_trim_spare (pool, 0);
+  g_mutex_clear (&pool->spare_lock);
+
   if (pool->caps)
     gst_caps_unref (pool->caps);
-  gst_object_unref (pool->vspmfilter);
+  if (pool->allocator)
+    gst_object_unref (pool->allocator);
+  gst_object_unref (pool->element);
 
   G_OBJECT_CLASS (gst_vspmfilter_buffer_pool_parent_class)->finalize (object);
 }
@@ -200,7 +537,7 @@ gst_vspmfilter_buffer_pool_finalize (GObject * object)
 static void
 gst_vspmfilter_buffer_pool_init (GstVspmFilterBufferPool * pool)
 {
-  /* No processing */
+  g_mutex_init (&pool->spare_lock);
 }
 
 static void
@@ -210,6 +547,8 @@ gst_vspmfilter_buffer_pool_class_init (GstVspmFilterBufferPoolClass * klass)
   GstBufferPoolClass *gstbufferpool_class = (GstBufferPoolClass *) klass;
 
   gobject_class->finalize = gst_vspmfilter_buffer_pool_finalize;
+  gstbufferpool_class->get_options = gst_vspmfilter_buffer_pool_get_options;
+  gstbufferpool_class->set_config = gst_vspmfilter_buffer_pool_set_config;
   gstbufferpool_class->alloc_buffer = gst_vspmfilter_buffer_pool_alloc_buffer;
   gstbufferpool_class->free_buffer = gst_vspmfilter_buffer_pool_free_buffer;
 }
@@ -264,6 +603,18 @@ gst_vspm_filter_fixate_caps (GstBaseTransform * trans,
   gst_structure_get_int (ins, "width", &from_w);
   gst_structure_get_int (ins, "height", &from_h);
 
+  /* the crop-* properties shrink the picture we start from */
+  if (direction == GST_PAD_SINK) {
+    GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (trans);
+    gint crop_w = from_w - space->crop_left - space->crop_right;
+    gint crop_h = from_h - space->crop_top - space->crop_bottom;
+
+    if (crop_w > 0 && crop_h > 0) {
+      from_w = crop_w;
+      from_h = crop_h;
+    }
+  }
+
   gst_structure_get_int (outs, "width", &w);
   gst_structure_get_int (outs, "height", &h);
 
@@ -296,13 +647,75 @@ gst_vspm_filter_filter_meta (GstBaseTransform * trans, GstQuery * query,
   return TRUE;
 }
 
+static gboolean
+gst_vspm_filter_software_enabled (GstVspmFilter * space)
+{
+#ifdef HAVE_VSPM_SOFTWARE
+  return space->software_fallback;
+#else
+  return FALSE;
+#endif
+}
+
+/* Sizes the VSP reaches from size in up to VSPM_MAX_PASSES UDS passes. The
+ * ratio limits being about the same both ways, this is also the range of
+ * sizes reaching size */
+static void
+gst_vspm_filter_size_range (gint size, gint limit, gint * min, gint * max)
+{
+  gint64 lo = MAX (size, 1), hi = MAX (size, 1);
+  guint i;
+
+  for (i = 0; i < VSPM_MAX_PASSES; i++) {
+    lo = (lo * 4096 + VSPM_UDS_MAX_RATIO - 1) / VSPM_UDS_MAX_RATIO;
+    hi = hi * 4096 / VSPM_UDS_MIN_RATIO;
+  }
+  *min = (gint) CLAMP (lo, 1, limit);
+  *max = (gint) CLAMP (hi, 1, limit);
+}
+
+/* Restrict field of st to the sizes the VSP can convert its value to. The
+ * crop_before columns or lines are dropped from the value, the crop_after
+ * ones added to the result */
+static void
+gst_vspm_filter_restrict_size (GstStructure * st, const gchar * field,
+    gint crop_before, gint crop_after, gint limit, gboolean borders)
+{
+  const GValue *v = gst_structure_get_value (st, field);
+  gint lo = 1, hi = limit, unused;
+
+  if (v && G_VALUE_HOLDS_INT (v)) {
+    gst_vspm_filter_size_range (g_value_get_int (v) - crop_before, limit,
+        &lo, &hi);
+  } else if (v && GST_VALUE_HOLDS_INT_RANGE (v)) {
+    gst_vspm_filter_size_range (gst_value_get_int_range_min (v) -
+        crop_before, limit, &lo, &unused);
+    gst_vspm_filter_size_range (gst_value_get_int_range_max (v) -
+        crop_before, limit, &unused, &hi);
+  }
+
+  /* borders fill any room left around the picture */
+  if (borders)
+    hi = limit;
+  lo = MIN (lo + crop_after, limit);
+  hi = MIN (hi + crop_after, limit);
+
+  if (lo == hi)
+    gst_structure_set (st, field, G_TYPE_INT, lo, NULL);
+  else
+    gst_structure_set (st, field, GST_TYPE_INT_RANGE, lo, hi, NULL);
+}
+
 /* The caps can be transformed into any other caps with format info removed.
  * However, we should prefer passthrough, so if passthrough is possible,
- * put it first in the list. */
+ * put it first in the list. Without the software path, only the sizes
+ * and formats the VSP reaches are offered */
 static GstCaps *
 gst_vspm_filter_transform_caps (GstBaseTransform * btrans,
     GstPadDirection direction, GstCaps * caps, GstCaps * filter)
 {
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (btrans);
+  gboolean sink = direction == GST_PAD_SINK;
   GstCaps *tmp, *tmp2;
   GstCaps *result;
   GstCaps *caps_full_range_sizes;
@@ -325,9 +738,30 @@ gst_vspm_filter_transform_caps (GstBaseTransform * btrans,
 
     /* make copy */
     structure = gst_structure_copy (structure);
-    gst_structure_set (structure,
-        "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-        "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+    if (gst_vspm_filter_software_enabled (space)) {
+      gst_structure_set (structure,
+          "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+          "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+    } else {
+      /* strides are 16 bits, wide frames are striped but tall ones not */
+      gst_vspm_filter_restrict_size (structure, "width",
+          sink ? space->crop_left + space->crop_right : 0,
+          sink ? 0 : space->crop_left + space->crop_right,
+          G_MAXUINT16, space->add_borders);
+      gst_vspm_filter_restrict_size (structure, "height",
+          sink ? space->crop_top + space->crop_bottom : 0,
+          sink ? 0 : space->crop_top + space->crop_bottom,
+          VSPM_MAX_SIZE, space->add_borders);
+#ifdef HAVE_VSPM_SOFTWARE
+      /* the templates list formats only the software path converts */
+      {
+        GValue formats = G_VALUE_INIT;
+
+        gst_vspm_filter_vsp_formats (&formats, sink);
+        gst_structure_take_value (structure, "format", &formats);
+      }
+#endif
+    }
 
     gst_caps_append_structure (caps_full_range_sizes, structure);
   }
@@ -362,6 +796,9 @@ gst_vspm_filter_transform_meta (GstBaseTransform * trans, GstBuffer * outbuf,
     /* don't copy colorspace specific metadata, FIXME, we need a MetaTransform
      * for the colorspace metadata. */
     ret = FALSE;
+  } else if (info->api == GST_VIDEO_CROP_META_API_TYPE) {
+    /* the crop was done by the VSP */
+    ret = FALSE;
   } else {
     /* copy other metadata */
     ret = TRUE;
@@ -377,7 +814,7 @@ struct extensions_t
 };
 
 /* Note that below swap information will be REVERSED later (in function
- *     set_colorspace) because current system use Little Endian */
+ *     gst_vspm_set_colorspace) because current system use Little Endian */
 static const struct extensions_t exts[] = {
   {GST_VIDEO_FORMAT_NV12,  VSP_IN_YUV420_SEMI_NV12,  VSP_SWAP_NO},    /* NV12 format is highest priority as most modules support this */
   {GST_VIDEO_FORMAT_I420,  VSP_IN_YUV420_PLANAR,     VSP_SWAP_NO},    /* I420 is second priority */
@@ -426,8 +863,98 @@ static const struct extensions_t exts_out[] = {
   {GST_VIDEO_FORMAT_NV24,  VSP_OUT_YUV444_SEMI_PLANAR,VSP_SWAP_NO},
 };
 
-static gint
-set_colorspace (GstVideoFormat vid_fmt, guint * format, guint * fswap)
+/* All formats supported on the input (output = FALSE) or output side */
+GstCaps *
+gst_vspm_caps_new (gboolean output)
+{
+  const struct extensions_t *table = output ? exts_out : exts;
+  int nr_exts = output ? G_N_ELEMENTS (exts_out) : G_N_ELEMENTS (exts);
+  GstCaps *caps;
+  GstCaps *tmpcaps;
+  int i;
+
+  caps = gst_caps_new_empty();
+  for (i = 0; i < nr_exts; i++) {
+    tmpcaps = gst_caps_new_simple ("video/x-raw",
+            "format", G_TYPE_STRING, gst_video_format_to_string (table[i].gst_format),
+            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+            "framerate", GST_TYPE_FRACTION_RANGE, 0, 1, G_MAXINT, 1, NULL);
+
+    gst_caps_append (caps, tmpcaps);
+  }
+
+  return caps;
+}
+
+#ifdef HAVE_VSPM_SOFTWARE
+/* The VSP formats, as a list for a format field */
+static void
+gst_vspm_filter_vsp_formats (GValue * formats, gboolean output)
+{
+  const struct extensions_t *table = output ? exts_out : exts;
+  int nr_exts = output ? G_N_ELEMENTS (exts_out) : G_N_ELEMENTS (exts);
+  GValue v = G_VALUE_INIT;
+  int i;
+
+  g_value_init (formats, GST_TYPE_LIST);
+  for (i = 0; i < nr_exts; i++) {
+    g_value_init (&v, G_TYPE_STRING);
+    g_value_set_static_string (&v,
+        gst_video_format_to_string (table[i].gst_format));
+    gst_value_list_append_and_take_value (formats, &v);
+  }
+}
+
+/* Append the formats only GstVideoConverter handles, after the VSP ones so
+ * that negotiation prefers the hardware. Formats without a per-pixel
+ * stride or tiled do not fit the buffer layouts of the pools */
+static void
+gst_vspm_filter_append_software_caps (GstCaps * caps, gboolean output)
+{
+  GstCaps *all;
+  GstStructure *st;
+  const GValue *list;
+  GValue formats = G_VALUE_INIT;
+  guint i, p;
+
+  all = gst_caps_from_string (GST_VIDEO_CAPS_MAKE (GST_VIDEO_FORMATS_ALL));
+  st = gst_structure_copy (gst_caps_get_structure (all, 0));
+  gst_caps_unref (all);
+
+  list = gst_structure_get_value (st, "format");
+  g_value_init (&formats, GST_TYPE_LIST);
+  for (i = 0; i < gst_value_list_get_size (list); i++) {
+    const GValue *v = gst_value_list_get_value (list, i);
+    GstVideoFormat format;
+    const GstVideoFormatInfo *finfo;
+    guint vsp_format, vsp_swap;
+
+    format = gst_video_format_from_string (g_value_get_string (v));
+    finfo = gst_video_format_get_info (format);
+
+    if ((output ? gst_vspm_set_colorspace_output (format, &vsp_format,
+                &vsp_swap) : gst_vspm_set_colorspace (format, &vsp_format,
+                &vsp_swap)) == 0)
+      continue;
+    if (finfo == NULL || GST_VIDEO_FORMAT_INFO_IS_TILED (finfo))
+      continue;
+    for (p = 0; p < GST_VIDEO_FORMAT_INFO_N_PLANES (finfo); p++)
+      if (GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, p) == 0)
+        break;
+    if (p < GST_VIDEO_FORMAT_INFO_N_PLANES (finfo))
+      continue;
+
+    gst_value_list_append_value (&formats, v);
+  }
+
+  gst_structure_take_value (st, "format", &formats);
+  gst_caps_append_structure (caps, st);
+}
+#endif
+
+gint
+gst_vspm_set_colorspace (GstVideoFormat vid_fmt, guint * format, guint * fswap)
 {
   int nr_exts = sizeof (exts) / sizeof (exts[0]);
   int i;
@@ -444,8 +971,8 @@ set_colorspace (GstVideoFormat vid_fmt, guint * format, guint * fswap)
   return -1;
 }
 
-static gint
-set_colorspace_output (GstVideoFormat vid_fmt, guint * format, guint * fswap)
+gint
+gst_vspm_set_colorspace_output (GstVideoFormat vid_fmt, guint * format, guint * fswap)
 {
   int nr_exts = sizeof (exts_out) / sizeof (exts_out[0]);
   int i;
@@ -462,11 +989,11 @@ set_colorspace_output (GstVideoFormat vid_fmt, guint * format, guint * fswap)
   return -1;
 }
 
-static void
-gst_vspm_filter_set_buffer_info (GstVspmFilter * space,
+void
+gst_vspm_filter_set_buffer_info (VspmBufferInfo * buf_info,
     GstVideoInfo * info, GstVideoAlignment * align)
 {
-  VspmBufferInfo *buf_info = &space->buf_info;
+  const GstVideoFormatInfo *finfo;
   gint i;
 
   if (info != NULL) {
@@ -482,18 +1009,37 @@ gst_vspm_filter_set_buffer_info (GstVspmFilter * space,
       buf_info->plane_pixel_stride[i] =
           GST_VIDEO_FORMAT_INFO_PSTRIDE (info->finfo, i);
     }
+    /* new caps, forget the alignment of the previous downstream */
+    gst_video_alignment_reset (&buf_info->align);
   }
 
   buf_info->outbuf_size = 0;
   memset (buf_info->plane_stride, 0, sizeof (buf_info->plane_stride));
   memset (buf_info->plane_size  , 0, sizeof (buf_info->plane_size));
   memset (buf_info->plane_offset, 0, sizeof (buf_info->plane_offset));
+  memset (buf_info->plane_base  , 0, sizeof (buf_info->plane_base));
 
-  for (i = 0; i < buf_info->n_planes; i++) {
-    gint stride = buf_info->plane_width[i] * buf_info->plane_pixel_stride[i];
-    gint sliceheight = buf_info->plane_height[i];
+  if (align != NULL)
+    buf_info->align = *align;
+  finfo = gst_video_format_get_info (buf_info->format);
 
-    buf_info->plane_offset[i] = buf_info->outbuf_size;
+  for (i = 0; i < buf_info->n_planes; i++) {
+    GstVideoAlignment *a = &buf_info->align;
+    gint pstride = buf_info->plane_pixel_stride[i];
+    gint hedge = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, i, a->padding_left);
+    gint vedge = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i, a->padding_top);
+    gint stride = GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, i,
+        a->padding_left + buf_info->width + a->padding_right) * pstride;
+    gint sliceheight = GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i,
+        a->padding_top + buf_info->height + a->padding_bottom);
+
+    /* stride_align is a mask, as in gst_video_info_align() */
+    stride = (stride + a->stride_align[i]) & ~a->stride_align[i];
+
+    /* The plane starts at plane_base, the visible image at plane_offset */
+    buf_info->plane_base[i] = buf_info->outbuf_size;
+    buf_info->plane_offset[i] = buf_info->outbuf_size +
+        vedge * stride + hedge * pstride;
     buf_info->plane_stride[i] = stride;
     buf_info->plane_size[i] = stride * sliceheight;
 
@@ -502,137 +1048,42 @@ gst_vspm_filter_set_buffer_info (GstVspmFilter * space,
   return;
 }
 
-static GstFlowReturn
-gst_vspm_filter_allocate_buffer (GstVspmFilter * space)
-{
-  VspmBufferInfo *buf_info;
-  Vspm_mmng_ar *vspm_out;
-  VspmbufArray *vspm_outbuf;
-  gint vspm_used;
-  guint i, j;
-  gint page_size;
-  gint dmabuf_fd[GST_VIDEO_MAX_PLANES] = { 0, };
-  gint dmabuf_page_offset[GST_VIDEO_MAX_PLANES];
-  gint dmabuf_plane_size_ext[GST_VIDEO_MAX_PLANES];;
-
-  buf_info = &space->buf_info;
-  vspm_out = space->vspm_out;
-  vspm_outbuf = space->vspm_outbuf;
-  page_size = getpagesize();
-
-  for (i = 0; i < MAX_BUFFERS; i++) {
-    GstBuffer *buf;
-    vspm_used = vspm_out->used;
-    if (R_MM_OK == mmngr_alloc_in_user(&vspm_out->vspm[vspm_used].mmng_pid,
-                                       buf_info->outbuf_size,
-                                       &vspm_out->vspm[vspm_used].pphy_addr,
-                                       &vspm_out->vspm[vspm_used].phard_addr,
-                                       &vspm_out->vspm[vspm_used].puser_virt_addr,
-                                       MMNGR_VA_SUPPORT_CACHED)) {
-      vspm_out->used++;
-      if (space->use_dmabuf) {
-        buf = gst_buffer_new ();
-        for (j = 0; j < buf_info->n_planes; j++) {
-          gint res;
-          guint phys_addr;
-          GstMemory *mem;
-          phys_addr = (guint)vspm_out->vspm[vspm_used].phard_addr +
-                      buf_info->plane_offset[j];
-          /* Calculate offset between physical address and page boundary */
-          dmabuf_page_offset[j] = phys_addr & (page_size - 1);
-          /* When downstream plugins do mapping from dmabuf fd it requires
-          * mapping from boundary page and size align for page size so
-          * memory for plane must increase to handle for this case */
-          dmabuf_plane_size_ext[j] = GST_ROUND_UP_N(
-              buf_info->plane_size[j] + dmabuf_page_offset[j], page_size);
-          res = mmngr_export_start_in_user (&vspm_out->vspm[vspm_used].dmabuf_pid[j],
-                                            dmabuf_plane_size_ext[j],
-                                            (unsigned long) GST_ROUND_DOWN_N(phys_addr, page_size),
-					    &dmabuf_fd[j]);
-          if (res != R_MM_OK) {
-            GST_ERROR_OBJECT (space,
-              "mmngr_export_start_in_user failed (phys_addr:0x%08x)",
-              phys_addr);
-            return GST_FLOW_ERROR;
-          }
-
-          /* Set offset's information */
-          mem = gst_dmabuf_allocator_alloc (space->allocator, dmabuf_fd[j],
-                                            dmabuf_plane_size_ext[j]);
-          mem->offset = dmabuf_page_offset[j];
-          /* Only allow to access plane size */
-          mem->size = buf_info->plane_size[j];
-          gst_buffer_append_memory (buf, mem);
-        }
-      } else {
-        buf = gst_buffer_new_wrapped (
-                (gpointer)vspm_out->vspm[vspm_used].puser_virt_addr,
-                (gsize)buf_info->outbuf_size);
-      }
-    } else {
-      GST_ERROR_OBJECT (space,
-            "mmngr_alloc_in_user failed to allocate memory (%d)",
-            buf_info->outbuf_size);
-      return GST_FLOW_ERROR;
-    }
-
-    g_ptr_array_add (vspm_outbuf->buf_array, buf);
-    gst_buffer_add_video_meta_full(buf, GST_VIDEO_FRAME_FLAG_NONE,
-                                   buf_info->format,
-                                   buf_info->width, buf_info->height,
-                                   buf_info->n_planes,
-                                   buf_info->plane_offset, buf_info->plane_stride);
-  }
-
-  return GST_FLOW_OK;
-}
-
-static void
-gst_vspm_filter_free_buffer (GstVspmFilter * space)
+/* (Re)configure the output pool for the current buffer info. The pool
+ * keeps at least what downstream holds plus the frames in the hardware,
+ * and only grows up to max-buffers (or the downstream maximum) */
+static gboolean
+gst_vspm_filter_configure_pool (GstVspmFilter * space, GstCaps * caps,
+    guint down_min, guint down_max)
 {
-  VspmBufferInfo *buf_info;
-  Vspm_mmng_ar *vspm_in, *vspm_out;
-  gint i, vspm_used;
-  VspmbufArray *vspm_outbuf;
-
-  vspm_in = space->vspm_in;
-  vspm_out = space->vspm_out;
-  vspm_outbuf = space->vspm_outbuf;
-
-  if (vspm_outbuf->buf_array->len > 0) {
-    g_ptr_array_remove_index(vspm_outbuf->buf_array,
-                             vspm_outbuf->buf_array->len - 1);
-  }
-
-  /* Release the importing to avoid leak FD */
-  gst_vspm_filter_release_fd (space->mmngr_import_list);
-
-  while (vspm_in->used) {
-    vspm_used = vspm_in->used - 1;
-
-    for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
-      if(vspm_in->vspm[vspm_used].dmabuf_pid[i] >= 0) {
-        mmngr_import_end_in_user(vspm_in->vspm[vspm_used].dmabuf_pid[i]);
-      }
-    }
-
-    vspm_in->used--;
+  GstStructure *config;
+  guint min, max;
+
+  min = MAX (space->min_buffers, down_min + space->max_inflight);
+  max = space->max_buffers;
+  if (down_max > 0 && (max == 0 || down_max < max))
+    max = down_max;
+  if (max > 0 && max < min)
+    max = min;
+
+  config = gst_buffer_pool_get_config (space->out_port_pool);
+  if (caps == NULL)
+    gst_buffer_pool_config_get_params (config, &caps, NULL, NULL, NULL);
+  gst_buffer_pool_config_set_params (config, caps,
+                                     space->buf_info.outbuf_size, min, max);
+  /* The pool lays out its buffers the same way as space->buf_info */
+  gst_buffer_pool_config_add_option (config,
+      GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+  gst_buffer_pool_config_set_video_alignment (config, &space->buf_info.align);
+  if (!gst_vspmfilter_buffer_pool_reconfigure (&space->out_port_pool,
+          config)) {
+    GST_WARNING_OBJECT (space, "failed to set buffer pool configuration");
+    return FALSE;
   }
 
-  while (vspm_out->used) {
-    vspm_used = vspm_out->used - 1;
-
-    for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
-      if (vspm_out->vspm[vspm_used].dmabuf_pid[i] >= 0) {
-        mmngr_export_end_in_user(vspm_out->vspm[vspm_used].dmabuf_pid[i]);
-      }
-    }
+  GST_DEBUG_OBJECT (space, "output pool of %u bytes, min %u max %u buffers",
+      space->buf_info.outbuf_size, min, max);
 
-    if (vspm_out->vspm[vspm_used].mmng_pid >= 0) {
-      mmngr_free_in_user(vspm_out->vspm[vspm_used].mmng_pid);
-    }
-    vspm_out->used--;
-  }
+  return TRUE;
 }
 
 static gboolean
@@ -641,8 +1092,7 @@ gst_vspm_filter_set_info (GstVideoFilter * filter,
     GstVideoInfo * out_info)
 {
   GstVspmFilter *space;
-  GstStructure *structure;
-  gint i;
+  GstVspmFilterVspInfo *vsp_info;
 
   space = GST_VIDEO_CONVERT_CAST (filter);
   /* these must match */
@@ -655,25 +1105,52 @@ gst_vspm_filter_set_info (GstVideoFilter * filter,
 
   GST_DEBUG ("reconfigured %d %d", GST_VIDEO_INFO_FORMAT (in_info),
       GST_VIDEO_INFO_FORMAT (out_info));
+
+  /* Push the jobs of the previous caps before anything they use changes.
+   * A CAPS event drained them already, but the crop properties and a
+   * downstream RECONFIGURE get here from the streaming thread without
+   * one. The base class sends the new caps downstream after set_info */
+  if (gst_vspm_filter_drain (space, TRUE) != GST_FLOW_OK)
+    GST_DEBUG_OBJECT (space, "jobs of the previous caps not pushed");
+
+  /* the job parameters are rebuilt for the new caps */
+  space->job_tmpl.valid = FALSE;
+  gst_vspm_filter_bounce_clear (space);
+  gst_vspm_filter_passes_clear (space);
+
+  vsp_info = space->vsp_info;
+  vsp_info->format_flag = 0;
+  if (gst_vspm_set_colorspace (GST_VIDEO_INFO_FORMAT (in_info),
+          &vsp_info->in_format, &vsp_info->in_swapbit) == 0 &&
+      gst_vspm_set_colorspace_output (GST_VIDEO_INFO_FORMAT (out_info),
+          &vsp_info->out_format, &vsp_info->out_swapbit) == 0)
+    vsp_info->format_flag = 1;
+  else if (!gst_vspm_filter_software_enabled (space))
+    goto unsupported_format;
+
+  /* same caps do not mean nothing to do when cropping */
+  if (space->crop_left || space->crop_right ||
+      space->crop_top || space->crop_bottom)
+    gst_base_transform_set_passthrough (GST_BASE_TRANSFORM (filter), FALSE);
   if(space->outbuf_allocate) {
-    gst_vspm_filter_set_buffer_info (space, out_info, NULL);
+    gst_vspm_filter_set_buffer_info (&space->buf_info, out_info, NULL);
 
-    if (space->out_port_pool) {
+    /* Keep the pool over a renegotiation, its buffers go back to it as
+     * downstream releases them and their memory is reused when it fits */
+    if (space->out_port_pool &&
+        GST_VSPMFILTER_BUFFER_POOL_CAST (space->out_port_pool)->use_dmabuf !=
+        space->use_dmabuf) {
       if (gst_buffer_pool_is_active (space->out_port_pool))
         gst_buffer_pool_set_active (space->out_port_pool, FALSE);
       gst_object_unref (space->out_port_pool);
+      space->out_port_pool = NULL;
     }
 
-    /* create a new buffer pool*/
-    space->out_port_pool = gst_vspmfilter_buffer_pool_new (space);
-
-    structure = gst_buffer_pool_get_config (space->out_port_pool);
-    gst_buffer_pool_config_set_params(structure, outcaps,
-                                      space->buf_info.outbuf_size,
-                                      MIN_BUFFERS, MAX_BUFFERS);
-    if (!gst_buffer_pool_set_config (space->out_port_pool, structure)) {
-      GST_WARNING_OBJECT (space, "failed to set buffer pool configuration");
-    }
+    if (space->out_port_pool == NULL)
+      space->out_port_pool = gst_vspmfilter_buffer_pool_new (
+          GST_ELEMENT (space), space->use_dmabuf);
+    if (!gst_vspm_filter_configure_pool (space, outcaps, 0, 0))
+      return FALSE;
   }
 
   return TRUE;
@@ -684,6 +1161,122 @@ format_mismatch:
     GST_ERROR_OBJECT (space, "input and output formats do not match");
     return FALSE;
   }
+unsupported_format:
+  {
+    GST_ERROR_OBJECT (space, "format %s -> %s is not supported by the VSP",
+        GST_VIDEO_INFO_NAME (in_info), GST_VIDEO_INFO_NAME (out_info));
+    return FALSE;
+  }
+}
+
+/* Offer upstream a pool of mmngr buffers, whose hardware addresses are
+ * known without any translation */
+static gboolean
+gst_vspm_filter_propose_allocation (GstBaseTransform * trans,
+    GstQuery * decide_query, GstQuery * query)
+{
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST(trans);
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstVideoAlignment align;
+  GstCaps *caps, *pool_caps;
+  GstVideoInfo info;
+  GstCapsFeatures *features;
+  gboolean need_pool, use_dmabuf;
+  guint size, min, i;
+
+  /* propose the metadata allowed by filter_meta. This skips
+   * GstVideoFilter, which would put a system memory pool at index 0 of the
+   * query, where most producers would take it instead of ours */
+  if (!GST_BASE_TRANSFORM_CLASS (g_type_class_peek
+          (GST_TYPE_BASE_TRANSFORM))->propose_allocation (trans,
+          decide_query, query))
+    return FALSE;
+
+  /* passthrough, the query was forwarded downstream */
+  if (decide_query == NULL)
+    return TRUE;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+
+  /* unless downstream already offered them */
+  if (!gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL))
+    gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  /* cropping is free, it is part of the VSP job */
+  if (!gst_query_find_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE,
+          NULL))
+    gst_query_add_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE,
+        NULL);
+
+  if (!need_pool)
+    return TRUE;
+
+  /* The input pool follows what upstream asks for, dmabuf-use is about
+   * the output buffers. Its buffers carry their hardware address in any
+   * case, so dmabuf is only exported for caps with the memory:DMABuf
+   * feature, sparing every other producer the fds and mmaps */
+  features = gst_caps_get_features (caps, 0);
+  use_dmabuf = features != NULL &&
+      gst_caps_features_contains (features, "memory:DMABuf");
+
+  /* reuse the pool we proposed before when the caps did not change */
+  pool = space->in_port_pool;
+  if (pool) {
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_get_params (config, &pool_caps, NULL, NULL, NULL);
+    if (!pool_caps || !gst_caps_is_equal (caps, pool_caps)) {
+      /* An idle pool of the same memory is reconfigured below, keeping
+       * its spare memory */
+      if (gst_buffer_pool_is_active (pool) ||
+          GST_VSPMFILTER_BUFFER_POOL_CAST (pool)->use_dmabuf != use_dmabuf) {
+        gst_object_unref (pool);
+        space->in_port_pool = NULL;
+      }
+      pool = NULL;
+    }
+    gst_structure_free (config);
+  }
+
+  /* we hold one buffer per queued job */
+  min = space->max_inflight + 1;
+
+  if (pool == NULL) {
+    pool = space->in_port_pool;
+    if (pool == NULL)
+      pool = gst_vspmfilter_buffer_pool_new (GST_ELEMENT (space),
+          use_dmabuf);
+
+    /* Keep the default GstVideoInfo stride alignment, for producers which
+     * ignore the video meta */
+    gst_video_alignment_reset (&align);
+    for (i = 0; i < GST_VIDEO_MAX_PLANES; i++)
+      align.stride_align[i] = 3;
+
+    config = gst_buffer_pool_get_config (pool);
+    gst_buffer_pool_config_set_params (config, caps, info.size, min, 0);
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_META);
+    gst_buffer_pool_config_add_option (config,
+        GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+    gst_buffer_pool_config_set_video_alignment (config, &align);
+    if (!gst_buffer_pool_set_config (pool, config)) {
+      GST_WARNING_OBJECT (space, "failed to set input pool configuration");
+      gst_object_unref (pool);
+      space->in_port_pool = NULL;
+      return FALSE;
+    }
+    space->in_port_pool = pool;
+  }
+
+  size = GST_VSPMFILTER_BUFFER_POOL_CAST (pool)->buf_info.outbuf_size;
+  gst_query_add_allocation_pool (query, pool, size, min, 0);
+
+  GST_DEBUG_OBJECT (space, "proposed mmngr pool %" GST_PTR_FORMAT
+      " of %u bytes", pool, size);
+
+  return TRUE;
 }
 
 static gboolean
@@ -696,10 +1289,11 @@ gst_vspm_filter_decide_allocation (GstBaseTransform * trans, GstQuery * query)
     GstBufferPool *pool = NULL;
     GstStructure *config;
     GstVideoAlignment align;
+    guint min = 0, max = 0;
     guint i;
 
     if (gst_query_get_n_allocation_pools (query)) {
-      gst_query_parse_nth_allocation_pool(query, 0, &pool, NULL, NULL, NULL);
+      gst_query_parse_nth_allocation_pool(query, 0, &pool, NULL, &min, &max);
       if (pool) {
         config = gst_buffer_pool_get_config(pool);
 
@@ -711,47 +1305,43 @@ gst_vspm_filter_decide_allocation (GstBaseTransform * trans, GstQuery * query)
           gst_video_alignment_reset(&align);
           gst_buffer_pool_config_get_video_alignment(config, &align);
 
-          /* FIXME: Currently, we ignore padding and only check stride */
-          GST_DEBUG_OBJECT(space, "got a stride alignment requirement from "
-                                  "downstream %d:%d:%d:%d",
+          GST_DEBUG_OBJECT(space, "got an alignment requirement from "
+                                  "downstream padding %u-%ux%u-%u "
+                                  "stride %d:%d:%d:%d",
+                                  align.padding_top, align.padding_left,
+                                  align.padding_right, align.padding_bottom,
                                   align.stride_align[0], align.stride_align[1],
                                   align.stride_align[2], align.stride_align[3]);
 
+          update = (align.padding_top || align.padding_bottom ||
+                    align.padding_left || align.padding_right);
           for (i = 0; i < GST_VIDEO_MAX_PLANES; i++) {
-            if ((align.stride_align[i] != 0) &&
-                (space->buf_info.plane_stride[i] % align.stride_align[i] != 0)) {
+            if (space->buf_info.plane_stride[i] & align.stride_align[i]) {
               update = TRUE;
               break;
             }
           }
         }
+        gst_structure_free (config);
+        gst_object_unref (pool);
       }
     }
 
     if (update) {
-      GstStructure *structure;
-      GstCaps *caps = NULL;
-
       GST_DEBUG_OBJECT(space, "update buffer info and buffer pool");
+      gst_vspm_filter_set_buffer_info (&space->buf_info, NULL, &align);
+    }
 
-      if (space->out_port_pool) {
-        if (gst_buffer_pool_is_active (space->out_port_pool)) {
-          gst_buffer_pool_set_active (space->out_port_pool, FALSE);
-        }
-      }
-
-      gst_vspm_filter_set_buffer_info (space, NULL, &align);
-
-      structure = gst_buffer_pool_get_config (space->out_port_pool);
-      gst_buffer_pool_config_get_params(structure, &caps, NULL, NULL, NULL);
-
-      gst_buffer_pool_config_set_params(structure, caps,
-                                        space->buf_info.outbuf_size,
-                                        MIN_BUFFERS, MAX_BUFFERS);
+    /* vspmfilter always use its own buffer pool, sized for downstream */
+    if (!gst_vspm_filter_configure_pool (space, NULL, min, max))
+      return FALSE;
 
-      if (!gst_buffer_pool_set_config (space->out_port_pool, structure)) {
-        GST_WARNING_OBJECT (space, "failed to set buffer pool configuration");
-      }
+    /* Allocate and export the minimum number of buffers now rather than on
+     * the first frame. Their hardware addresses are kept on the buffers, so
+     * the first frame only costs its VSP job */
+    if (!gst_buffer_pool_set_active (space->out_port_pool, TRUE)) {
+      GST_ERROR_OBJECT (space, "failed to activate buffer pool");
+      return FALSE;
     }
   }
 
@@ -762,32 +1352,27 @@ static GstFlowReturn gst_vspm_filter_prepare_output_buffer (GstBaseTransform * t
                                           GstBuffer *inbuf, GstBuffer **outbuf)
 {
     GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (trans);
-    GstBuffer *buf;
-    guint n_mem,i;
     GstFlowReturn ret = GST_FLOW_OK;
-    Vspm_mmng_ar *vspm_out;
-    VspmbufArray *vspm_outbuf;
-
-    vspm_out    = space->vspm_out;
-    vspm_outbuf = space->vspm_outbuf;
+    gint64 start;
 
     if(space->outbuf_allocate) {
       trans->priv->passthrough = 0; //disable pass-through mode
 
-      /* Allocate buffer and buffer pool */
-      if (space->vspm_out->used == 0) {
-        ret = gst_vspm_filter_allocate_buffer(space);
-        if (ret != GST_FLOW_OK) {
-          return ret;
-        } else {
-          if (!gst_buffer_pool_is_active(space->out_port_pool)) {
-            if (!gst_buffer_pool_set_active(space->out_port_pool, TRUE))
-              GST_WARNING_OBJECT(space, "failed to activate buffer pool");
-          }
+      /* Normally done in decide_allocation already */
+      if (!gst_buffer_pool_is_active(space->out_port_pool)) {
+        if (!gst_buffer_pool_set_active(space->out_port_pool, TRUE)) {
+          GST_ERROR_OBJECT(space, "failed to activate buffer pool");
+          return GST_FLOW_ERROR;
         }
       }
 
+      /* Blocks while downstream holds all buffers and the pool is full */
+      start = g_get_monotonic_time ();
       ret = gst_buffer_pool_acquire_buffer(space->out_port_pool, outbuf, NULL);
+      gst_vspm_filter_stats_add (space, &space->stats.pool_wait,
+          g_get_monotonic_time () - start);
+      if (ret != GST_FLOW_OK)
+        return ret;
 
       if(gst_buffer_is_writable(*outbuf)) {
         if (!GST_BASE_TRANSFORM_CLASS(parent_class)->copy_metadata (trans,
@@ -805,38 +1390,170 @@ static GstFlowReturn gst_vspm_filter_prepare_output_buffer (GstBaseTransform * t
     return ret;
 }
 
-static GstStateChangeReturn
-gst_vspmfilter_change_state (GstElement * element, GstStateChange transition)
+static gboolean
+gst_vspm_filter_sink_event (GstBaseTransform * trans, GstEvent * event)
 {
-  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (element);
-
-  switch (transition) {
-    case GST_STATE_CHANGE_PAUSED_TO_READY:
-      if (space->out_port_pool)
-        gst_buffer_pool_set_active (space->out_port_pool, FALSE);
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (trans);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_STOP:
+      /* The hardware can not be stopped, wait for it and drop the results */
+      gst_vspm_filter_drain (space, FALSE);
+      GST_OBJECT_LOCK (space);
+      space->earliest_time = GST_CLOCK_TIME_NONE;
+      GST_OBJECT_UNLOCK (space);
+      break;
+    default:
+      /* Serialized events must stay behind the frames still in the hardware */
+      if (GST_EVENT_IS_SERIALIZED (event))
+        gst_vspm_filter_drain (space, TRUE);
+      break;
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->sink_event (trans, event);
+}
+
+static gboolean
+gst_vspm_filter_src_event (GstBaseTransform * trans, GstEvent * event)
+{
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (trans);
+
+  if (GST_EVENT_TYPE (event) == GST_EVENT_QOS) {
+    GstQOSType type;
+    gdouble proportion;
+    GstClockTimeDiff diff;
+    GstClockTime timestamp;
+
+    /* The base class keeps its own copy, which it does not share */
+    gst_event_parse_qos (event, &type, &proportion, &diff, &timestamp);
+    if (type != GST_QOS_TYPE_THROTTLE) {
+      GST_OBJECT_LOCK (space);
+      if ((GstClockTimeDiff) timestamp + diff > 0)
+        space->earliest_time = timestamp + diff;
+      else
+        space->earliest_time = GST_CLOCK_TIME_NONE;
+      GST_OBJECT_UNLOCK (space);
+    }
+  }
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->src_event (trans, event);
+}
+
+static gboolean
+gst_vspm_filter_query (GstBaseTransform * trans, GstPadDirection direction,
+    GstQuery * query)
+{
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (trans);
+  GstVideoInfo *out_info = &GST_VIDEO_FILTER (trans)->out_info;
+  gboolean ret;
+
+  if (direction == GST_PAD_SINK && GST_QUERY_TYPE (query) == GST_QUERY_DRAIN)
+    gst_vspm_filter_drain (space, TRUE);
+
+  ret = GST_BASE_TRANSFORM_CLASS (parent_class)->query (trans, direction, query);
+
+  if (ret && direction == GST_PAD_SRC &&
+      GST_QUERY_TYPE (query) == GST_QUERY_LATENCY) {
+    GstClockTime min, max, latency;
+    gboolean live;
+
+    /* Every frame spends the measured job time in the hardware */
+    GST_OBJECT_LOCK (space);
+    latency = space->job_time;
+    space->reported_job_time = space->job_time;
+    GST_OBJECT_UNLOCK (space);
+
+    /* A frame leaves the element when the (max_inflight - 1)th frame after
+     * it has been queued */
+    if (space->max_inflight > 1 && out_info->fps_n > 0)
+      latency += gst_util_uint64_scale (GST_SECOND * (space->max_inflight - 1),
+          out_info->fps_d, out_info->fps_n);
+
+    GST_DEBUG_OBJECT (space, "adding %" GST_TIME_FORMAT " of latency",
+        GST_TIME_ARGS (latency));
+
+    gst_query_parse_latency (query, &live, &min, &max);
+    min += latency;
+    if (GST_CLOCK_TIME_IS_VALID (max))
+      max += latency;
+    gst_query_set_latency (query, live, min, max);
+  }
+
+  return ret;
+}
+
+static GstStateChangeReturn
+gst_vspmfilter_change_state (GstElement * element, GstStateChange transition)
+{
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (element);
+  GstStateChangeReturn ret;
+  guint64 hits, misses;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_vspm_session_acquire (&space->vsp_info->vspm_handle,
+              &space->vsp_info->mmngr_fd)) {
+        GST_ELEMENT_ERROR (space, RESOURCE, OPEN_READ_WRITE,
+            ("Could not open the VSPM driver"), (NULL));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      space->vsp_info->is_init_vspm = TRUE;
+      GST_OBJECT_LOCK (space);
+      space->earliest_time = GST_CLOCK_TIME_NONE;
+      space->qos_processed = space->qos_dropped = 0;
+      memset (&space->stats, 0, sizeof (space->stats));
+      GST_OBJECT_UNLOCK (space);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      if (space->out_port_pool)
+        gst_buffer_pool_set_active (space->out_port_pool, FALSE);
       break;
     case GST_STATE_CHANGE_READY_TO_NULL:
+      gst_vspm_filter_bounce_clear (space);
+      gst_vspm_filter_passes_clear (space);
       if (space->out_port_pool) {
         gst_object_unref (space->out_port_pool);
         space->out_port_pool = NULL;
       }
-      /* Release the importing to avoid leak FD */
-      gst_vspm_filter_release_fd (space->mmngr_import_list);
+      if (space->in_port_pool) {
+        gst_object_unref (space->in_port_pool);
+        space->in_port_pool = NULL;
+      }
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* Streaming has stopped, drop the jobs which were still queued */
+      gst_vspm_filter_drain (space, FALSE);
+      GST_OBJECT_LOCK (space);
+      hits = space->stats.vtop_hits;
+      misses = space->stats.vtop_misses;
+      GST_OBJECT_UNLOCK (space);
+      GST_DEBUG_OBJECT (space, "VtoP cache: %" G_GUINT64_FORMAT " hits, %"
+          G_GUINT64_FORMAT " misses", hits, misses);
+      if (space->vsp_info->is_init_vspm) {
+        gst_vspm_session_release ();
+        space->vsp_info->is_init_vspm = FALSE;
+        space->vsp_info->mmngr_fd = -1;
+      }
       break;
     default:
       break;
   }
-  return   GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  return ret;
 }
 
 static void
 gst_vspm_filter_class_init (GstVspmFilterClass * klass)
 {
-  int nr_exts;
-  int i;
   GstCaps* incaps;
   GstCaps* outcaps;
-  GstCaps* tmpcaps;
   GstPadTemplate* gst_vspm_filter_src_template;
   GstPadTemplate* gst_vspm_filter_sink_template;
 
@@ -850,30 +1567,12 @@ gst_vspm_filter_class_init (GstVspmFilterClass * klass)
   gobject_class->get_property = gst_vspm_filter_get_property;
   gobject_class->finalize = gst_vspm_filter_finalize;
 
-  incaps  = gst_caps_new_empty();
-  outcaps = gst_caps_new_empty();
-
-  nr_exts = sizeof (exts) / sizeof (exts[0]);
-  for (i = 0; i < nr_exts; i++) {
-	tmpcaps = gst_caps_new_simple ("video/x-raw",
-            "format", G_TYPE_STRING, gst_video_format_to_string (exts[i].gst_format),
-            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-            "framerate", GST_TYPE_FRACTION_RANGE, 0, 1, G_MAXINT, 1, NULL);
-
-    gst_caps_append (incaps, tmpcaps);
-  }
-
-  nr_exts = sizeof (exts_out) / sizeof (exts_out[0]);
-  for (i = 0; i < nr_exts; i++) {
-	tmpcaps = gst_caps_new_simple ("video/x-raw",
-            "format", G_TYPE_STRING, gst_video_format_to_string (exts_out[i].gst_format),
-            "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-            "height", GST_TYPE_INT_RANGE, 1, G_MAXINT,
-            "framerate", GST_TYPE_FRACTION_RANGE, 0, 1, G_MAXINT, 1, NULL);
-
-    gst_caps_append (outcaps, tmpcaps);
-  }
+  incaps  = gst_vspm_caps_new (FALSE);
+  outcaps = gst_vspm_caps_new (TRUE);
+#ifdef HAVE_VSPM_SOFTWARE
+  gst_vspm_filter_append_software_caps (incaps, FALSE);
+  gst_vspm_filter_append_software_caps (outcaps, TRUE);
+#endif
 
   gst_vspm_filter_src_template = gst_pad_template_new ("src",
 		GST_PAD_SRC, GST_PAD_ALWAYS, incaps);
@@ -901,6 +1600,74 @@ gst_vspm_filter_class_init (GstVspmFilterClass * klass)
       g_param_spec_boolean ("dmabuf-use", "Use DMABUF mode",
         "Whether or not to use dmabuf for output buffer",
         FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_MIN_BUFFERS,
+      g_param_spec_uint ("min-buffers", "Minimum output buffers",
+        "Number of output buffers allocated up front in outbuf-alloc mode",
+        1, G_MAXUINT, MIN_BUFFERS,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_MAX_BUFFERS,
+      g_param_spec_uint ("max-buffers", "Maximum output buffers",
+        "Number of output buffers the pool may grow to in outbuf-alloc mode "
+        "(0 = unlimited)",
+        0, G_MAXUINT, MAX_BUFFERS,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_MAX_INFLIGHT,
+      g_param_spec_uint ("max-inflight", "Maximum in-flight jobs",
+        "Number of jobs queued to VSPM at once (1 = wait for each frame)",
+        1, MAX_INFLIGHT, DEFAULT_MAX_INFLIGHT,
+        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_CROP_LEFT,
+      g_param_spec_uint ("crop-left", "Crop left",
+        "Pixels to crop at the left of the input", 0, G_MAXINT, 0,
+        G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_CROP_RIGHT,
+      g_param_spec_uint ("crop-right", "Crop right",
+        "Pixels to crop at the right of the input", 0, G_MAXINT, 0,
+        G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_CROP_TOP,
+      g_param_spec_uint ("crop-top", "Crop top",
+        "Pixels to crop at the top of the input", 0, G_MAXINT, 0,
+        G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_CROP_BOTTOM,
+      g_param_spec_uint ("crop-bottom", "Crop bottom",
+        "Pixels to crop at the bottom of the input", 0, G_MAXINT, 0,
+        G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_ADD_BORDERS,
+      g_param_spec_boolean ("add-borders", "Add Borders",
+        "Keep the display aspect ratio, adding borders if necessary",
+        FALSE, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+        G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_BORDER_COLOR,
+      g_param_spec_uint ("border-color", "Border Color",
+        "Color of the borders as ARGB8888", 0, G_MAXUINT32,
+        DEFAULT_BORDER_COLOR, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+        G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_CHANNEL,
+      g_param_spec_int ("vsp-channel", "VSP channel",
+        "VSP channel to run the jobs on "
+        "(-1 = the one with the fewest jobs in flight)",
+        -1, MAX_DEVICES - 1, DEFAULT_VSP_CHANNEL,
+        G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+        G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+        "Counters and time histograms of the frame path: VtoP translation, "
+        "dmabuf import, VSP job, output buffer wait, bounce buffer copies, "
+        "software conversions, intermediate passes, skipped and zero-copy "
+        "frames and CMA memory in use",
+        GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_SOFTWARE_FALLBACK,
+      g_param_spec_boolean ("software-fallback", "Software fallback",
+        "Convert on the CPU the frames the VSP can not (format, size or "
+        "scale ratio out of its limits) instead of dropping them",
+        DEFAULT_SOFTWARE_FALLBACK, G_PARAM_READWRITE |
+        GST_PARAM_MUTABLE_READY | G_PARAM_STATIC_STRINGS));
+  g_object_class_install_property (gobject_class, PROP_VSPM_SPLIT_FRAME,
+      g_param_spec_boolean ("split-frame", "Split frame",
+        "Convert each frame in vertical stripes run at the same time on "
+        "all the VSP channels, for a lower latency (with vsp-channel=-1)",
+        DEFAULT_SPLIT_FRAME, G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+        G_PARAM_STATIC_STRINGS));
   gstelement_class->change_state = gst_vspmfilter_change_state;
   gstbasetransform_class->transform_caps =
       GST_DEBUG_FUNCPTR (gst_vspm_filter_transform_caps);
@@ -911,16 +1678,28 @@ gst_vspm_filter_class_init (GstVspmFilterClass * klass)
   gstbasetransform_class->transform_meta =
       GST_DEBUG_FUNCPTR (gst_vspm_filter_transform_meta);
 
+  gstbasetransform_class->sink_event =
+      GST_DEBUG_FUNCPTR (gst_vspm_filter_sink_event);
+  gstbasetransform_class->src_event =
+      GST_DEBUG_FUNCPTR (gst_vspm_filter_src_event);
+  gstbasetransform_class->query =
+      GST_DEBUG_FUNCPTR (gst_vspm_filter_query);
+
   gstbasetransform_class->passthrough_on_same_caps = TRUE;
 
   gstbasetransform_class->prepare_output_buffer = 
       GST_DEBUG_FUNCPTR (gst_vspm_filter_prepare_output_buffer);
+  gstbasetransform_class->propose_allocation =
+      GST_DEBUG_FUNCPTR (gst_vspm_filter_propose_allocation);
   gstbasetransform_class->decide_allocation =
       GST_DEBUG_FUNCPTR (gst_vspm_filter_decide_allocation);
   gstvideofilter_class->set_info =
       GST_DEBUG_FUNCPTR (gst_vspm_filter_set_info);
   gstvideofilter_class->transform_frame =
       GST_DEBUG_FUNCPTR (gst_vspm_filter_transform_frame);
+  /* replaces the one of GstVideoFilter, which maps every frame */
+  gstbasetransform_class->transform =
+      GST_DEBUG_FUNCPTR (gst_vspm_filter_transform_buffer);
 }
 
 static void
@@ -928,44 +1707,22 @@ gst_vspm_filter_finalize (GObject * obj)
 {
   GstVspmFilter *space = GST_VIDEO_CONVERT (obj);
   GstVspmFilterVspInfo *vsp_info;
-  Vspm_mmng_ar *vspm_in;
-  Vspm_mmng_ar *vspm_out;
 
   vsp_info = space->vsp_info;
-  vspm_in = space->vspm_in;
-  vspm_out = space->vspm_out;
-
-  if (vsp_info->mmngr_fd != -1) {
-    /* mmngr dev close */
-    close (vsp_info->mmngr_fd);
-    vsp_info->mmngr_fd = -1;
-  }
 
   if (vsp_info->is_init_vspm) {
-    VSPM_lib_DriverQuit(vsp_info->vspm_handle);
+    gst_vspm_session_release ();
+    vsp_info->is_init_vspm = FALSE;
   }
 
-  if (vspm_in->used || vspm_out->used)
-    gst_vspm_filter_free_buffer (space);
-
   if (space->vsp_info)
     g_free (space->vsp_info);
-  if (space->mmngr_import_list)
-    g_queue_free (space->mmngr_import_list);
-  if (space->vspm_in)
-    g_free (space->vspm_in);
-  /* free buf_array when finalize */
-  if (space->vspm_outbuf->buf_array)
-    g_ptr_array_free(space->vspm_outbuf->buf_array, TRUE);
-  if (space->vspm_out)
-    g_free (space->vspm_out);
-  if (space->vspm_outbuf)
-    g_free (space->vspm_outbuf);
-  /* free space->allocator when finalize */
-  if (space->allocator)
-    gst_object_unref(space->allocator);
-
-  sem_destroy (&space->smp_wait);
+  if (space->pending_jobs)
+    g_queue_free (space->pending_jobs);
+#ifdef HAVE_VSPM_SOFTWARE
+  gst_vspm_software_free (space->software);
+#endif
+
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
@@ -974,64 +1731,37 @@ static void
 gst_vspm_filter_init (GstVspmFilter * space)
 {
   GstVspmFilterVspInfo *vsp_info;
-  Vspm_mmng_ar *vspm_in;
-  Vspm_mmng_ar *vspm_out;
-  VspmbufArray *vspm_outbuf;
-  guint i, j;
 
   space->vsp_info = g_malloc0 (sizeof (GstVspmFilterVspInfo));
-  space->vspm_in = g_malloc0 (sizeof (Vspm_mmng_ar));
-  space->vspm_out = g_malloc0 (sizeof (Vspm_mmng_ar));
-  space->vspm_outbuf = g_malloc0 (sizeof (VspmbufArray));
-  if (!space->vsp_info 
-    || !space->vspm_in 
-    || !space->vspm_out
-    || !space->vspm_outbuf) {
+  if (!space->vsp_info) {
     GST_ELEMENT_ERROR (space, RESOURCE, NO_SPACE_LEFT,
         ("Could not allocate vsp info"), ("Could not allocate vsp info"));
     return;
   }
 
   vsp_info = space->vsp_info;
-  vspm_in = space->vspm_in;
-  vspm_out = space->vspm_out;
-  vspm_outbuf = space->vspm_outbuf;
 
   vsp_info->is_init_vspm = FALSE;
   vsp_info->format_flag = 0;
   vsp_info->mmngr_fd = -1;
-  /* mmngr dev open */
-  vsp_info->mmngr_fd = open(DEVFILE, O_RDWR);
-  if (vsp_info->mmngr_fd == -1) {
-    GST_ERROR ("MMNGR: open error. \n");
-  }
-  
-  if (VSPM_lib_DriverInitialize(&vsp_info->vspm_handle) == R_VSPM_OK) {
-    vsp_info->is_init_vspm = TRUE;
-  } else {
-    GST_ERROR ("VSPM: Error Initialized. \n");
-  }
+  /* the hardware is opened at READY->PAUSED, see gst_vspm_session_acquire */
 
-  vspm_in->used = 0;
-  vspm_out->used = 0;
-  vspm_outbuf->buf_array = g_ptr_array_new ();  
-  vspm_outbuf->current_buffer_index = 0;
-  space->allocator = gst_dmabuf_allocator_new ();
   space->outbuf_allocate = FALSE;
   space->use_dmabuf = FALSE;
   space->first_buff = 1;
-  space->mmngr_import_list = g_queue_new ();
-
-  for (i = 0; i < sizeof(vspm_in->vspm)/sizeof(vspm_in->vspm[0]); i++) {
-    for (j = 0; j < GST_VIDEO_MAX_PLANES; j++)
-      vspm_in->vspm[i].dmabuf_pid[j] = -1;
-  }
-  for (i = 0; i < sizeof(vspm_out->vspm)/sizeof(vspm_out->vspm[0]); i++) {
-    for (j = 0; j < GST_VIDEO_MAX_PLANES; j++)
-      vspm_out->vspm[i].dmabuf_pid[j] = -1;
-  }
-
-  sem_init (&space->smp_wait, 0, 0);
+  space->max_inflight = DEFAULT_MAX_INFLIGHT;
+  space->min_buffers = MIN_BUFFERS;
+  space->max_buffers = MAX_BUFFERS;
+  space->pending_jobs = g_queue_new ();
+  space->add_borders = FALSE;
+  space->border_color = DEFAULT_BORDER_COLOR;
+  space->vsp_channel = DEFAULT_VSP_CHANNEL;
+  space->software_fallback = DEFAULT_SOFTWARE_FALLBACK;
+  space->split_frame = DEFAULT_SPLIT_FRAME;
+  gst_vspm_filter_passes_clear (space);
+  space->job_time = 0;
+  space->reported_job_time = 0;
+  space->earliest_time = GST_CLOCK_TIME_NONE;
 }
 
 void
@@ -1051,6 +1781,46 @@ gst_vspm_filter_set_property (GObject * object, guint property_id,
       if (space->use_dmabuf)
           space->outbuf_allocate = TRUE;
       break;
+    case PROP_VSPM_MAX_INFLIGHT:
+      space->max_inflight = g_value_get_uint (value);
+      break;
+    case PROP_VSPM_MIN_BUFFERS:
+      space->min_buffers = g_value_get_uint (value);
+      break;
+    case PROP_VSPM_MAX_BUFFERS:
+      space->max_buffers = g_value_get_uint (value);
+      break;
+    case PROP_VSPM_CROP_LEFT:
+      space->crop_left = g_value_get_uint (value);
+      gst_base_transform_reconfigure_src (trans);
+      break;
+    case PROP_VSPM_CROP_RIGHT:
+      space->crop_right = g_value_get_uint (value);
+      gst_base_transform_reconfigure_src (trans);
+      break;
+    case PROP_VSPM_CROP_TOP:
+      space->crop_top = g_value_get_uint (value);
+      gst_base_transform_reconfigure_src (trans);
+      break;
+    case PROP_VSPM_CROP_BOTTOM:
+      space->crop_bottom = g_value_get_uint (value);
+      gst_base_transform_reconfigure_src (trans);
+      break;
+    case PROP_VSPM_ADD_BORDERS:
+      space->add_borders = g_value_get_boolean (value);
+      break;
+    case PROP_VSPM_BORDER_COLOR:
+      space->border_color = g_value_get_uint (value);
+      break;
+    case PROP_VSPM_CHANNEL:
+      space->vsp_channel = g_value_get_int (value);
+      break;
+    case PROP_VSPM_SOFTWARE_FALLBACK:
+      space->software_fallback = g_value_get_boolean (value);
+      break;
+    case PROP_VSPM_SPLIT_FRAME:
+      space->split_frame = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1069,6 +1839,45 @@ gst_vspm_filter_get_property (GObject * object, guint property_id,
     case PROP_VSPM_DMABUF:
       g_value_set_boolean (value, space->use_dmabuf);
       break;
+    case PROP_VSPM_MAX_INFLIGHT:
+      g_value_set_uint (value, space->max_inflight);
+      break;
+    case PROP_VSPM_MIN_BUFFERS:
+      g_value_set_uint (value, space->min_buffers);
+      break;
+    case PROP_VSPM_MAX_BUFFERS:
+      g_value_set_uint (value, space->max_buffers);
+      break;
+    case PROP_VSPM_CROP_LEFT:
+      g_value_set_uint (value, space->crop_left);
+      break;
+    case PROP_VSPM_CROP_RIGHT:
+      g_value_set_uint (value, space->crop_right);
+      break;
+    case PROP_VSPM_CROP_TOP:
+      g_value_set_uint (value, space->crop_top);
+      break;
+    case PROP_VSPM_CROP_BOTTOM:
+      g_value_set_uint (value, space->crop_bottom);
+      break;
+    case PROP_VSPM_ADD_BORDERS:
+      g_value_set_boolean (value, space->add_borders);
+      break;
+    case PROP_VSPM_BORDER_COLOR:
+      g_value_set_uint (value, space->border_color);
+      break;
+    case PROP_VSPM_CHANNEL:
+      g_value_set_int (value, space->vsp_channel);
+      break;
+    case PROP_VSPM_SOFTWARE_FALLBACK:
+      g_value_set_boolean (value, space->software_fallback);
+      break;
+    case PROP_VSPM_SPLIT_FRAME:
+      g_value_set_boolean (value, space->split_frame);
+      break;
+    case PROP_VSPM_STATS:
+      g_value_take_boxed (value, gst_vspm_filter_stats_new (space));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -1076,21 +1885,324 @@ gst_vspm_filter_get_property (GObject * object, guint property_id,
 }
 
 
+/* Account stripes the hardware finished, or which were never queued.
+ * The last one completes the frame */
+static void
+gst_vspm_filter_job_stripes_done (GstVspmFilterJob * job, gint n)
+{
+  if (g_atomic_int_add (&job->remaining, -n) != n)
+    return;
+
+  job->done_time = g_get_monotonic_time ();
+  g_atomic_int_set (&job->done, 1);
+  /* Inform frame finish to transform function */
+  sem_post (&job->smp_wait);
+}
+
 /* callback function */
 static void cb_func(
   unsigned long uwJobId, long wResult, unsigned long uwUserData)
 {
-  sem_t *p_smpwait = (sem_t *) uwUserData;
+  GstVspmFilterJobStripe *stripe = (GstVspmFilterJobStripe *) uwUserData;
+  GstVspmFilterJob *job = stripe->job;
 
+  /* one failed stripe spoils the whole frame */
   if (wResult != 0) {
-    GST_ERROR ("VSPM: error end. (%ld)\n", wResult);
+    GST_ERROR ("VSPM: error end of stripe %u. (%ld)\n",
+        (guint) (stripe - job->stripes), wResult);
+    job->result = wResult;
   }
-  /* Inform frame finish to transform function */
-  sem_post (p_smpwait);
+  if (stripe->channel >= 0)
+    gst_vspm_channel_release (stripe->channel);
+  gst_vspm_filter_job_stripes_done (job, 1);
+}
+
+static GstVspmFilterJob *
+gst_vspm_filter_job_new (GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstVspmFilterJob *job;
+
+  job = g_new0 (GstVspmFilterJob, 1);
+  job->inbuf = gst_buffer_ref (inbuf);
+  job->outbuf = gst_buffer_ref (outbuf);
+  sem_init (&job->smp_wait, 0, 0);
+
+  return job;
+}
+
+/* The output of a job the hardware failed is garbage: tell the
+ * application, the caller drops the buffer */
+static gboolean
+gst_vspm_filter_job_failed (GstVspmFilter * space, GstVspmFilterJob * job)
+{
+  if (job->result == 0)
+    return FALSE;
+
+  GST_ELEMENT_WARNING (space, STREAM, FAILED, (NULL),
+      ("VSP job failed (%ld), frame dropped", job->result));
+  return TRUE;
+}
+
+static void
+gst_vspm_filter_job_free (GstVspmFilterJob * job)
+{
+  sem_destroy (&job->smp_wait);
+  if (job->bounce_out)
+    gst_buffer_unref (job->bounce_out);
+  if (job->outbuf)
+    gst_buffer_unref (job->outbuf);
+  gst_buffer_unref (job->inbuf);
+  g_free (job);
+}
+
+/* Account elapsed microseconds spent in a stage */
+static void
+gst_vspm_filter_stats_add (GstVspmFilter * space, GstVspmFilterTiming * t,
+    gint64 elapsed)
+{
+  guint i;
+
+  for (i = 0; i < VSPM_STATS_BUCKETS - 1; i++)
+    if (elapsed <= vspm_stats_bounds[i])
+      break;
+
+  GST_OBJECT_LOCK (space);
+  t->count++;
+  t->total += elapsed * GST_USECOND;
+  t->max = MAX (t->max, elapsed * GST_USECOND);
+  t->histogram[i]++;
+  GST_OBJECT_UNLOCK (space);
+}
+
+static void
+gst_vspm_filter_stats_set_timing (GstStructure * s, const gchar * name,
+    GstVspmFilterTiming * t)
+{
+  GValue histogram = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  gchar *field;
+  guint i;
+
+  g_value_init (&histogram, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+  for (i = 0; i < VSPM_STATS_BUCKETS; i++) {
+    g_value_set_uint64 (&v, t->histogram[i]);
+    gst_value_array_append_value (&histogram, &v);
+  }
+  g_value_unset (&v);
+
+  field = g_strdup_printf ("%s-count", name);
+  gst_structure_set (s, field, G_TYPE_UINT64, t->count, NULL);
+  g_free (field);
+  field = g_strdup_printf ("%s-total", name);
+  gst_structure_set (s, field, G_TYPE_UINT64, t->total, NULL);
+  g_free (field);
+  field = g_strdup_printf ("%s-max", name);
+  gst_structure_set (s, field, G_TYPE_UINT64, t->max, NULL);
+  g_free (field);
+  field = g_strdup_printf ("%s-histogram", name);
+  gst_structure_take_value (s, field, &histogram);
+  g_free (field);
+}
+
+/* Snapshot of the statistics for the stats property */
+static GstStructure *
+gst_vspm_filter_stats_new (GstVspmFilter * space)
+{
+  GstVspmFilterStats stats;
+  GstStructure *s;
+  GValue bounds = G_VALUE_INIT;
+  GValue v = G_VALUE_INIT;
+  guint64 processed, dropped;
+  guint i;
+
+  GST_OBJECT_LOCK (space);
+  stats = space->stats;
+  processed = space->qos_processed;
+  dropped = space->qos_dropped;
+  GST_OBJECT_UNLOCK (space);
+
+  s = gst_structure_new ("GstVspmFilterStats",
+      "skipped", G_TYPE_UINT64, stats.skipped,
+      "zero-copy", G_TYPE_UINT64, stats.zero_copy,
+      "qos-processed", G_TYPE_UINT64, processed,
+      "qos-dropped", G_TYPE_UINT64, dropped,
+      "vtop-cache-hits", G_TYPE_UINT64, stats.vtop_hits,
+      "vtop-cache-misses", G_TYPE_UINT64, stats.vtop_misses,
+      "cma-bytes", G_TYPE_UINT64,
+      (guint64) MAX (g_atomic_int_get (&vspm_cma_bytes), 0), NULL);
+
+  g_value_init (&bounds, GST_TYPE_ARRAY);
+  g_value_init (&v, G_TYPE_UINT64);
+  for (i = 0; i < VSPM_STATS_BUCKETS - 1; i++) {
+    g_value_set_uint64 (&v, vspm_stats_bounds[i] * GST_USECOND);
+    gst_value_array_append_value (&bounds, &v);
+  }
+  g_value_unset (&v);
+  gst_structure_take_value (s, "histogram-bounds", &bounds);
+
+  gst_vspm_filter_stats_set_timing (s, "vtop", &stats.vtop);
+  gst_vspm_filter_stats_set_timing (s, "import", &stats.import);
+  gst_vspm_filter_stats_set_timing (s, "job", &stats.job);
+  gst_vspm_filter_stats_set_timing (s, "pool-wait", &stats.pool_wait);
+  gst_vspm_filter_stats_set_timing (s, "bounce", &stats.bounce);
+  gst_vspm_filter_stats_set_timing (s, "software", &stats.software);
+  gst_vspm_filter_stats_set_timing (s, "passes", &stats.passes);
+
+  return s;
+}
+
+/* Fold the hardware time of a finished job into the smoothed job time.
+ * Tell the pipeline when it moved by more than a quarter from what the
+ * last latency query reported */
+static void
+gst_vspm_filter_update_job_time (GstVspmFilter * space,
+    GstVspmFilterJob * job)
+{
+  GstClockTime sample;
+  gboolean changed;
+
+  if (job->result != 0 || job->done_time < job->submit_time)
+    return;
+  gst_vspm_filter_stats_add (space, &space->stats.job,
+      job->done_time - job->submit_time);
+  sample = (job->done_time - job->submit_time) * GST_USECOND;
+
+  GST_OBJECT_LOCK (space);
+  if (space->job_time == 0)
+    space->job_time = sample;
+  else
+    space->job_time = (7 * space->job_time + sample) / 8;
+  changed = space->reported_job_time != GST_CLOCK_TIME_NONE &&
+      (space->job_time > space->reported_job_time +
+       space->reported_job_time / 4 ||
+       space->job_time + space->job_time / 4 < space->reported_job_time);
+  if (changed)
+    space->reported_job_time = GST_CLOCK_TIME_NONE;
+  GST_OBJECT_UNLOCK (space);
+
+  GST_LOG_OBJECT (space, "job took %" GST_TIME_FORMAT ", average %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (sample),
+      GST_TIME_ARGS (space->job_time));
+
+  if (changed)
+    gst_element_post_message (GST_ELEMENT_CAST (space),
+        gst_message_new_latency (GST_OBJECT_CAST (space)));
+}
+
+/* Drop a frame which would reach the sink late anyway, before it costs a
+ * VSP job. Unlike the base class check, this one counts the time the
+ * job itself will take */
+static gboolean
+gst_vspm_filter_qos_drop (GstVspmFilter * space, GstBuffer * inbuf)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (space);
+  GstClockTime timestamp, running_time, earliest_time, job_time;
+  guint64 processed, dropped;
+  GstMessage *msg;
+
+  if (!gst_base_transform_is_qos_enabled (trans))
+    return FALSE;
+
+  timestamp = GST_BUFFER_TIMESTAMP (inbuf);
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp) ||
+      trans->segment.format != GST_FORMAT_TIME)
+    return FALSE;
+  running_time = gst_segment_to_running_time (&trans->segment,
+      GST_FORMAT_TIME, timestamp);
+
+  GST_OBJECT_LOCK (space);
+  earliest_time = space->earliest_time;
+  job_time = space->job_time;
+  if (GST_CLOCK_TIME_IS_VALID (running_time) &&
+      GST_CLOCK_TIME_IS_VALID (earliest_time) &&
+      running_time + job_time <= earliest_time) {
+    space->qos_dropped++;
+  } else {
+    space->qos_processed++;
+    GST_OBJECT_UNLOCK (space);
+    return FALSE;
+  }
+  processed = space->qos_processed;
+  dropped = space->qos_dropped;
+  GST_OBJECT_UNLOCK (space);
+
+  GST_DEBUG_OBJECT (space, "dropping frame at %"
+      GST_TIME_FORMAT ", job of %" GST_TIME_FORMAT " would end after %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (running_time), GST_TIME_ARGS (job_time),
+      GST_TIME_ARGS (earliest_time));
+
+  msg = gst_message_new_qos (GST_OBJECT_CAST (space), FALSE, running_time,
+      gst_segment_to_stream_time (&trans->segment, GST_FORMAT_TIME,
+          timestamp), timestamp, GST_BUFFER_DURATION (inbuf));
+  gst_message_set_qos_values (msg, running_time + job_time - earliest_time,
+      0.0, 1000000);
+  gst_message_set_qos_stats (msg, GST_FORMAT_BUFFERS, processed, dropped);
+  gst_element_post_message (GST_ELEMENT_CAST (space), msg);
+
+  return TRUE;
+}
+
+/* Wait for the oldest queued job and push its output buffer downstream,
+ * or drop it when push is FALSE */
+static GstFlowReturn
+gst_vspm_filter_finish_job (GstVspmFilter * space, gboolean push)
+{
+  GstVspmFilterJob *job;
+  GstBuffer *outbuf;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  job = g_queue_pop_head (space->pending_jobs);
+  if (job == NULL)
+    return GST_FLOW_OK;
+
+  sem_wait (&job->smp_wait);
+  gst_vspm_filter_update_job_time (space, job);
+
+  if (push && !gst_vspm_filter_job_failed (space, job)) {
+    gst_vspm_filter_bounce_finish (space, job, NULL);
+    outbuf = job->outbuf;
+    job->outbuf = NULL;
+    ret = gst_pad_push (GST_BASE_TRANSFORM_SRC_PAD (space), outbuf);
+  }
+  gst_vspm_filter_job_free (job);
+
+  return ret;
+}
+
+/* Push the jobs the hardware has already finished, without blocking */
+static GstFlowReturn
+gst_vspm_filter_push_done (GstVspmFilter * space)
+{
+  GstVspmFilterJob *job;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  while (ret == GST_FLOW_OK &&
+      (job = g_queue_peek_head (space->pending_jobs)) != NULL &&
+      g_atomic_int_get (&job->done))
+    ret = gst_vspm_filter_finish_job (space, TRUE);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_vspm_filter_drain (GstVspmFilter * space, gboolean push)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  GstFlowReturn res;
+
+  while (!g_queue_is_empty (space->pending_jobs)) {
+    /* Once pushing failed, the remaining buffers are only dropped */
+    res = gst_vspm_filter_finish_job (space, push && ret == GST_FLOW_OK);
+    if (ret == GST_FLOW_OK)
+      ret = res;
+  }
+
+  return ret;
 }
 
 static GstFlowReturn
-find_physical_address (GstVspmFilter *space, gpointer in_vir1, gpointer in_vir2,
+find_physical_address (int mmngr_fd, gpointer in_vir1, gpointer in_vir2,
     gpointer *out_phy1, gpointer *out_phy2)
 {
   struct MM_PARAM p_adr[2];
@@ -1101,7 +2213,7 @@ find_physical_address (GstVspmFilter *space, gpointer in_vir1, gpointer in_vir2,
   memset(&p_adr, 0, sizeof(p_adr));
   p_adr[0].user_virt_addr = (unsigned long)in_vir1;
   p_adr[1].user_virt_addr = (unsigned long)in_vir2;
-  ret = ioctl(space->vsp_info->mmngr_fd, MM_IOC_VTOP, &p_adr);
+  ret = mmngr_dev_ioctl (mmngr_fd, MM_IOC_VTOP, &p_adr);
   if (ret) {
     GST_ERROR ("MMNGR VtoP Convert Error. \n");
     return GST_FLOW_ERROR;
@@ -1120,350 +2232,1923 @@ find_physical_address (GstVspmFilter *space, gpointer in_vir1, gpointer in_vir2,
   return GST_FLOW_OK;
 }
 
-static void
-gst_vspm_filter_import_fd (GstMemory *mem, gpointer *out, GQueue *import_list)
+/* Returns the memory holding a plane of a mapped frame and the offset of
+ * the plane in that memory */
+static GstMemory *
+vtop_cache_plane_memory (GstVideoFrame * frame, gint plane, gsize * offset)
 {
-  int fd;
+  GstMapInfo *map;
 
-  if (gst_is_dmabuf_memory(mem)) {
-    int import_pid;
-    size_t size;
-
-    fd = gst_dmabuf_memory_get_fd (mem);
-    if (R_MM_OK == mmngr_import_start_in_user_ext (&import_pid,
-                                                   &size, (unsigned int *)out,
-                                                   fd, NULL)) {
-      g_queue_push_tail (import_list, GINT_TO_POINTER(import_pid));
+  /* Without video meta, the whole buffer is mapped in map[0] */
+  map = &frame->map[frame->meta ? plane : 0];
+  if (map->memory == NULL || frame->data[plane] == NULL)
+    return NULL;
+
+  *offset = (guint8 *) frame->data[plane] - map->data;
+  return map->memory;
+}
+
+/* Buffers of GstVspmFilterBufferPool (ours, or the one proposed upstream)
+ * carry their hardware address, no translation is needed */
+static gpointer
+vspm_buffer_lookup (GstVideoFrame * frame, gint plane)
+{
+  Vspm_dmabuff *vspm_buf;
+
+  /* memory replaced since the pool allocated the buffer */
+  if (GST_BUFFER_FLAG_IS_SET (frame->buffer, GST_BUFFER_FLAG_TAG_MEMORY))
+    return NULL;
+
+  vspm_buf = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (frame->buffer),
+      _vspm_buffer_quark);
+  if (vspm_buf == NULL)
+    return NULL;
+
+  return (gpointer) (vspm_buf->phard_addr +
+      GST_VIDEO_FRAME_PLANE_OFFSET (frame, plane));
+}
+
+static gpointer
+vtop_cache_lookup (GstVideoFrame * frame, gint plane)
+{
+  GstVspmFilterVtopCache *cache;
+  GstMemory *mem;
+  gpointer hard_addr = NULL;
+  gsize offset;
+  guint i;
+
+  hard_addr = vspm_buffer_lookup (frame, plane);
+  if (hard_addr)
+    return hard_addr;
+
+  mem = vtop_cache_plane_memory (frame, plane, &offset);
+  if (mem == NULL)
+    return NULL;
+
+  G_LOCK (vtop_cache);
+  cache = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem),
+      _vtop_cache_quark);
+  if (cache) {
+    for (i = 0; i < cache->n_entries; i++) {
+      if (cache->offset[i] == offset) {
+        hard_addr = cache->hard_addr[i];
+        break;
+      }
     }
   }
+  G_UNLOCK (vtop_cache);
+
+  return hard_addr;
 }
 
 static void
-gst_vspm_filter_release_fd (GQueue *import_list)
+vtop_cache_store (GstVideoFrame * frame, gint plane, gpointer hard_addr)
 {
-  int fd;
-  while (!g_queue_is_empty(import_list)) {
-    fd = GPOINTER_TO_INT(g_queue_pop_tail (import_list));
-    if (fd >= 0 )
-      mmngr_import_end_in_user_ext (fd);
+  GstVspmFilterVtopCache *cache;
+  GstMemory *mem;
+  gsize offset;
+
+  mem = vtop_cache_plane_memory (frame, plane, &offset);
+  if (mem == NULL || hard_addr == NULL)
+    return;
+
+  G_LOCK (vtop_cache);
+  cache = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem),
+      _vtop_cache_quark);
+  if (cache == NULL) {
+    cache = g_new0 (GstVspmFilterVtopCache, 1);
+    gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem), _vtop_cache_quark,
+        cache, g_free);
+  }
+  if (cache->n_entries < GST_VIDEO_MAX_PLANES) {
+    cache->offset[cache->n_entries] = offset;
+    cache->hard_addr[cache->n_entries] = hard_addr;
+    cache->n_entries++;
   }
+  G_UNLOCK (vtop_cache);
 }
 
+/* Same as find_physical_address for one plane of the input and output
+ * frames, but only asks mmngr for the addresses not translated before */
 static GstFlowReturn
-gst_vspm_filter_transform_frame (GstVideoFilter * filter,
-    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+find_physical_address_cached (GstVspmFilter *space, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint plane, gpointer *out_phy1,
+    gpointer *out_phy2)
 {
-  GstVspmFilter *space;
-  GstVspmFilterVspInfo *vsp_info;
-
-  VSPM_IP_PAR vspm_ip;
-  VSPM_VSP_PAR vsp_par;
+  gpointer phy1, phy2;
+  GstFlowReturn ret;
+  gint64 start;
+
+  phy1 = in_frame->data[plane] ? vtop_cache_lookup (in_frame, plane) : NULL;
+  phy2 = out_frame->data[plane] ? vtop_cache_lookup (out_frame, plane) : NULL;
+
+  if ((phy1 || !in_frame->data[plane]) && (phy2 || !out_frame->data[plane])) {
+    GST_OBJECT_LOCK (space);
+    space->stats.vtop_hits++;
+    GST_OBJECT_UNLOCK (space);
+    *out_phy1 = phy1;
+    *out_phy2 = phy2;
+    return GST_FLOW_OK;
+  }
 
-  T_VSP_IN src_par;
-  T_VSP_ALPHA src_alpha_par;
-  T_VSP_OUT dst_par;
-  T_VSP_CTRL ctrl_par;
-  T_VSP_UDS uds_par;
+  GST_OBJECT_LOCK (space);
+  space->stats.vtop_misses++;
+  GST_OBJECT_UNLOCK (space);
+  start = g_get_monotonic_time ();
+  ret = find_physical_address (space->vsp_info->mmngr_fd, in_frame->data[plane],
+      out_frame->data[plane], out_phy1, out_phy2);
+  gst_vspm_filter_stats_add (space, &space->stats.vtop,
+      g_get_monotonic_time () - start);
+  if (ret == GST_FLOW_OK) {
+    if (!phy1)
+      vtop_cache_store (in_frame, plane, *out_phy1);
+    if (!phy2)
+      vtop_cache_store (out_frame, plane, *out_phy2);
+  } else {
+    /* Keep what we already know, the caller imports the rest */
+    *out_phy1 = phy1;
+    *out_phy2 = phy2;
+  }
 
-  gint in_width, in_height;
-  gint out_width, out_height;
-  long ercd;
-  gint irc;
-  unsigned long use_module;
+  return ret;
+}
 
-  int i;
-  GstFlowReturn ret;
-  gint stride[GST_VIDEO_MAX_PLANES];
-  gsize offset[GST_VIDEO_MAX_PLANES];
-  gint offs, plane_size;
-  const GstVideoFormatInfo * vspm_in_vinfo;
-  const GstVideoFormatInfo * vspm_out_vinfo;
-  void *src_addr[3] = { 0 };
-  void *dst_addr[3] = { 0 };
-  guint in_n_planes, out_n_planes;
-  GstBuffer *buf;
+/* Hardware address of one plane of a mapped frame, found the same way as
+ * in transform_frame: pool buffer, VtoP cache, MM_IOC_VTOP and at last a
+ * dmabuf import. Returns NULL when the plane is not HW-addressable */
+gpointer
+gst_vspm_frame_plane_address (int mmngr_fd, GstVideoFrame * frame, gint plane)
+{
+  gpointer hard_addr;
   GstMemory *mem;
+  gsize offset;
 
-  space = GST_VIDEO_CONVERT_CAST (filter);
-  vsp_info = space->vsp_info;
+  if (frame->data[plane] == NULL)
+    return NULL;
 
-  GST_CAT_DEBUG_OBJECT (GST_CAT_PERFORMANCE, filter,
-      "doing colorspace conversion from %s -> to %s",
-      GST_VIDEO_INFO_NAME (&filter->in_info),
-      GST_VIDEO_INFO_NAME (&filter->out_info));
+  hard_addr = vtop_cache_lookup (frame, plane);
+  if (hard_addr)
+    return hard_addr;
 
-  vsp_info->gst_format_in = GST_VIDEO_FRAME_FORMAT (in_frame);
-  vsp_info->in_width = GST_VIDEO_FRAME_COMP_WIDTH (in_frame, 0);
-  vsp_info->in_height = GST_VIDEO_FRAME_COMP_HEIGHT (in_frame, 0);
+  if (find_physical_address (mmngr_fd, frame->data[plane], NULL,
+          &hard_addr, NULL) == GST_FLOW_OK && hard_addr) {
+    vtop_cache_store (frame, plane, hard_addr);
+    return hard_addr;
+  }
 
-  vsp_info->gst_format_out = GST_VIDEO_FRAME_FORMAT (out_frame);
-  vsp_info->out_width = GST_VIDEO_FRAME_COMP_WIDTH (out_frame, 0);
-  vsp_info->out_height = GST_VIDEO_FRAME_COMP_HEIGHT (out_frame, 0);
+  hard_addr = NULL;
+  mem = vtop_cache_plane_memory (frame, plane, &offset);
+  if (mem) {
+    gst_vspm_filter_import_fd (mem, &hard_addr);
+    if (hard_addr)
+      hard_addr = (guint8 *) hard_addr + mem->offset + offset;
+  }
 
-  memset(&ctrl_par, 0, sizeof(T_VSP_CTRL));
+  return hard_addr;
+}
 
-  if (vsp_info->format_flag == 0) {
-    irc = set_colorspace (GST_VIDEO_FRAME_FORMAT (in_frame), &vsp_info->in_format, &vsp_info->in_swapbit);
-    if (irc != 0) {
-      GST_ERROR("input format is non-support.\n");
-      ret = GST_FLOW_ERROR;
-      goto err;
+/* Default RPF settings, as transform_frame uses them, for the elements
+ * building their own jobs */
+void
+gst_vspm_init_in_par (T_VSP_IN * src_par, T_VSP_ALPHA * alpha_par,
+    void *addr[3], gint stride, gint stride_c, gint width, gint height,
+    guint format, guint swap)
+{
+  memset (alpha_par, 0, sizeof (T_VSP_ALPHA));
+  alpha_par->alphan      = VSP_ALPHA_NO;
+  alpha_par->aswap       = VSP_SWAP_NO;
+  alpha_par->asel        = VSP_ALPHA_NUM5;
+  alpha_par->aext        = VSP_AEXT_EXPAN;
+  alpha_par->afix        = 0xff;
+  alpha_par->irop        = VSP_IROP_NOP;
+  alpha_par->msken       = VSP_MSKEN_ALPHA;
+
+  memset (src_par, 0, sizeof (T_VSP_IN));
+  src_par->addr          = addr[0];
+  src_par->addr_c0       = addr[1];
+  src_par->addr_c1       = addr[2];
+  src_par->stride        = stride;
+  src_par->stride_c      = stride_c;
+  src_par->csc           = VSP_CSC_OFF;
+  src_par->width         = width;
+  src_par->height        = height;
+  src_par->format        = format;
+  src_par->swap          = swap;
+  src_par->pwd           = VSP_LAYER_PARENT;
+  src_par->cipm          = VSP_CIPM_0_HOLD;
+  src_par->cext          = VSP_CEXT_EXPAN;
+  src_par->iturbt        = VSP_ITURBT_709;
+  src_par->clrcng        = VSP_ITU_COLOR;
+  src_par->vir           = VSP_NO_VIR;
+  src_par->alpha_blend   = alpha_par;
+}
+
+void
+gst_vspm_init_out_par (T_VSP_OUT * dst_par, void *addr[3],
+    gint stride, gint stride_c, gint width, gint height, guint format,
+    guint swap)
+{
+  memset (dst_par, 0, sizeof (T_VSP_OUT));
+  dst_par->addr          = addr[0];
+  dst_par->addr_c0       = addr[1];
+  dst_par->addr_c1       = addr[2];
+  dst_par->stride        = stride;
+  dst_par->stride_c      = stride_c;
+  dst_par->csc           = VSP_CSC_OFF;
+  dst_par->width         = width;
+  dst_par->height        = height;
+  dst_par->format        = format;
+  dst_par->pxa           = VSP_PAD_P;
+  dst_par->pad           = 0xff;
+  dst_par->iturbt        = VSP_ITURBT_709;
+  dst_par->clrcng        = VSP_ITU_COLOR;
+  dst_par->cbrm          = VSP_CSC_ROUND_DOWN;
+  dst_par->abrm          = VSP_CONVERSION_ROUNDDOWN;
+  dst_par->clmd          = VSP_CLMD_NO;
+  dst_par->dith          = VSP_NO_DITHER;
+  dst_par->swap          = swap;
+}
+
+/* Whether a single job, without stripes, converts in_width x in_height to
+ * out_width x out_height: the sizes within what the VSP takes, and UDS
+ * ratios within the 16 bits of its registers */
+gboolean
+gst_vspm_uds_fits (gint in_width, gint in_height, gint out_width,
+    gint out_height)
+{
+  gint64 x_ratio, y_ratio;
+
+  if (in_width <= 0 || in_height <= 0 || out_width <= 0 || out_height <= 0 ||
+      MAX (in_width, out_width) > VSPM_MAX_SIZE ||
+      MAX (in_height, out_height) > VSPM_MAX_SIZE)
+    return FALSE;
+  if (in_width == out_width && in_height == out_height)
+    return TRUE;
+  if (MAX (in_width, out_width) > VSPM_UDS_MAX_WIDTH)
+    return FALSE;
+
+  x_ratio = ((gint64) in_width << 12) / out_width;
+  y_ratio = ((gint64) in_height << 12) / out_height;
+
+  return x_ratio >= VSPM_UDS_MIN_RATIO && x_ratio <= VSPM_UDS_MAX_RATIO &&
+      y_ratio >= VSPM_UDS_MIN_RATIO && y_ratio <= VSPM_UDS_MAX_RATIO;
+}
+
+gboolean
+gst_vspm_session_acquire (unsigned long * vspm_handle, int * mmngr_fd)
+{
+  gboolean ret = TRUE;
+
+  G_LOCK (vspm_session);
+  if (vspm_session.refcount == 0) {
+    /* mmngr dev open */
+    vspm_session.mmngr_fd = mmngr_dev_open (DEVFILE, O_RDWR);
+    if (vspm_session.mmngr_fd == -1) {
+      GST_ERROR ("MMNGR: open error. \n");
+      ret = FALSE;
+    } else if (VSPM_lib_DriverInitialize (&vspm_session.vspm_handle)
+        != R_VSPM_OK) {
+      GST_ERROR ("VSPM: Error Initialized. \n");
+      mmngr_dev_close (vspm_session.mmngr_fd);
+      vspm_session.mmngr_fd = -1;
+      ret = FALSE;
     }
+  }
+  if (ret) {
+    vspm_session.refcount++;
+    *vspm_handle = vspm_session.vspm_handle;
+    *mmngr_fd = vspm_session.mmngr_fd;
+  }
+  G_UNLOCK (vspm_session);
 
-    irc = set_colorspace_output (GST_VIDEO_FRAME_FORMAT (out_frame), &vsp_info->out_format, &vsp_info->out_swapbit);
-    if (irc != 0) {
-      GST_ERROR("output format is non-support.\n");
-      ret = GST_FLOW_ERROR;
-      goto err;
+  return ret;
+}
+
+void
+gst_vspm_session_release (void)
+{
+  G_LOCK (vspm_session);
+  if (--vspm_session.refcount == 0) {
+    VSPM_lib_DriverQuit (vspm_session.vspm_handle);
+    /* mmngr dev close */
+    mmngr_dev_close (vspm_session.mmngr_fd);
+    vspm_session.mmngr_fd = -1;
+  }
+  G_UNLOCK (vspm_session);
+}
+
+/* Queue a job on channel, or on the one with the fewest jobs in flight
+ * when channel is negative. With fallback, a channel the SoC does not have
+ * hands the job to whichever channel the driver picks */
+static long
+gst_vspm_entry_full (unsigned long handle, gint * channel, gboolean fallback,
+    unsigned long * jobid, VSPM_IP_PAR * vspm_ip, unsigned long user_data,
+    PFN_VSPM_COMPLETE_CALLBACK cb)
+{
+  gint i, best = *channel;
+  long ercd;
+
+  if (best < 0) {
+    best = 0;
+    for (i = 1; i < MAX_DEVICES; i++) {
+      if (g_atomic_int_get (&vspm_channel_depth[i]) <
+          g_atomic_int_get (&vspm_channel_depth[best]))
+        best = i;
     }
-    vsp_info->format_flag = 1;
   }
+  g_atomic_int_inc (&vspm_channel_depth[best]);
+  *channel = best;
+
+  vspm_ip->uhType = vspm_channel_type[best];
+  ercd = VSPM_lib_Entry (handle, jobid, 126, vspm_ip, user_data, cb);
+  if (ercd && fallback) {
+    /* not every SoC has all the channels, let the driver pick one */
+    GST_DEBUG ("VSP channel %d refused the job (%ld), using any", best, ercd);
+    vspm_ip->uhType = VSPM_TYPE_VSP_AUTO;
+    ercd = VSPM_lib_Entry (handle, jobid, 126, vspm_ip, user_data, cb);
+  }
+  if (ercd) {
+    gst_vspm_channel_release (best);
+    *channel = -1;
+  }
+
+  return ercd;
+}
+
+/* Queue a job on a VSP channel: the pinned one, or the one with the fewest
+ * jobs in flight when *channel is negative. *channel is set to the channel
+ * to hand back to gst_vspm_channel_release once the job is done, or to -1
+ * when the job could not be queued */
+long
+gst_vspm_entry (unsigned long handle, gint * channel, unsigned long * jobid,
+    VSPM_IP_PAR * vspm_ip, unsigned long user_data,
+    PFN_VSPM_COMPLETE_CALLBACK cb)
+{
+  return gst_vspm_entry_full (handle, channel, *channel < 0, jobid, vspm_ip,
+      user_data, cb);
+}
+
+void
+gst_vspm_channel_release (gint channel)
+{
+  g_atomic_int_add (&vspm_channel_depth[channel], -1);
+}
+
+static void
+gst_vspm_filter_import_free (gpointer data)
+{
+  GstVspmFilterImport *import = data;
+
+  /* Release the importing to avoid leak FD */
+  mmngr_import_end_in_user_ext (import->import_pid);
+  g_free (import);
+}
+
+static void
+gst_vspm_filter_import_fd (GstMemory *mem, gpointer *out)
+{
+  GstVspmFilterImport *import;
+  int fd;
+
+  if (gst_is_dmabuf_memory(mem)) {
+    G_LOCK (import_cache);
+    import = gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST (mem),
+        _import_quark);
+    if (import == NULL) {
+      int import_pid;
+      size_t size;
+      unsigned int hard_addr;
+
+      fd = gst_dmabuf_memory_get_fd (mem);
+      if (R_MM_OK == mmngr_import_start_in_user_ext (&import_pid,
+                                                     &size, &hard_addr,
+                                                     fd, NULL)) {
+        import = g_new0 (GstVspmFilterImport, 1);
+        import->import_pid = import_pid;
+        import->hard_addr = hard_addr;
+        gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem), _import_quark,
+            import, gst_vspm_filter_import_free);
+      }
+    }
+    if (import)
+      *out = GUINT_TO_POINTER (import->hard_addr);
+    G_UNLOCK (import_cache);
+  }
+}
+
+/* gst_vspm_filter_import_fd, accounted in the element statistics */
+static void
+gst_vspm_filter_import_fd_timed (GstVspmFilter * space, GstMemory * mem,
+    gpointer * out)
+{
+  gint64 start = g_get_monotonic_time ();
+
+  gst_vspm_filter_import_fd (mem, out);
+  gst_vspm_filter_stats_add (space, &space->stats.import,
+      g_get_monotonic_time () - start);
+}
+
+/* Rectangle of the input to convert: the crop meta of the buffer if any,
+ * further cropped by the crop-* properties. The VSP reads it through
+ * x_offset/y_offset, which have to stay on a chroma sample */
+static void
+gst_vspm_filter_get_crop (GstVspmFilter * space, GstVideoFrame * in_frame,
+    gint * x, gint * y, gint * width, gint * height)
+{
+  const GstVideoFormatInfo *finfo = in_frame->info.finfo;
+  gint frame_width = GST_VIDEO_FRAME_WIDTH (in_frame);
+  gint frame_height = GST_VIDEO_FRAME_HEIGHT (in_frame);
+  GstVideoCropMeta *crop_meta;
+  gint x_align, y_align;
+
+  crop_meta = gst_buffer_get_video_crop_meta (in_frame->buffer);
+  if (crop_meta) {
+    *x = crop_meta->x;
+    *y = crop_meta->y;
+    *width = crop_meta->width ? crop_meta->width : frame_width;
+    *height = crop_meta->height ? crop_meta->height : frame_height;
+  } else {
+    *x = 0;
+    *y = 0;
+    *width = frame_width;
+    *height = frame_height;
+  }
+
+  *x += space->crop_left;
+  *y += space->crop_top;
+  *width -= space->crop_left + space->crop_right;
+  *height -= space->crop_top + space->crop_bottom;
+
+  x_align = *x & ~((1 << finfo->w_sub[1]) - 1);
+  y_align = *y & ~((1 << finfo->h_sub[1]) - 1);
+  *width += *x - x_align;
+  *height += *y - y_align;
+  *x = x_align;
+  *y = y_align;
+
+  if (*x >= frame_width || *y >= frame_height || *width <= 0 || *height <= 0) {
+    GST_WARNING_OBJECT (space, "crop is outside of the %dx%d frame, ignored",
+        frame_width, frame_height);
+    *x = 0;
+    *y = 0;
+    *width = frame_width;
+    *height = frame_height;
+    return;
+  }
+
+  *width = MIN (*width, frame_width - *x);
+  *height = MIN (*height, frame_height - *y);
+}
+
+/* Area of the output receiving the picture when add-borders keeps the
+ * display aspect ratio of the (cropped) input */
+static void
+gst_vspm_filter_get_borders (GstVideoFrame * in_frame, gint in_width,
+    gint in_height, GstVideoFrame * out_frame, gint * x, gint * y,
+    gint * width, gint * height)
+{
+  const GstVideoFormatInfo *finfo = out_frame->info.finfo;
+  gint out_width = GST_VIDEO_FRAME_WIDTH (out_frame);
+  gint out_height = GST_VIDEO_FRAME_HEIGHT (out_frame);
+  guint64 num, den;
+
+  /* input display aspect ratio in output pixels */
+  num = (guint64) in_width * GST_VIDEO_INFO_PAR_N (&in_frame->info) *
+      GST_VIDEO_INFO_PAR_D (&out_frame->info);
+  den = (guint64) in_height * GST_VIDEO_INFO_PAR_D (&in_frame->info) *
+      GST_VIDEO_INFO_PAR_N (&out_frame->info);
+
+  *width = out_width;
+  *height = out_height;
+  if (num == 0 || den == 0)
+    return;
+
+  if (out_width * den > out_height * num)
+    *width = (gint) (out_height * num / den);   /* pillarbox */
+  else
+    *height = (gint) (out_width * den / num);   /* letterbox */
+
+  /* keep the picture on chroma samples */
+  *width &= ~((1 << finfo->w_sub[1]) - 1);
+  *height &= ~((1 << finfo->h_sub[1]) - 1);
+  *width = MAX (*width, 1 << finfo->w_sub[1]);
+  *height = MAX (*height, 1 << finfo->h_sub[1]);
+  *x = ((out_width - *width) / 2) & ~((1 << finfo->w_sub[1]) - 1);
+  *y = ((out_height - *height) / 2) & ~((1 << finfo->h_sub[1]) - 1);
+}
+
+/* The blending runs in the colour space of the input, convert the ARGB
+ * border-color to AYUV (BT.709, limited range) for YUV inputs */
+static guint
+gst_vspm_filter_border_color (guint argb, gboolean yuv)
+{
+  gint r = (argb >> 16) & 0xff;
+  gint g = (argb >> 8) & 0xff;
+  gint b = argb & 0xff;
+  gint cy, cb, cr;
+
+  if (!yuv)
+    return argb;
+
+  cy = ((47 * r + 157 * g + 16 * b + 128) >> 8) + 16;
+  cb = (-26 * r - 87 * g + 112 * b + 128 + (128 << 8)) >> 8;
+  cr = (112 * r - 102 * g - 10 * b + 128 + (128 << 8)) >> 8;
+
+  return (argb & 0xff000000) | (CLAMP (cy, 0, 255) << 16) |
+      (CLAMP (cb, 0, 255) << 8) | CLAMP (cr, 0, 255);
+}
+
+/* Number of stripes for a frame: the input and output lines of each have
+ * to fit one UDS pass when scaling, and the RPF/WPF otherwise. The slack
+ * leaves room for the overlap of the bilinear filter and the alignment */
+#define VSPM_STRIPE_SLACK 128
+
+static guint
+gst_vspm_filter_n_stripes (gint in_width, gint dst_width, gboolean scaling)
+{
+  gint limit = scaling ? VSPM_UDS_MAX_WIDTH : VSPM_MAX_SIZE;
+  gint widest = MAX (in_width, dst_width);
+
+  if (widest <= limit)
+    return 1;
+  return (widest + limit - VSPM_STRIPE_SLACK - 1) / (limit - VSPM_STRIPE_SLACK);
+}
+
+/* Source position of output column x in 4.12 fixed point, as the UDS
+ * samples it: the centre of the output pixel mapped onto the input */
+static inline gint64
+gst_vspm_filter_uds_pos (gint64 x, gint64 r)
+{
+  return x * r + r / 2 - 2048;
+}
+
+/* Split the dst_width output columns in n vertical stripes. When scaling,
+ * a stripe starts a few output columns early, dropped again by the WPF,
+ * so that the bilinear filter has the input columns left of the seam.
+ * That first column p is picked where the stripe, starting its input at
+ * in_x, samples the input at the very positions a single job would:
+ * pos(p) - pos(0) == in_x * 4096. Returns whether such a column was found
+ * for every stripe; otherwise the closest one is used and a seam may show */
+static gboolean
+gst_vspm_filter_split_stripes (GstVspmFilterJobTemplate * tmpl, guint n,
+    gint in_align, gint out_align, gint in_width, gint dst_width,
+    gboolean scaling, const GstVideoFormatInfo * out_finfo)
+{
+  gint64 r = scaling ? ((gint64) in_width << 12) / dst_width : 4096;
+  gint64 err, best_err, shift;
+  gboolean exact = TRUE;
+  gint margin, start, lowest, best, end, p;
+  guint i, k;
+
+  /* output columns covering two input columns */
+  margin = (gint) ((2 * 4096 + r - 1) / r) + 1;
+
+  for (k = 0; k < n; k++) {
+    GstVspmFilterStripe *s = &tmpl->stripes[k];
+
+    s->out_x = (gint) ((gint64) dst_width * k / n) & ~(out_align - 1);
+    s->out_width = ((k == n - 1) ? dst_width :
+        ((gint) ((gint64) dst_width * (k + 1) / n) & ~(out_align - 1))) -
+        s->out_x;
+
+    if (!scaling || n == 1) {
+      s->in_x = scaling ? 0 : s->out_x;
+      s->in_width = scaling ? in_width : s->out_width;
+      s->clip = 0;
+      s->uds_width = s->out_width;
+    } else {
+      /* right of the last source position, plus the bilinear neighbour */
+      end = (gint) (gst_vspm_filter_uds_pos (s->out_x + s->out_width - 1,
+              r) >> 12) + 2;
+      end = MIN (GST_ROUND_UP_N (end, in_align), in_width);
+
+      /* look left as far as the stripe still fits one UDS pass */
+      start = MAX (s->out_x - margin, 0);
+      lowest = MAX (0, s->out_x + s->out_width - VSPM_UDS_MAX_WIDTH);
+      lowest = MAX (lowest,
+          (gint) (((gint64) (end - VSPM_UDS_MAX_WIDTH) * 4096 + r - 1) / r));
+      best = start;
+      best_err = G_MAXINT64;
+      for (p = start; p >= lowest; p--) {
+        shift = gst_vspm_filter_uds_pos (p, r) - gst_vspm_filter_uds_pos (0, r);
+        err = shift % (4096 * in_align);
+        if (err < best_err) {
+          best = p;
+          best_err = err;
+          if (err == 0)
+            break;
+        }
+      }
+      if (best_err != 0)
+        exact = FALSE;
+
+      shift = gst_vspm_filter_uds_pos (best, r) - gst_vspm_filter_uds_pos (0, r);
+      s->in_x = (gint) (shift / (4096 * in_align)) * in_align;
+      s->in_width = end - s->in_x;
+      s->clip = s->out_x - best;
+      s->uds_width = s->out_x + s->out_width - best;
+    }
+
+    for (i = 0; i < 3; i++)
+      s->out_offset[i] = (i < GST_VIDEO_FORMAT_INFO_N_PLANES (out_finfo)) ?
+          (gsize) GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (out_finfo, i, s->out_x) *
+          GST_VIDEO_FORMAT_INFO_PSTRIDE (out_finfo, i) : 0;
+  }
+  tmpl->n_stripes = n;
+
+  return exact;
+}
+
+/* Plan the stripes of a frame, at least min_stripes of them. Extra stripes
+ * asked for by split-frame are given up when their seams would show */
+static void
+gst_vspm_filter_plan_stripes (GstVspmFilter * space,
+    GstVspmFilterJobTemplate * tmpl,
+    const GstVideoFormatInfo * in_finfo, const GstVideoFormatInfo * out_finfo,
+    gint in_width, gint dst_width, unsigned long use_module, guint min_stripes)
+{
+  gboolean scaling = (use_module & VSP_UDS_USE) != 0;
+  gint in_align = 1 << GST_VIDEO_FORMAT_INFO_W_SUB (in_finfo, 1);
+  gint out_align = 1 << GST_VIDEO_FORMAT_INFO_W_SUB (out_finfo, 1);
+  guint needed, n;
+
+  /* the picture is blended over the borders in one job */
+  needed = (use_module & VSP_BRU_USE) ? 1 :
+      gst_vspm_filter_n_stripes (in_width, dst_width, scaling);
+  needed = CLAMP (needed, 1, VSPM_MAX_STRIPES);
+  n = (use_module & VSP_BRU_USE) ? 1 : MAX (needed, min_stripes);
+  n = CLAMP (n, 1, VSPM_MAX_STRIPES);
+
+  /* without scaling, the input columns of a stripe are its output ones */
+  if (!scaling)
+    out_align = MAX (out_align, in_align);
+
+  tmpl->exact_seams = gst_vspm_filter_split_stripes (tmpl, n, in_align,
+      out_align, in_width, dst_width, scaling, out_finfo);
+  if (!tmpl->exact_seams && n > needed) {
+    GST_DEBUG_OBJECT (space, "no seam of %u stripes on an input column, "
+        "using %u", n, needed);
+    tmpl->exact_seams = gst_vspm_filter_split_stripes (tmpl, needed,
+        in_align, out_align, in_width, dst_width, scaling, out_finfo);
+  }
+  if (!tmpl->exact_seams)
+    GST_DEBUG_OBJECT (space, "%d -> %d columns: the seams of the %u stripes "
+        "are not sampled on input columns", in_width, dst_width,
+        tmpl->n_stripes);
+}
+
+/* Fill the job parameters of tmpl for converting the in_* area of in_frame
+ * to the dst_* area of out_frame. Frames matching them only patch the plane
+ * addresses in, see gst_vspm_filter_job_template_matches */
+static void
+gst_vspm_filter_build_job_template (GstVspmFilter * space,
+    GstVspmFilterJobTemplate * tmpl,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame,
+    gint in_x, gint in_y, gint in_width, gint in_height,
+    gint dst_x, gint dst_y, gint dst_width, gint dst_height)
+{
+  T_VSP_IN *src_par = &tmpl->src_par;
+  T_VSP_ALPHA *src_alpha_par = &tmpl->src_alpha_par;
+  T_VSP_OUT *dst_par = &tmpl->dst_par;
+  T_VSP_CTRL *ctrl_par = &tmpl->ctrl_par;
+  T_VSP_UDS *uds_par = &tmpl->uds_par;
+  T_VSP_BRU *bru_par = &tmpl->bru_par;
+  T_VSP_BLEND_VIRTUAL *virt_par = &tmpl->virt_par;
+  T_VSP_BLEND_CONTROL *blend_par = &tmpl->blend_par;
+  VSPM_VSP_PAR *vsp_par = &tmpl->vsp_par;
+
+  gint out_width, out_height;
+  guint in_format = 0, in_swapbit = 0, out_format = 0, out_swapbit = 0;
+  unsigned long use_module;
+  const GstVideoFormatInfo * vspm_in_vinfo;
+  const GstVideoFormatInfo * vspm_out_vinfo;
+
+  memset(ctrl_par, 0, sizeof(T_VSP_CTRL));
 
-  in_width = vsp_info->in_width;
-  in_height = vsp_info->in_height;
-  vspm_in_vinfo = gst_video_format_get_info (vsp_info->gst_format_in);
+  /* the formats of the frames, intermediate ones included */
+  vspm_in_vinfo = in_frame->info.finfo;
+  gst_vspm_set_colorspace (GST_VIDEO_FRAME_FORMAT (in_frame), &in_format,
+      &in_swapbit);
 
-  out_width = vsp_info->out_width;
-  out_height = vsp_info->out_height;
-  vspm_out_vinfo = gst_video_format_get_info (vsp_info->gst_format_out);
+  out_width = GST_VIDEO_FRAME_WIDTH (out_frame);
+  out_height = GST_VIDEO_FRAME_HEIGHT (out_frame);
+  vspm_out_vinfo = out_frame->info.finfo;
+  gst_vspm_set_colorspace_output (GST_VIDEO_FRAME_FORMAT (out_frame),
+      &out_format, &out_swapbit);
 
-  in_n_planes = GST_VIDEO_FORMAT_INFO_N_PLANES(vspm_in_vinfo);
-  out_n_planes = GST_VIDEO_FORMAT_INFO_N_PLANES(vspm_out_vinfo);
+  tmpl->in_n_planes = GST_VIDEO_FORMAT_INFO_N_PLANES(vspm_in_vinfo);
+  tmpl->out_n_planes = GST_VIDEO_FORMAT_INFO_N_PLANES(vspm_out_vinfo);
 
-  if ((in_width == out_width) && (in_height == out_height)) {
+  if ((in_width == dst_width) && (in_height == dst_height)) {
     use_module = 0;
   } else {
     /* UDS scaling */
     use_module = VSP_UDS_USE;
   }
+  if ((dst_width != out_width) || (dst_height != out_height)) {
+    /* BRU places the picture over a virtual layer of border-color */
+    use_module |= VSP_BRU_USE;
+  }
+
+  {
+    /* Setting input parameters */
+    src_alpha_par->addr_a   = NULL;
+    src_alpha_par->alphan   = VSP_ALPHA_NO;
+    src_alpha_par->alpha1   = 0;
+    src_alpha_par->alpha2   = 0;
+    src_alpha_par->astride  = 0;
+    src_alpha_par->aswap    = VSP_SWAP_NO;
+    src_alpha_par->asel     = VSP_ALPHA_NUM5;
+    src_alpha_par->aext     = VSP_AEXT_EXPAN;
+    src_alpha_par->anum0    = 0;
+    src_alpha_par->anum1    = 0;
+    src_alpha_par->afix     = 0xff;
+    src_alpha_par->irop     = VSP_IROP_NOP;
+    src_alpha_par->msken    = VSP_MSKEN_ALPHA;
+    src_alpha_par->bsel     = 0;
+    src_alpha_par->mgcolor  = 0;
+    src_alpha_par->mscolor0 = 0;
+    src_alpha_par->mscolor1 = 0;
+
+    src_par->stride         = in_frame->info.stride[0];
+    src_par->stride_c       = in_frame->info.stride[1];
+    src_par->csc            = VSP_CSC_OFF;  /* do not convert colorspace */
+    src_par->width          = in_width;
+    src_par->height         = in_height;
+    src_par->width_ex       = 0;
+    src_par->height_ex      = 0;
+    src_par->x_offset       = in_x;
+    src_par->y_offset       = in_y;
+    src_par->format         = in_format;
+    src_par->swap           = in_swapbit;
+    src_par->x_position     = dst_x;
+    src_par->y_position     = dst_y;
+    src_par->pwd            = (use_module & VSP_BRU_USE) ?
+        VSP_LAYER_CHILD : VSP_LAYER_PARENT;
+    src_par->cipm           = VSP_CIPM_0_HOLD;
+    src_par->cext           = VSP_CEXT_EXPAN;
+    src_par->iturbt         = VSP_ITURBT_709;
+    src_par->clrcng         = VSP_ITU_COLOR;
+    src_par->vir            = VSP_NO_VIR;
+    src_par->vircolor       = 0x00000000;
+    src_par->osd_lut        = NULL;
+    src_par->alpha_blend    = src_alpha_par;
+    src_par->clrcnv         = NULL;
+    src_par->connect        = (use_module & VSP_UDS_USE) ?
+        VSP_UDS_USE : use_module;
+  }
+
+  {
+    /* Setting output parameters */
+    dst_par->stride         = out_frame->info.stride[0];
+    dst_par->stride_c       = out_frame->info.stride[1];
+
+    /* convert if format in and out different in color space */
+    if (!GST_VIDEO_FORMAT_INFO_IS_YUV(vspm_in_vinfo) != !GST_VIDEO_FORMAT_INFO_IS_YUV(vspm_out_vinfo)) {
+      dst_par->csc          = VSP_CSC_ON;
+    } else {
+      dst_par->csc          = VSP_CSC_OFF;
+    }
+
+    dst_par->width          = out_width;
+    dst_par->height         = out_height;
+    dst_par->x_offset       = 0;
+    dst_par->y_offset       = 0;
+    dst_par->format         = out_format;
+    dst_par->pxa            = VSP_PAD_P;
+    dst_par->pad            = 0xff;
+    dst_par->x_coffset      = 0;
+    dst_par->y_coffset      = 0;
+    dst_par->iturbt         = VSP_ITURBT_709;
+    dst_par->clrcng         = VSP_ITU_COLOR;
+    dst_par->cbrm           = VSP_CSC_ROUND_DOWN;
+    dst_par->abrm           = VSP_CONVERSION_ROUNDDOWN;
+    dst_par->athres         = 0;
+    dst_par->clmd           = VSP_CLMD_NO;
+    dst_par->dith           = VSP_NO_DITHER;
+    dst_par->swap           = out_swapbit;
+  }
+
+  {
+    /* Setting resize parameters */
+    if (use_module & VSP_UDS_USE) {
+      /* Set T_VSP_UDS. */
+      ctrl_par->uds         = uds_par;
+
+      memset(uds_par, 0, sizeof(T_VSP_UDS));
+      uds_par->fmd          = VSP_FMD_NO;
+      uds_par->filcolor     = gst_vspm_filter_border_color (space->border_color,
+          GST_VIDEO_FORMAT_INFO_IS_YUV(vspm_in_vinfo));
+      uds_par->amd          = VSP_AMD;
+      uds_par->clip         = VSP_CLIP_OFF;
+      uds_par->alpha        = VSP_ALPHA_ON;
+      uds_par->complement   = VSP_COMPLEMENT_BIL;
+      uds_par->athres0      = 0;
+      uds_par->athres1      = 0;
+      uds_par->anum0        = 0;
+      uds_par->anum1        = 0;
+      uds_par->anum2        = 0;
+      uds_par->x_ratio      = (unsigned short)( (in_width << 12) / dst_width );
+      uds_par->y_ratio      = (unsigned short)( (in_height << 12) / dst_height );
+      uds_par->out_cwidth   = (unsigned short)dst_width;
+      uds_par->out_cheight  = (unsigned short)dst_height;
+      uds_par->connect      = use_module & VSP_BRU_USE;
+    }
+  }
+
+  {
+    /* Setting border parameters */
+    if (use_module & VSP_BRU_USE) {
+      ctrl_par->bru         = bru_par;
+
+      memset(virt_par, 0, sizeof(T_VSP_BLEND_VIRTUAL));
+      virt_par->width       = out_width;
+      virt_par->height      = out_height;
+      virt_par->pwd         = VSP_LAYER_PARENT;
+      virt_par->color       = gst_vspm_filter_border_color (space->border_color,
+          GST_VIDEO_FORMAT_INFO_IS_YUV(vspm_in_vinfo));
+
+      memset(blend_par, 0, sizeof(T_VSP_BLEND_CONTROL));
+      blend_par->rbc           = VSP_RBC_BLEND;
+      blend_par->crop          = VSP_IROP_NOP;
+      blend_par->arop          = VSP_IROP_NOP;
+      blend_par->blend_formula = VSP_FORM_BLEND0;
+      blend_par->blend_coefx   = VSP_COEFFICIENT_BLENDX4;
+      blend_par->blend_coefy   = VSP_COEFFICIENT_BLENDY5;
+      blend_par->aformula      = VSP_FORM_ALPHA0;
+      blend_par->acoefx        = VSP_COEFFICIENT_ALPHAX5;
+      blend_par->acoefy        = VSP_COEFFICIENT_ALPHAY5;
+
+      memset(bru_par, 0, sizeof(T_VSP_BRU));
+      bru_par->lay_order    = VSP_LAY_VIRTUAL | (VSP_LAY_1 << 4);
+      bru_par->adiv         = VSP_DIVISION_OFF;
+      bru_par->blend_virtual = virt_par;
+      bru_par->blend_unit_a = blend_par;
+      bru_par->connect      = 0;
+    }
+  }
+
+  {
+    /* Update all settings */
+    vsp_par->rpf_num        = 1;
+    vsp_par->use_module     = use_module;
+    vsp_par->src1_par       = src_par;
+    vsp_par->src2_par       = NULL;
+    vsp_par->src3_par       = NULL;
+    vsp_par->src4_par       = NULL;
+    vsp_par->dst_par        = dst_par;
+    vsp_par->ctrl_par       = ctrl_par;
+  }
+
+  /* split-frame: at least one stripe per channel, run side by side */
+  gst_vspm_filter_plan_stripes (space, tmpl, vspm_in_vinfo, vspm_out_vinfo,
+      in_width, dst_width, use_module,
+      (space->split_frame && space->vsp_channel < 0) ? MAX_DEVICES : 1);
+
+  tmpl->in_x = in_x;
+  tmpl->in_y = in_y;
+  tmpl->in_width = in_width;
+  tmpl->in_height = in_height;
+  tmpl->dst_x = dst_x;
+  tmpl->dst_y = dst_y;
+  tmpl->dst_width = dst_width;
+  tmpl->dst_height = dst_height;
+  tmpl->in_info = in_frame->info;
+  tmpl->out_info = out_frame->info;
+  tmpl->border_color = space->border_color;
+  tmpl->split_frame = space->split_frame && space->vsp_channel < 0;
+  tmpl->valid = TRUE;
+
+  GST_DEBUG_OBJECT (space, "job template: %dx%d+%d+%d -> %dx%d, modules 0x%lx"
+      ", %u stripes", in_width, in_height, in_x, in_y, dst_width, dst_height,
+      use_module, tmpl->n_stripes);
+}
+
+static gboolean
+gst_vspm_filter_job_template_matches (GstVspmFilter * space,
+    GstVspmFilterJobTemplate * tmpl,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame,
+    gint in_x, gint in_y, gint in_width, gint in_height,
+    gint dst_x, gint dst_y, gint dst_width, gint dst_height)
+{
+  return tmpl->valid &&
+      tmpl->in_x == in_x && tmpl->in_y == in_y &&
+      tmpl->in_width == in_width && tmpl->in_height == in_height &&
+      tmpl->dst_x == dst_x && tmpl->dst_y == dst_y &&
+      tmpl->dst_width == dst_width && tmpl->dst_height == dst_height &&
+      gst_video_info_is_equal (&tmpl->in_info, &in_frame->info) &&
+      gst_video_info_is_equal (&tmpl->out_info, &out_frame->info) &&
+      tmpl->border_color == space->border_color &&
+      tmpl->split_frame == (space->split_frame && space->vsp_channel < 0);
+}
+
+/* Whether one VSP job scales in_width x in_height to dst_width x dst_height
+ * in a frame of out_width x out_height: UDS ratios, number of stripes, and
+ * borders, which only a single stripe can add */
+static gboolean
+gst_vspm_filter_pass_fits (gint in_width, gint in_height, gint dst_width,
+    gint dst_height, gint out_width, gint out_height)
+{
+  gboolean scaling, borders;
+  gint64 x_ratio, y_ratio;
+  guint n;
+
+  x_ratio = ((gint64) in_width << 12) / dst_width;
+  y_ratio = ((gint64) in_height << 12) / dst_height;
+  if (x_ratio < VSPM_UDS_MIN_RATIO || x_ratio > VSPM_UDS_MAX_RATIO ||
+      y_ratio < VSPM_UDS_MIN_RATIO || y_ratio > VSPM_UDS_MAX_RATIO)
+    return FALSE;
+
+  scaling = in_width != dst_width || in_height != dst_height;
+  borders = dst_width != out_width || dst_height != out_height;
+  n = gst_vspm_filter_n_stripes (in_width, dst_width, scaling);
+
+  return n <= VSPM_MAX_STRIPES &&
+      !(borders && (n > 1 || out_width > VSPM_MAX_SIZE));
+}
+
+/* Largest r with r^n <= v */
+static guint64
+gst_vspm_filter_iroot (guint64 v, guint n)
+{
+  guint64 lo = 1, hi = G_MAXUINT16 + 1, mid, p;
+  guint i;
+
+  while (lo < hi) {
+    mid = (lo + hi + 1) / 2;
+    for (p = 1, i = 0; i < n; i++)
+      p *= mid;
+    if (p <= v)
+      lo = mid;
+    else
+      hi = mid - 1;
+  }
+
+  return lo;
+}
+
+/* Size after pass k of n going from size from to size to, the ratio being
+ * the same in every pass */
+static gint
+gst_vspm_filter_pass_size (gint from, gint to, guint k, guint n, gint align)
+{
+  guint64 v = 1;
+  guint i;
+
+  for (i = 0; i < n; i++)
+    v *= (i < k) ? (guint64) to : (guint64) from;
+
+  return GST_ROUND_UP_N ((gint) gst_vspm_filter_iroot (v, n), align);
+}
+
+static void
+gst_vspm_filter_pass_clear (GstVspmFilterPass * pass)
+{
+  if (pass->pool) {
+    gst_buffer_pool_set_active (pass->pool, FALSE);
+    gst_object_unref (pass->pool);
+    pass->pool = NULL;
+  }
+  pass->tmpl.valid = FALSE;
+}
+
+static void
+gst_vspm_filter_passes_clear (GstVspmFilter * space)
+{
+  guint i;
+
+  for (i = 0; i < VSPM_MAX_PASSES - 1; i++) {
+    gst_vspm_filter_pass_clear (&space->passes[i]);
+    gst_video_info_init (&space->passes[i].info);
+  }
+  space->n_passes = 1;
+}
+
+/* Plan the VSP jobs converting in_width x in_height to dst_width x
+ * dst_height in out_frame: formats of the exts tables, frame heights and
+ * strides within the limits of the hardware, and as few passes as the UDS
+ * ratios allow. Returns the number of passes, 0 when the VSP can not do
+ * the conversion */
+static guint
+gst_vspm_filter_plan_passes (GstVspmFilter * space,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame,
+    gint in_width, gint in_height, gint dst_width, gint dst_height)
+{
+  const GstVideoFormatInfo *finfo = in_frame->info.finfo;
+  gint out_width = GST_VIDEO_FRAME_WIDTH (out_frame);
+  gint out_height = GST_VIDEO_FRAME_HEIGHT (out_frame);
+  gint w_align = 1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, 1);
+  gint h_align = 1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, 1);
+  gint width[VSPM_MAX_PASSES + 1], height[VSPM_MAX_PASSES + 1];
+  GstVspmFilterPass *pass;
+  guint i, n;
+
+  if (!space->vsp_info->format_flag)
+    return 0;
+
+  /* wide frames are split in stripes, tall ones can not be */
+  if (GST_VIDEO_FRAME_HEIGHT (in_frame) > VSPM_MAX_SIZE ||
+      out_height > VSPM_MAX_SIZE ||
+      GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 0) > G_MAXUINT16 ||
+      GST_VIDEO_FRAME_PLANE_STRIDE (out_frame, 0) > G_MAXUINT16)
+    return 0;
+
+  /* the passes before the last one only scale, in the input format */
+  for (n = 1; n <= VSPM_MAX_PASSES; n++) {
+    width[0] = in_width;
+    height[0] = in_height;
+    for (i = 1; i < n; i++) {
+      width[i] = gst_vspm_filter_pass_size (in_width, dst_width, i, n,
+          w_align);
+      height[i] = gst_vspm_filter_pass_size (in_height, dst_height, i, n,
+          h_align);
+    }
+    width[n] = dst_width;
+    height[n] = dst_height;
+
+    for (i = 0; i < n; i++)
+      if (!gst_vspm_filter_pass_fits (width[i], height[i], width[i + 1],
+              height[i + 1], (i == n - 1) ? out_width : width[i + 1],
+              (i == n - 1) ? out_height : height[i + 1]))
+        break;
+    if (i == n)
+      break;
+  }
+  if (n > VSPM_MAX_PASSES)
+    return 0;
+
+  for (i = 0; i + 1 < n; i++) {
+    pass = &space->passes[i];
+    if (GST_VIDEO_INFO_FORMAT (&pass->info) == GST_VIDEO_FRAME_FORMAT (in_frame)
+        && GST_VIDEO_INFO_WIDTH (&pass->info) == width[i + 1] &&
+        GST_VIDEO_INFO_HEIGHT (&pass->info) == height[i + 1])
+      continue;
+
+    gst_vspm_filter_pass_clear (pass);
+    gst_video_info_set_format (&pass->info, GST_VIDEO_FRAME_FORMAT (in_frame),
+        width[i + 1], height[i + 1]);
+
+    GST_DEBUG_OBJECT (space, "pass %u of %u: %dx%d -> %dx%d", i + 1, n,
+        width[i], height[i], width[i + 1], height[i + 1]);
+  }
+  space->n_passes = n;
+
+  return n;
+}
+
+#ifdef HAVE_VSPM_SOFTWARE
+/* Convert a frame the VSP can not on the CPU, see gstvspmsoftware.c.
+ * Frames of the zero-copy path (mapped FALSE) are mapped here */
+static GstFlowReturn
+gst_vspm_filter_software_transform (GstVspmFilter * space,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame, gboolean mapped,
+    gint in_x, gint in_y, gint in_width, gint in_height,
+    gint dst_x, gint dst_y, gint dst_width, gint dst_height)
+{
+  GstVideoFrame in_map, out_map;
+  GstFlowReturn ret;
+  gint64 start;
+
+  /* The base class pushes this buffer, queued ones must go out first */
+  ret = gst_vspm_filter_drain (space, TRUE);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  if (space->software == NULL)
+    space->software = gst_vspm_software_new ();
+
+  if (!mapped) {
+    if (!gst_video_frame_map (&in_map, &in_frame->info, in_frame->buffer,
+            GST_MAP_READ))
+      goto map_failed;
+    if (!gst_video_frame_map (&out_map, &out_frame->info, out_frame->buffer,
+            GST_MAP_WRITE)) {
+      gst_video_frame_unmap (&in_map);
+      goto map_failed;
+    }
+    in_frame = &in_map;
+    out_frame = &out_map;
+  }
+
+  start = g_get_monotonic_time ();
+  ret = GST_FLOW_OK;
+  if (!gst_vspm_software_convert (space->software, in_frame, out_frame,
+          in_x, in_y, in_width, in_height, dst_x, dst_y, dst_width,
+          dst_height, space->border_color)) {
+    GST_ELEMENT_ERROR (space, CORE, NOT_IMPLEMENTED, (NULL),
+        ("neither the VSP nor the CPU can convert %s to %s",
+            GST_VIDEO_INFO_NAME (&in_frame->info),
+            GST_VIDEO_INFO_NAME (&out_frame->info)));
+    ret = GST_FLOW_NOT_NEGOTIATED;
+  } else {
+    gst_vspm_filter_stats_add (space, &space->stats.software,
+        g_get_monotonic_time () - start);
+  }
+
+  if (!mapped) {
+    gst_video_frame_unmap (&in_map);
+    gst_video_frame_unmap (&out_map);
+  }
+
+  return ret;
+
+map_failed:
+  GST_ELEMENT_ERROR (space, RESOURCE, READ, (NULL),
+      ("could not map the frames for the software path"));
+  return GST_FLOW_ERROR;
+}
+#endif
+
+/* Copy the picture of a frame to a frame of the same format. A plane is
+ * one memcpy when both strides agree, which the C library runs with the
+ * widest vector loads of the CPU, and one memcpy per row otherwise */
+static void
+gst_vspm_filter_copy_frame (GstVideoFrame * dest, GstVideoFrame * src)
+{
+  guint i;
+  gint h, rows;
+  gint src_stride, dest_stride;
+  gsize row_size;
+  guint8 *s, *d;
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (src); i++) {
+    s = GST_VIDEO_FRAME_PLANE_DATA (src, i);
+    d = GST_VIDEO_FRAME_PLANE_DATA (dest, i);
+    src_stride = GST_VIDEO_FRAME_PLANE_STRIDE (src, i);
+    dest_stride = GST_VIDEO_FRAME_PLANE_STRIDE (dest, i);
+    row_size = GST_VIDEO_FRAME_COMP_WIDTH (src, i) *
+        GST_VIDEO_FRAME_COMP_PSTRIDE (src, i);
+    rows = GST_VIDEO_FRAME_COMP_HEIGHT (src, i);
+    if (rows <= 0)
+      continue;
+
+    if (src_stride == dest_stride) {
+      memcpy (d, s, (gsize) src_stride * (rows - 1) + row_size);
+    } else {
+      for (h = 0; h < rows; h++)
+        memcpy (d + h * dest_stride, s + h * src_stride, row_size);
+    }
+  }
+}
+
+/* Buffer of one of the bounce or intermediate pass pools, set up for
+ * frames of info the first time it is needed */
+static GstBuffer *
+gst_vspm_filter_bounce_acquire (GstVspmFilter * space, GstBufferPool ** pool,
+    GstVideoInfo * info)
+{
+  GstStructure *config;
+  GstCaps *caps;
+  GstBuffer *buf = NULL;
+
+  if (*pool == NULL) {
+    *pool = gst_vspmfilter_buffer_pool_new (GST_ELEMENT (space), FALSE);
+    caps = gst_video_info_to_caps (info);
+    config = gst_buffer_pool_get_config (*pool);
+    gst_buffer_pool_config_set_params (config, caps, info->size, 0, 0);
+    gst_caps_unref (caps);
+    if (!gst_buffer_pool_set_config (*pool, config)) {
+      GST_WARNING_OBJECT (space, "failed to configure the bounce pool");
+      gst_object_unref (*pool);
+      *pool = NULL;
+      return NULL;
+    }
+  }
+
+  if (!gst_buffer_pool_is_active (*pool) &&
+      !gst_buffer_pool_set_active (*pool, TRUE)) {
+    GST_WARNING_OBJECT (space, "failed to activate the bounce pool");
+    return NULL;
+  }
+
+  if (gst_buffer_pool_acquire_buffer (*pool, &buf, NULL) != GST_FLOW_OK)
+    return NULL;
+
+  return buf;
+}
+
+static void
+gst_vspm_filter_bounce_clear (GstVspmFilter * space)
+{
+  if (space->bounce_in_pool) {
+    gst_buffer_pool_set_active (space->bounce_in_pool, FALSE);
+    gst_object_unref (space->bounce_in_pool);
+    space->bounce_in_pool = NULL;
+  }
+  if (space->bounce_out_pool) {
+    gst_buffer_pool_set_active (space->bounce_out_pool, FALSE);
+    gst_object_unref (space->bounce_out_pool);
+    space->bounce_out_pool = NULL;
+  }
+}
+
+/* Copy an input frame the VSP can not address to a bounce buffer, which
+ * replaces the input buffer in the job. bounce is left mapped and addr
+ * holds its plane addresses */
+static gboolean
+gst_vspm_filter_bounce_in (GstVspmFilter * space, GstVspmFilterJob * job,
+    GstVideoFrame * in_frame, GstVideoFrame * bounce, gpointer addr[3])
+{
+  gint64 start = g_get_monotonic_time ();
+  GstBuffer *buf;
+  guint i;
+
+  buf = gst_vspm_filter_bounce_acquire (space, &space->bounce_in_pool,
+      &in_frame->info);
+  if (buf == NULL)
+    return FALSE;
+  if (!gst_video_frame_map (bounce, &in_frame->info, buf, GST_MAP_READWRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+
+  gst_vspm_filter_copy_frame (bounce, in_frame);
+  for (i = 0; i < 3; i++)
+    addr[i] = (i < GST_VIDEO_FRAME_N_PLANES (bounce)) ?
+        vspm_buffer_lookup (bounce, i) : NULL;
+
+  gst_buffer_replace (&job->inbuf, buf);
+  gst_buffer_unref (buf);
+
+  gst_vspm_filter_stats_add (space, &space->stats.bounce,
+      g_get_monotonic_time () - start);
+  GST_LOG_OBJECT (space, "input staged in bounce buffer %p", buf);
+
+  return TRUE;
+}
+
+/* Let the VSP write to a bounce buffer instead of an output frame it can
+ * not address, see gst_vspm_filter_bounce_finish */
+static gboolean
+gst_vspm_filter_bounce_out (GstVspmFilter * space, GstVspmFilterJob * job,
+    GstVideoFrame * out_frame, GstVideoFrame * bounce, gpointer addr[3])
+{
+  GstBuffer *buf;
+  guint i;
+
+  buf = gst_vspm_filter_bounce_acquire (space, &space->bounce_out_pool,
+      &out_frame->info);
+  if (buf == NULL)
+    return FALSE;
+  if (!gst_video_frame_map (bounce, &out_frame->info, buf, GST_MAP_READ)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+
+  for (i = 0; i < 3; i++)
+    addr[i] = (i < GST_VIDEO_FRAME_N_PLANES (bounce)) ?
+        vspm_buffer_lookup (bounce, i) : NULL;
+  job->bounce_out = buf;
+
+  return TRUE;
+}
+
+/* Copy what the VSP wrote to the bounce buffer of a finished job to its
+ * output buffer. out_frame is the output when the caller has it mapped */
+static void
+gst_vspm_filter_bounce_finish (GstVspmFilter * space, GstVspmFilterJob * job,
+    GstVideoFrame * out_frame)
+{
+  GstVideoInfo *info = &GST_VIDEO_FILTER_CAST (space)->out_info;
+  GstVideoFrame bounce, out;
+  gint64 start;
+
+  if (job->bounce_out == NULL)
+    return;
+
+  start = g_get_monotonic_time ();
+  if (gst_video_frame_map (&bounce, info, job->bounce_out, GST_MAP_READ)) {
+    if (out_frame) {
+      gst_vspm_filter_copy_frame (out_frame, &bounce);
+    } else if (gst_video_frame_map (&out, info, job->outbuf, GST_MAP_WRITE)) {
+      gst_vspm_filter_copy_frame (&out, &bounce);
+      gst_video_frame_unmap (&out);
+    } else {
+      GST_WARNING_OBJECT (space, "could not map the output buffer");
+    }
+    gst_video_frame_unmap (&bounce);
+  }
+  gst_vspm_filter_stats_add (space, &space->stats.bounce,
+      g_get_monotonic_time () - start);
+
+  gst_buffer_unref (job->bounce_out);
+  job->bounce_out = NULL;
+}
+
+/* Parameters of one stripe, patched from the job template */
+typedef struct {
+  T_VSP_IN src_par;
+  T_VSP_OUT dst_par;
+  T_VSP_UDS uds_par;
+  T_VSP_CTRL ctrl_par;
+  VSPM_VSP_PAR vsp_par;
+} GstVspmFilterStripePar;
+
+static void
+gst_vspm_filter_stripe_par (GstVspmFilterJobTemplate * tmpl, guint k,
+    GstVspmFilterStripePar * par)
+{
+  GstVspmFilterStripe *s = &tmpl->stripes[k];
+
+  par->src_par = tmpl->src_par;
+  par->src_par.x_offset = tmpl->in_x + s->in_x;
+  par->src_par.width = s->in_width;
+
+  par->dst_par = tmpl->dst_par;
+  par->dst_par.addr = (guint8 *) tmpl->dst_par.addr + s->out_offset[0];
+  if (tmpl->dst_par.addr_c0)
+    par->dst_par.addr_c0 = (guint8 *) tmpl->dst_par.addr_c0 +
+        s->out_offset[1];
+  if (tmpl->dst_par.addr_c1)
+    par->dst_par.addr_c1 = (guint8 *) tmpl->dst_par.addr_c1 +
+        s->out_offset[2];
+  par->dst_par.width = s->out_width;
+  par->dst_par.x_offset = s->clip;
+
+  par->ctrl_par = tmpl->ctrl_par;
+  if (tmpl->ctrl_par.uds) {
+    par->uds_par = tmpl->uds_par;
+    par->uds_par.out_cwidth = s->uds_width;
+    par->ctrl_par.uds = &par->uds_par;
+  }
+
+  par->vsp_par = tmpl->vsp_par;
+  par->vsp_par.src1_par = &par->src_par;
+  par->vsp_par.dst_par = &par->dst_par;
+  par->vsp_par.ctrl_par = &par->ctrl_par;
+}
+
+/* Queue a frame to the hardware, one VSPM job per stripe, back to back.
+ * In split-frame mode stripe k goes to channel k % MAX_DEVICES so that the
+ * units work on the frame side by side; otherwise, unless vsp-channel pins
+ * them, each stripe goes to the least busy channel */
+static long
+gst_vspm_filter_submit (GstVspmFilter * space, GstVspmFilterJobTemplate * tmpl,
+    GstVspmFilterJob * job)
+{
+  GstVspmFilterStripePar par;
+  VSPM_IP_PAR vspm_ip;
+  gboolean spread;
+  guint k;
+  long ercd = 0;
+
+  spread = tmpl->split_frame;
+  job->n_stripes = tmpl->n_stripes;
+  job->remaining = job->n_stripes + 1;
+  job->submit_time = g_get_monotonic_time ();
+
+  for (k = 0; k < job->n_stripes; k++) {
+    GstVspmFilterJobStripe *stripe = &job->stripes[k];
+
+    memset (&vspm_ip, 0, sizeof (VSPM_IP_PAR));
+    if (job->n_stripes > 1) {
+      gst_vspm_filter_stripe_par (tmpl, k, &par);
+      vspm_ip.unionIpParam.ptVsp = &par.vsp_par;
+    } else {
+      vspm_ip.unionIpParam.ptVsp = &tmpl->vsp_par;
+    }
+
+    stripe->job = job;
+    stripe->channel = spread ? (gint) (k % MAX_DEVICES) : space->vsp_channel;
+    ercd = gst_vspm_entry_full (space->vsp_info->vspm_handle,
+        &stripe->channel, space->vsp_channel < 0, &stripe->jobid, &vspm_ip,
+        (unsigned long) stripe, cb_func);
+    if (ercd)
+      break;
+  }
+
+  /* the stripes not queued, and the hold of the queueing itself */
+  gst_vspm_filter_job_stripes_done (job, job->n_stripes - k + 1);
+
+  return ercd;
+}
+
+/* Run the passes of a frame before the last one, each a VSP job of its own
+ * waited for, as the next one reads what it wrote. On success src is the
+ * last intermediate frame, mapped in frames, whose buffer replaced the
+ * input of job; addr and the in_* area point to its picture */
+static gboolean
+gst_vspm_filter_run_passes (GstVspmFilter * space, GstVspmFilterJob * job,
+    GstVideoFrame * in_frame, GstVideoFrame ** src, GstVideoFrame frames[2],
+    gpointer addr[3], gint * in_x, gint * in_y, gint * in_width,
+    gint * in_height)
+{
+  gint64 start = g_get_monotonic_time ();
+  GstVideoFrame *from = *src, *to;
+  GstVspmFilterPass *pass;
+  GstVspmFilterJob *pass_job;
+  GstBuffer *buf;
+  gpointer dst_addr[3];
+  guint i, k;
+  long ercd;
+
+  for (k = 0; k + 1 < space->n_passes; k++) {
+    pass = &space->passes[k];
+    to = &frames[k % 2];
+
+    buf = gst_vspm_filter_bounce_acquire (space, &pass->pool, &pass->info);
+    if (buf == NULL)
+      goto failed;
+    if (!gst_video_frame_map (to, &pass->info, buf, GST_MAP_READ)) {
+      gst_buffer_unref (buf);
+      goto failed;
+    }
+    for (i = 0; i < 3; i++)
+      dst_addr[i] = (i < GST_VIDEO_FRAME_N_PLANES (to)) ?
+          vspm_buffer_lookup (to, i) : NULL;
+
+    if (!gst_vspm_filter_job_template_matches (space, &pass->tmpl, from, to,
+            *in_x, *in_y, *in_width, *in_height, 0, 0,
+            GST_VIDEO_INFO_WIDTH (&pass->info),
+            GST_VIDEO_INFO_HEIGHT (&pass->info)))
+      gst_vspm_filter_build_job_template (space, &pass->tmpl, from, to,
+          *in_x, *in_y, *in_width, *in_height, 0, 0,
+          GST_VIDEO_INFO_WIDTH (&pass->info),
+          GST_VIDEO_INFO_HEIGHT (&pass->info));
+
+    pass->tmpl.src_par.addr     = addr[0];
+    pass->tmpl.src_par.addr_c0  = addr[1];
+    pass->tmpl.src_par.addr_c1  = addr[2];
+    pass->tmpl.dst_par.addr     = dst_addr[0];
+    pass->tmpl.dst_par.addr_c0  = dst_addr[1];
+    pass->tmpl.dst_par.addr_c1  = dst_addr[2];
+
+    pass_job = gst_vspm_filter_job_new (from->buffer, buf);
+    gst_buffer_unref (buf);
+    ercd = gst_vspm_filter_submit (space, &pass->tmpl, pass_job);
+    sem_wait (&pass_job->smp_wait);
+    if (!ercd)
+      ercd = pass_job->result;
+    gst_vspm_filter_job_free (pass_job);
+    if (ercd) {
+      GST_ERROR_OBJECT (space, "VSPM job failed for pass %u, "
+          "ercd=%ld", k + 1, ercd);
+      gst_video_frame_unmap (to);
+      goto failed;
+    }
+
+    if (from != in_frame)
+      gst_video_frame_unmap (from);
+    from = to;
+    for (i = 0; i < 3; i++)
+      addr[i] = dst_addr[i];
+    *in_x = *in_y = 0;
+    *in_width = GST_VIDEO_INFO_WIDTH (&pass->info);
+    *in_height = GST_VIDEO_INFO_HEIGHT (&pass->info);
+  }
+
+  gst_buffer_replace (&job->inbuf, from->buffer);
+  *src = from;
+
+  gst_vspm_filter_stats_add (space, &space->stats.passes,
+      g_get_monotonic_time () - start);
+
+  return TRUE;
+
+failed:
+  GST_WARNING_OBJECT (space, "intermediate pass %u failed", k + 1);
+  if (from != in_frame)
+    gst_video_frame_unmap (from);
+  *src = in_frame;
+  return FALSE;
+}
 
-  ret = find_physical_address (space, in_frame->data[0], out_frame->data[0],
+/* Hardware addresses of the planes of mapped frames: VtoP translation of
+ * their virtual addresses, else import of their dmabuf memories */
+static void
+gst_vspm_filter_find_addresses (GstVspmFilter * space,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame,
+    gpointer src_addr[3], gpointer dst_addr[3])
+{
+  guint in_n_planes = GST_VIDEO_FRAME_N_PLANES (in_frame);
+  guint out_n_planes = GST_VIDEO_FRAME_N_PLANES (out_frame);
+  GstFlowReturn ret;
+  GstBuffer *buf;
+  GstMemory *mem;
+
+  ret = find_physical_address_cached (space, in_frame, out_frame, 0,
       &src_addr[0], &dst_addr[0]);
   if (!src_addr[0] || ret) {
     buf = in_frame->buffer;
     mem = gst_buffer_peek_memory (buf, 0);
-    gst_vspm_filter_import_fd (mem, &src_addr[0], space->mmngr_import_list);
+    gst_vspm_filter_import_fd_timed (space, mem, &src_addr[0]);
   }
   if (!dst_addr[0] || ret) {
     buf = out_frame->buffer;
     mem = gst_buffer_peek_memory (buf, 0);
-    gst_vspm_filter_import_fd (mem, &dst_addr[0], space->mmngr_import_list);
+    gst_vspm_filter_import_fd_timed (space, mem, &dst_addr[0]);
   }
 
+  /* Without a separate GstMemory per plane, the address of the plane can
+   * not be found from a dmabuf, the frame goes through a bounce buffer */
   if (in_n_planes >= 2 || out_n_planes >= 2) {
-    ret = find_physical_address (space, in_frame->data[1], out_frame->data[1],
+    ret = find_physical_address_cached (space, in_frame, out_frame, 1,
         &src_addr[1], &dst_addr[1]);
     if (!src_addr[1] || ret) {
       buf = in_frame->buffer;
       if (gst_buffer_n_memory(buf) > 1) {
-        /* Make sure we have separate GstMemory for each planar */
         mem = gst_buffer_peek_memory (buf, 1);
-        gst_vspm_filter_import_fd (mem, &src_addr[1], space->mmngr_import_list);
-      } else {
-        /* We can not find the exactly address for plane 2, return as error */
-        GST_ERROR("Can not find physical address of input buffer for planar 2\n");
-        ret = GST_FLOW_ERROR;
-        goto err;
+        gst_vspm_filter_import_fd_timed (space, mem, &src_addr[1]);
       }
     }
     if (!dst_addr[1] || ret) {
       buf = out_frame->buffer;
       if (gst_buffer_n_memory(buf) > 1) {
-        /* Make sure we have separate GstMemory for each planar */
         mem = gst_buffer_peek_memory (buf, 1);
-        gst_vspm_filter_import_fd (mem, &dst_addr[1], space->mmngr_import_list);
-      } else {
-        GST_ERROR("Can not find physical address of output buffer for planar 2\n");
-        /* We can not find the exactly address for plane 2, return as error */
-        ret = GST_FLOW_ERROR;
-        goto err;
+        gst_vspm_filter_import_fd_timed (space, mem, &dst_addr[1]);
       }
     }
   }
 
   if (in_n_planes >= 3 || out_n_planes >= 3) {
-    ret = find_physical_address (space, in_frame->data[2], out_frame->data[2],
+    ret = find_physical_address_cached (space, in_frame, out_frame, 2,
         &src_addr[2], &dst_addr[2]);
     if (!src_addr[2] || ret) {
       buf = in_frame->buffer;
       if (gst_buffer_n_memory(buf) > 2) {
-        /* Make sure we have separate GstMemory for each planar */
         mem = gst_buffer_peek_memory (buf, 2);
-        gst_vspm_filter_import_fd (mem, &src_addr[2], space->mmngr_import_list);
-      } else {
-        /* We can not find the exactly address for plane 3, return as error */
-        GST_ERROR("Can not find physical address of input buffer for planar 3\n");
-        ret = GST_FLOW_ERROR;
-        goto err;
+        gst_vspm_filter_import_fd_timed (space, mem, &src_addr[2]);
       }
     }
     if (!dst_addr[2] || ret) {
       buf = out_frame->buffer;
       if (gst_buffer_n_memory(buf) > 2) {
-        /* Make sure we have separate GstMemory for each planar */
         mem = gst_buffer_peek_memory (buf, 2);
-        gst_vspm_filter_import_fd (mem, &dst_addr[2], space->mmngr_import_list);
-      } else {
-        GST_ERROR("Can not find physical address of output buffer for planar 3\n");
-        /* We can not find the exactly address for plane 3, return as error */
-        ret = GST_FLOW_ERROR;
-        goto err;
+        gst_vspm_filter_import_fd_timed (space, mem, &dst_addr[2]);
       }
     }
-
   }
+}
 
-  if (!src_addr[0] || !dst_addr[0] ||
-      ((in_n_planes >= 2 && !src_addr[1]) || (out_n_planes >= 2 && !dst_addr[1])) ||
-      ((in_n_planes >= 3 && !src_addr[2]) || (out_n_planes >= 3 && !dst_addr[2]))) {
-    /* W/A: Sometimes we can not convert virtual address to physical address,
-     * we should skip this frame to avoid issue with HW processor.
-     */
-    ret = GST_FLOW_OK;
-    goto err;
+/* Hardware address of a plane of an unmapped frame: memory of the pools
+ * of the plugin, or a dmabuf imported to mmngr, at the offset of the
+ * plane in the buffer. NULL when the memory is neither */
+static gpointer
+gst_vspm_filter_plane_address_unmapped (GstVspmFilter * space,
+    GstVideoFrame * frame, gint plane)
+{
+  gsize offset = GST_VIDEO_FRAME_PLANE_OFFSET (frame, plane);
+  gpointer addr;
+  GstMemory *mem;
+  guint idx, len;
+  gsize skip;
+
+  addr = vspm_buffer_lookup (frame, plane);
+  if (addr)
+    return addr;
+
+  if (!gst_buffer_find_memory (frame->buffer, offset, 1, &idx, &len, &skip))
+    return NULL;
+  mem = gst_buffer_peek_memory (frame->buffer, idx);
+  if (!gst_is_dmabuf_memory (mem))
+    return NULL;
+
+  gst_vspm_filter_import_fd_timed (space, mem, &addr);
+  if (addr == NULL)
+    return NULL;
+
+  /* the import is of the whole dmabuf */
+  return (guint8 *) addr + mem->offset + skip;
+}
+
+/* Describe buffer as a frame of info without mapping it, the plane layout
+ * coming from its GstVideoMeta when it has one, and find the hardware
+ * addresses of its planes. data[] of the frame stays NULL */
+static gboolean
+gst_vspm_filter_frame_layout (GstVspmFilter * space, GstVideoInfo * info,
+    GstBuffer * buffer, GstVideoFrame * frame, gpointer addr[3])
+{
+  GstVideoMeta *meta = gst_buffer_get_video_meta (buffer);
+  guint i;
+
+  memset (frame, 0, sizeof (GstVideoFrame));
+  frame->info = *info;
+  frame->buffer = buffer;
+  frame->meta = meta;
+
+  if (meta) {
+    if (meta->format != GST_VIDEO_INFO_FORMAT (info) ||
+        meta->n_planes != GST_VIDEO_INFO_N_PLANES (info))
+      return FALSE;
+    frame->info.width = meta->width;
+    frame->info.height = meta->height;
+    for (i = 0; i < meta->n_planes; i++) {
+      frame->info.offset[i] = meta->offset[i];
+      frame->info.stride[i] = meta->stride[i];
+    }
+  } else if (gst_buffer_get_size (buffer) < info->size) {
+    return FALSE;
   }
 
-  {
-    /* Setting input parameters */
-    src_alpha_par.addr_a   = NULL;
-    src_alpha_par.alphan   = VSP_ALPHA_NO;
-    src_alpha_par.alpha1   = 0;
-    src_alpha_par.alpha2   = 0;
-    src_alpha_par.astride  = 0;
-    src_alpha_par.aswap    = VSP_SWAP_NO;
-    src_alpha_par.asel     = VSP_ALPHA_NUM5;
-    src_alpha_par.aext     = VSP_AEXT_EXPAN;
-    src_alpha_par.anum0    = 0;
-    src_alpha_par.anum1    = 0;
-    src_alpha_par.afix     = 0xff;
-    src_alpha_par.irop     = VSP_IROP_NOP;
-    src_alpha_par.msken    = VSP_MSKEN_ALPHA;
-    src_alpha_par.bsel     = 0;
-    src_alpha_par.mgcolor  = 0;
-    src_alpha_par.mscolor0 = 0;
-    src_alpha_par.mscolor1 = 0;
-
-    src_par.addr           = src_addr[0];
-    src_par.addr_c0        = src_addr[1];
-    src_par.addr_c1        = src_addr[2];
-    src_par.stride         = in_frame->info.stride[0];
-    src_par.stride_c       = in_frame->info.stride[1];
-    src_par.csc            = VSP_CSC_OFF;  /* do not convert colorspace */
-    src_par.width          = in_width;
-    src_par.height         = in_height;
-    src_par.width_ex       = 0;
-    src_par.height_ex      = 0;
-    src_par.x_offset       = 0;
-    src_par.y_offset       = 0;
-    src_par.format         = vsp_info->in_format;
-    src_par.swap           = vsp_info->in_swapbit;
-    src_par.x_position     = 0;
-    src_par.y_position     = 0;
-    src_par.pwd            = VSP_LAYER_PARENT;
-    src_par.cipm           = VSP_CIPM_0_HOLD;
-    src_par.cext           = VSP_CEXT_EXPAN;
-    src_par.iturbt         = VSP_ITURBT_709;
-    src_par.clrcng         = VSP_ITU_COLOR;
-    src_par.vir            = VSP_NO_VIR;
-    src_par.vircolor       = 0x00000000;
-    src_par.osd_lut        = NULL;
-    src_par.alpha_blend    = &src_alpha_par;
-    src_par.clrcnv         = NULL;
-    src_par.connect        = use_module;
+  for (i = 0; i < 3; i++) {
+    addr[i] = NULL;
+    if (i < GST_VIDEO_FRAME_N_PLANES (frame) &&
+        (addr[i] = gst_vspm_filter_plane_address_unmapped (space, frame,
+                i)) == NULL)
+      return FALSE;
   }
 
-  {
-    /* Setting output parameters */
-    dst_par.addr           = dst_addr[0];
-    dst_par.addr_c0        = dst_addr[1];
-    dst_par.addr_c1        = dst_addr[2];
-    dst_par.stride         = out_frame->info.stride[0];
-    dst_par.stride_c       = out_frame->info.stride[1];
+  return TRUE;
+}
 
-    /* convert if format in and out different in color space */
-    if (!GST_VIDEO_FORMAT_INFO_IS_YUV(vspm_in_vinfo) != !GST_VIDEO_FORMAT_INFO_IS_YUV(vspm_out_vinfo)) {
-      dst_par.csc          = VSP_CSC_ON;
-    } else {
-      dst_par.csc          = VSP_CSC_OFF;
+/* Convert in_frame to out_frame. Frames of the zero-copy path are not
+ * mapped, only describe the layout of their buffers, and come with the
+ * hardware addresses of their planes in src_known and dst_known. Both are
+ * NULL for mapped frames, whose addresses are looked up here */
+static GstFlowReturn
+gst_vspm_filter_convert (GstVspmFilter * space,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame,
+    gpointer src_known[3], gpointer dst_known[3])
+{
+  GstVideoFilter *filter = GST_VIDEO_FILTER_CAST (space);
+  GstVspmFilterVspInfo *vsp_info;
+  gboolean mapped = src_known == NULL;
+
+  GstVspmFilterJobTemplate *tmpl;
+
+  gint in_x, in_y, in_width, in_height;
+  gint dst_x, dst_y, dst_width, dst_height;
+  long ercd;
+  gint irc;
+
+  int i;
+  GstFlowReturn ret;
+  gint stride[GST_VIDEO_MAX_PLANES];
+  gsize offset[GST_VIDEO_MAX_PLANES];
+  gint offs, plane_size;
+  void *src_addr[3] = { 0 };
+  void *dst_addr[3] = { 0 };
+  guint in_n_planes, out_n_planes;
+  GstVspmFilterJob *job = NULL;
+  GstVideoFrame bounce_in_frame, bounce_out_frame;
+  GstVideoFrame pass_frames[2];
+  GstVideoFrame *src_frame = in_frame, *dst_frame = out_frame;
+
+  vsp_info = space->vsp_info;
+
+  GST_CAT_DEBUG_OBJECT (GST_CAT_PERFORMANCE, filter,
+      "doing colorspace conversion from %s -> to %s",
+      GST_VIDEO_INFO_NAME (&filter->in_info),
+      GST_VIDEO_INFO_NAME (&filter->out_info));
+
+  vsp_info->gst_format_in = GST_VIDEO_FRAME_FORMAT (in_frame);
+  vsp_info->in_width = GST_VIDEO_FRAME_COMP_WIDTH (in_frame, 0);
+  vsp_info->in_height = GST_VIDEO_FRAME_COMP_HEIGHT (in_frame, 0);
+
+  vsp_info->gst_format_out = GST_VIDEO_FRAME_FORMAT (out_frame);
+  vsp_info->out_width = GST_VIDEO_FRAME_COMP_WIDTH (out_frame, 0);
+  vsp_info->out_height = GST_VIDEO_FRAME_COMP_HEIGHT (out_frame, 0);
+
+  /* formats outside the tables are left to the software path */
+  if (vsp_info->format_flag == 0 && !gst_vspm_filter_software_enabled (space)) {
+    irc = gst_vspm_set_colorspace (GST_VIDEO_FRAME_FORMAT (in_frame), &vsp_info->in_format, &vsp_info->in_swapbit);
+    if (irc != 0) {
+      GST_ERROR("input format is non-support.\n");
+      ret = GST_FLOW_ERROR;
+      goto err;
+    }
+
+    irc = gst_vspm_set_colorspace_output (GST_VIDEO_FRAME_FORMAT (out_frame), &vsp_info->out_format, &vsp_info->out_swapbit);
+    if (irc != 0) {
+      GST_ERROR("output format is non-support.\n");
+      ret = GST_FLOW_ERROR;
+      goto err;
     }
+    vsp_info->format_flag = 1;
+  }
 
-    dst_par.width          = out_width;
-    dst_par.height         = out_height;
-    dst_par.x_offset       = 0;
-    dst_par.y_offset       = 0;
-    dst_par.format         = vsp_info->out_format;
-    dst_par.pxa            = VSP_PAD_P;
-    dst_par.pad            = 0xff;
-    dst_par.x_coffset      = 0;
-    dst_par.y_coffset      = 0;
-    dst_par.iturbt         = VSP_ITURBT_709;
-    dst_par.clrcng         = VSP_ITU_COLOR;
-    dst_par.cbrm           = VSP_CSC_ROUND_DOWN;
-    dst_par.abrm           = VSP_CONVERSION_ROUNDDOWN;
-    dst_par.athres         = 0;
-    dst_par.clmd           = VSP_CLMD_NO;
-    dst_par.dith           = VSP_NO_DITHER;
-    dst_par.swap           = vsp_info->out_swapbit;
+  if (gst_vspm_filter_qos_drop (space, in_frame->buffer))
+    return GST_BASE_TRANSFORM_FLOW_DROPPED;
+
+  gst_vspm_filter_get_crop (space, in_frame, &in_x, &in_y,
+      &in_width, &in_height);
+
+  dst_x = dst_y = 0;
+  dst_width = GST_VIDEO_FRAME_WIDTH (out_frame);
+  dst_height = GST_VIDEO_FRAME_HEIGHT (out_frame);
+  if (space->add_borders)
+    gst_vspm_filter_get_borders (in_frame, in_width, in_height, out_frame,
+        &dst_x, &dst_y, &dst_width, &dst_height);
+  if (gst_vspm_filter_plan_passes (space, in_frame, out_frame,
+          in_width, in_height, dst_width, dst_height) == 0) {
+#ifdef HAVE_VSPM_SOFTWARE
+    if (space->software_fallback)
+      return gst_vspm_filter_software_transform (space, in_frame, out_frame,
+          mapped, in_x, in_y, in_width, in_height, dst_x, dst_y, dst_width,
+          dst_height);
+#endif
+    /* the UDS ratios would be truncated, never hand them to the HW */
+    GST_ELEMENT_WARNING (space, STREAM, FAILED, (NULL),
+        ("%dx%d -> %dx%d is beyond the VSP limits, frame dropped",
+            in_width, in_height, dst_width, dst_height));
+    ret = GST_BASE_TRANSFORM_FLOW_DROPPED;
+    goto err;
   }
 
-  {
-    /* Setting resize parameters */
-    if (use_module == VSP_UDS_USE) {
-      /* Set T_VSP_UDS. */
-      ctrl_par.uds         = &uds_par;
-
-      memset(&uds_par, 0, sizeof(T_VSP_UDS));
-      uds_par.fmd          = VSP_FMD_NO;
-      uds_par.filcolor     = 0x0000FF00; /* green */
-      uds_par.amd          = VSP_AMD;
-      uds_par.clip         = VSP_CLIP_OFF;
-      uds_par.alpha        = VSP_ALPHA_ON;
-      uds_par.complement   = VSP_COMPLEMENT_BIL;
-      uds_par.athres0      = 0;
-      uds_par.athres1      = 0;
-      uds_par.anum0        = 0;
-      uds_par.anum1        = 0;
-      uds_par.anum2        = 0;
-      uds_par.x_ratio      = (unsigned short)( (in_width << 12) / out_width );
-      uds_par.y_ratio      = (unsigned short)( (in_height << 12) / out_height );
-      uds_par.out_cwidth   = (unsigned short)out_width;
-      uds_par.out_cheight  = (unsigned short)out_height;
-      uds_par.connect      = 0;
+  in_n_planes = GST_VIDEO_FRAME_N_PLANES (in_frame);
+  out_n_planes = GST_VIDEO_FRAME_N_PLANES (out_frame);
+
+  job = gst_vspm_filter_job_new (in_frame->buffer, out_frame->buffer);
+
+  if (mapped) {
+    gst_vspm_filter_find_addresses (space, in_frame, out_frame, src_addr,
+        dst_addr);
+  } else {
+    for (i = 0; i < 3; i++) {
+      src_addr[i] = src_known[i];
+      dst_addr[i] = dst_known[i];
     }
+    GST_OBJECT_LOCK (space);
+    space->stats.zero_copy++;
+    GST_OBJECT_UNLOCK (space);
   }
 
-  {
-    /* Update all settings */
-    vsp_par.rpf_num        = 1;
-    vsp_par.use_module     = use_module;
-    vsp_par.src1_par       = &src_par;
-    vsp_par.src2_par       = NULL;
-    vsp_par.src3_par       = NULL;
-    vsp_par.src4_par       = NULL;
-    vsp_par.dst_par        = &dst_par;
-    vsp_par.ctrl_par       = &ctrl_par;
+  /* Sometimes a virtual address can not be converted to a physical one.
+   * Rather than skipping the frame, stage it in contiguous mmngr memory */
+  if (!src_addr[0] || (in_n_planes >= 2 && !src_addr[1]) ||
+      (in_n_planes >= 3 && !src_addr[2])) {
+    if (!gst_vspm_filter_bounce_in (space, job, in_frame, &bounce_in_frame,
+            src_addr))
+      goto skip;
+    src_frame = &bounce_in_frame;
+  }
+  if (!dst_addr[0] || (out_n_planes >= 2 && !dst_addr[1]) ||
+      (out_n_planes >= 3 && !dst_addr[2])) {
+    if (!gst_vspm_filter_bounce_out (space, job, out_frame, &bounce_out_frame,
+            dst_addr))
+      goto skip;
+    dst_frame = &bounce_out_frame;
   }
 
-  memset(&vspm_ip, 0, sizeof(VSPM_IP_PAR));
-  vspm_ip.uhType             = VSPM_TYPE_VSP_AUTO;
-  vspm_ip.unionIpParam.ptVsp = &vsp_par;
+  /* Ratios beyond the UDS go through intermediate frames first */
+  if (space->n_passes > 1 &&
+      !gst_vspm_filter_run_passes (space, job, in_frame, &src_frame,
+          pass_frames, src_addr, &in_x, &in_y, &in_width, &in_height)) {
+    ret = GST_FLOW_ERROR;
+    goto err;
+  }
+
+  /* Bounce buffers have their own strides, matched as any other layout */
+  tmpl = &space->job_tmpl;
+  if (!gst_vspm_filter_job_template_matches (space, tmpl, src_frame,
+          dst_frame, in_x, in_y, in_width, in_height, dst_x, dst_y,
+          dst_width, dst_height))
+    gst_vspm_filter_build_job_template (space, tmpl, src_frame, dst_frame,
+        in_x, in_y, in_width, in_height, dst_x, dst_y, dst_width,
+        dst_height);
+
+#ifdef HAVE_VSPM_SOFTWARE
+  /* rather than showing seams between stripes */
+  if (!tmpl->exact_seams && space->software_fallback &&
+      space->n_passes == 1) {
+    GST_DEBUG_OBJECT (space, "stripes would show seams, converting in "
+        "software");
+    ret = gst_vspm_filter_software_transform (space, in_frame, out_frame,
+        mapped, in_x, in_y, in_width, in_height, dst_x, dst_y, dst_width,
+        dst_height);
+    goto err;
+  }
+#endif
+
+  /* Only the plane addresses change from one frame to the next */
+  tmpl->src_par.addr     = src_addr[0];
+  tmpl->src_par.addr_c0  = src_addr[1];
+  tmpl->src_par.addr_c1  = src_addr[2];
+  tmpl->dst_par.addr     = dst_addr[0];
+  tmpl->dst_par.addr_c0  = dst_addr[1];
+  tmpl->dst_par.addr_c1  = dst_addr[2];
+
 
-  ercd = VSPM_lib_Entry(vsp_info->vspm_handle, &vsp_info->jobid, 126, &vspm_ip, (unsigned long)&space->smp_wait, cb_func);
+  ercd = gst_vspm_filter_submit (space, tmpl, job);
   if (ercd) {
     GST_ERROR ("VSPM_lib_Entry() Failed!! ercd=%ld\n", ercd);
+    /* stripes queued before the failure still use the buffers */
+    sem_wait (&job->smp_wait);
     ret = GST_FLOW_ERROR;
     goto err;
   }
 
+  if (space->max_inflight > 1) {
+    /* Do not wait: the output buffer is pushed in order by
+     * gst_vspm_filter_finish_job once the hardware is done with it */
+    g_queue_push_tail (space->pending_jobs, job);
+    job = NULL;
+
+    ret = gst_vspm_filter_push_done (space);
+    while (ret == GST_FLOW_OK &&
+        g_queue_get_length (space->pending_jobs) >= space->max_inflight)
+      ret = gst_vspm_filter_finish_job (space, TRUE);
+
+    if (ret == GST_FLOW_OK)
+      ret = GST_BASE_TRANSFORM_FLOW_DROPPED;
+    goto done;
+  }
+
   /* Wait for callback */
-  sem_wait (&space->smp_wait);
+  sem_wait (&job->smp_wait);
+  gst_vspm_filter_update_job_time (space, job);
+  if (gst_vspm_filter_job_failed (space, job)) {
+    ret = GST_BASE_TRANSFORM_FLOW_DROPPED;
+    goto err;
+  }
+  gst_vspm_filter_bounce_finish (space, job, out_frame);
 
   ret = GST_FLOW_OK;
+  goto err;
+
+skip:
+  /* No bounce buffer either: rather than hand the HW a bad address, drop
+   * the frame, the output buffer was never written */
+  GST_ELEMENT_WARNING (space, STREAM, FAILED, (NULL),
+      ("no hardware address for the frame, frame dropped"));
+  GST_OBJECT_LOCK (space);
+  space->stats.skipped++;
+  GST_OBJECT_UNLOCK (space);
+  ret = GST_BASE_TRANSFORM_FLOW_DROPPED;
+
 err:
-  /* Release the importing to avoid leak FD */
-  gst_vspm_filter_release_fd (space->mmngr_import_list);
+  /* The base class pushes this buffer, queued ones must go out first */
+  if (ret == GST_FLOW_OK || ret == GST_BASE_TRANSFORM_FLOW_DROPPED) {
+    GstFlowReturn res = gst_vspm_filter_drain (space, TRUE);
+
+    if (res != GST_FLOW_OK)
+      ret = res;
+  }
+
+  if (job)
+    gst_vspm_filter_job_free (job);
+
+done:
+  if (src_frame != in_frame)
+    gst_video_frame_unmap (src_frame);
+  if (dst_frame != out_frame)
+    gst_video_frame_unmap (dst_frame);
+
+  return ret;
+}
+
+static GstFlowReturn
+gst_vspm_filter_transform_frame (GstVideoFilter * filter,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame)
+{
+  return gst_vspm_filter_convert (GST_VIDEO_CONVERT_CAST (filter), in_frame,
+      out_frame, NULL, NULL);
+}
+
+/* GstBaseTransform::transform. GstVideoFilter maps every frame for
+ * transform_frame, which for dmabuf memory means an mmap, and cache
+ * maintenance, per plane and frame. When the VSP reaches all the planes
+ * through the pools of the plugin or dmabuf imports, the frames are
+ * converted without ever being mapped */
+static GstFlowReturn
+gst_vspm_filter_transform_buffer (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstVideoFilter *filter = GST_VIDEO_FILTER_CAST (trans);
+  GstVspmFilter *space = GST_VIDEO_CONVERT_CAST (trans);
+  GstVideoFrame in_frame, out_frame;
+  gpointer src_addr[3], dst_addr[3];
+  GstFlowReturn ret;
+
+  if (G_UNLIKELY (!filter->negotiated))
+    goto unknown_format;
+
+  if (gst_vspm_filter_frame_layout (space, &filter->in_info, inbuf,
+          &in_frame, src_addr) &&
+      gst_vspm_filter_frame_layout (space, &filter->out_info, outbuf,
+          &out_frame, dst_addr))
+    return gst_vspm_filter_convert (space, &in_frame, &out_frame, src_addr,
+        dst_addr);
+
+  /* memory the VSP can only reach through its virtual address */
+  if (!gst_video_frame_map (&in_frame, &filter->in_info, inbuf, GST_MAP_READ))
+    goto invalid_buffer;
+  if (!gst_video_frame_map (&out_frame, &filter->out_info, outbuf,
+          GST_MAP_WRITE)) {
+    gst_video_frame_unmap (&in_frame);
+    goto invalid_buffer;
+  }
+
+  ret = gst_vspm_filter_convert (space, &in_frame, &out_frame, NULL, NULL);
+
+  gst_video_frame_unmap (&out_frame);
+  gst_video_frame_unmap (&in_frame);
 
   return ret;
+
+  /* ERRORS */
+unknown_format:
+  {
+    GST_ELEMENT_ERROR (space, CORE, NOT_NEGOTIATED, (NULL),
+        ("unknown format"));
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+invalid_buffer:
+  {
+    GST_ELEMENT_WARNING (space, CORE, NOT_IMPLEMENTED, (NULL),
+        ("invalid video buffer received"));
+    return GST_FLOW_OK;
+  }
 }
 
 static gboolean
@@ -1473,9 +4158,25 @@ plugin_init (GstPlugin * plugin)
       "Colorspace and Video Size Converter");
 
   _colorspace_quark = g_quark_from_static_string ("colorspace");
+  _vtop_cache_quark = g_quark_from_static_string ("GstVspmFilterVtopCache");
+  _import_quark = g_quark_from_static_string ("GstVspmFilterImport");
+  _vspm_buffer_quark = g_quark_from_static_string ("GstVspmFilterBuffer");
+
+  if (!gst_element_register (plugin, "vspmfilter",
+      GST_RANK_NONE, GST_TYPE_VIDEO_CONVERT))
+    return FALSE;
+
+  if (!gst_element_register (plugin, "vspmmultiscale",
+      GST_RANK_NONE, GST_TYPE_VSPM_MULTISCALE))
+    return FALSE;
 
-  return gst_element_register (plugin, "vspmfilter",
-      GST_RANK_NONE, GST_TYPE_VIDEO_CONVERT);
+#ifdef HAVE_VSPM_COMPOSITOR
+  if (!gst_element_register (plugin, "vspmcompositor",
+      GST_RANK_NONE, GST_TYPE_VSPM_COMPOSITOR))
+    return FALSE;
+#endif
+
+  return TRUE;
 }
 
 GST_PLUGIN_DEFINE (GST_VERSION_MAJOR,
@@ -43,6 +43,9 @@
 #include <linux/v4l2-subdev.h>
 #include <linux/v4l2-mediabus.h>
 
+#include "vspm_public.h"
+#include "gstvspmsoftware.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_VIDEO_CONVERT	          (gst_vspm_filter_get_type())
@@ -56,7 +59,13 @@ G_BEGIN_DECLS
 
 #define N_BUFFERS 1
 
+/* number of VSPM jobs that may be queued to the hardware at once */
+#define DEFAULT_MAX_INFLIGHT 1
+#define MAX_INFLIGHT 16
+
+/* VSP channels jobs are spread over, see gst_vspm_entry */
 #define MAX_DEVICES 2
+#define DEFAULT_VSP_CHANNEL -1
 #define MAX_ENTITIES 4
 
 /* mmngr dev name */
@@ -83,13 +92,36 @@ typedef struct _GstVspmFilterVspInfo GstVspmFilterVspInfo;
 typedef struct _GstVspmFilterBufferPool GstVspmFilterBufferPool;
 typedef struct _GstVspmFilterBufferPoolClass GstVspmFilterBufferPoolClass;
 
+typedef struct {
+  guint outbuf_size;
+  guint width;
+  guint height;
+  GstVideoFormat format;
+  guint n_planes;
+  gint  plane_width[GST_VIDEO_MAX_PLANES];
+  gint  plane_height[GST_VIDEO_MAX_PLANES];
+  gint  plane_pixel_stride[GST_VIDEO_MAX_PLANES];
+  gint  plane_stride[GST_VIDEO_MAX_PLANES];
+  gsize plane_offset[GST_VIDEO_MAX_PLANES];
+  gsize plane_base[GST_VIDEO_MAX_PLANES];
+  gint  plane_size[GST_VIDEO_MAX_PLANES];
+  GstVideoAlignment align;
+} VspmBufferInfo;
+
 struct _GstVspmFilterBufferPool
 {
   GstBufferPool bufferpool;
 
-  GstVspmFilter *vspmfilter;
+  GstElement *element;
+  GstAllocator *allocator;
 
   GstCaps *caps;
+  VspmBufferInfo buf_info;
+  gboolean use_dmabuf;
+
+  /* mmngr areas of freed buffers, reused when a new configuration fits */
+  GMutex spare_lock;
+  GSList *spare_mem;
 };
 
 struct _GstVspmFilterBufferPoolClass
@@ -138,6 +170,7 @@ struct _GstVspmFilterVspInfo {
 
 typedef struct {
   int mmng_pid;
+  guint size;
   int dmabuf_pid[GST_VIDEO_MAX_PLANES];
   unsigned long pphy_addr;
   unsigned long phard_addr;
@@ -146,30 +179,114 @@ typedef struct {
   GstBuffer *buf;
 } Vspm_dmabuff;
 
+
+/* Frames wider than one VSP job can take are converted in vertical
+ * stripes, each a VSPM job of its own */
+#define VSPM_MAX_STRIPES        32
+
+typedef struct _GstVspmFilterJob GstVspmFilterJob;
+
 typedef struct {
-  Vspm_dmabuff vspm[5];
-  int used;
-} Vspm_mmng_ar;
+  GstVspmFilterJob *job;
+  unsigned long jobid;
+  gint channel;
+} GstVspmFilterJobStripe;
+
+/* One frame queued to the hardware. The input and output buffers are
+ * kept alive until cb_func reports that the hardware finished all the
+ * stripes of the frame */
+struct _GstVspmFilterJob {
+  GstBuffer *inbuf;
+  GstBuffer *outbuf;
+  GstBuffer *bounce_out;    /* written by the VSP, copied to outbuf */
+  long result;
+  gint done;
+  gint remaining;           /* stripes in the hardware, +1 while queueing */
+  guint n_stripes;
+  GstVspmFilterJobStripe stripes[VSPM_MAX_STRIPES];
+  gint64 submit_time, done_time;  /* monotonic, in microseconds */
+  sem_t smp_wait;
+};
+
+
+/* Time spent in one stage of the frame path. histogram[i] counts the
+ * samples up to the i-th bound of vspm_stats_bounds, the last one the
+ * samples above all bounds */
+#define VSPM_STATS_BUCKETS 10
 
 typedef struct {
-  GPtrArray *buf_array;
-  gint current_buffer_index;
-}VspmbufArray ;
+  guint64 count;
+  GstClockTime total;
+  GstClockTime max;
+  guint64 histogram[VSPM_STATS_BUCKETS];
+} GstVspmFilterTiming;
 
 typedef struct {
-  guint outbuf_size;
-  guint width;
-  guint height;
-  GstVideoFormat format;
-  guint n_planes;
-  gint  plane_width[GST_VIDEO_MAX_PLANES];
-  gint  plane_height[GST_VIDEO_MAX_PLANES];
-  gint  plane_pixel_stride[GST_VIDEO_MAX_PLANES];
-  gint  plane_stride[GST_VIDEO_MAX_PLANES];
-  gsize plane_offset[GST_VIDEO_MAX_PLANES];
-  gint  plane_size[GST_VIDEO_MAX_PLANES];
-} VspmBufferInfo;
+  GstVspmFilterTiming vtop;       /* MM_IOC_VTOP translations */
+  GstVspmFilterTiming import;     /* dmabuf imports */
+  GstVspmFilterTiming job;        /* VSPM submit to callback */
+  GstVspmFilterTiming pool_wait;  /* output buffer acquisition */
+  GstVspmFilterTiming bounce;     /* copies through bounce buffers */
+  GstVspmFilterTiming software;   /* frames converted by the CPU */
+  GstVspmFilterTiming passes;     /* intermediate passes of a frame */
+  guint64 skipped;                /* frames without hardware addresses */
+  guint64 zero_copy;              /* frames converted without CPU mapping */
+  guint64 vtop_hits;              /* planes found in the VtoP cache */
+  guint64 vtop_misses;            /* planes translated by MM_IOC_VTOP */
+} GstVspmFilterStats;
+
+/* Limits of a single VSP job. The UDS scale ratios are 4.12 fixed point
+ * input / output sizes */
+#define VSPM_MAX_SIZE           8190
+#define VSPM_UDS_MAX_RATIO      0xffff    /* just under 16x down */
+#define VSPM_UDS_MIN_RATIO      0x0100    /* 16x up */
+#define VSPM_UDS_MAX_WIDTH      2048      /* widest line of one UDS pass */
+
+/* Columns of the output written by one stripe, and the input columns
+ * (from the left of the crop) it reads. The UDS output starts clip
+ * columns left of out_x, they are dropped by the WPF */
+typedef struct {
+  gint in_x, in_width;
+  gint out_x, out_width;
+  gint clip, uds_width;
+  gsize out_offset[3];      /* of out_x in each output plane */
+} GstVspmFilterStripe;
+
+/* VSP job parameters built once per negotiated caps, crop and border
+ * settings. Between frames only the plane addresses change */
+typedef struct {
+  gboolean valid;
+  gint in_x, in_y, in_width, in_height;
+  gint dst_x, dst_y, dst_width, dst_height;
+  GstVideoInfo in_info, out_info;     /* formats, sizes and plane layouts */
+  guint border_color;
+  gboolean split_frame;
+  guint in_n_planes, out_n_planes;
+  guint n_stripes;
+  gboolean exact_seams;     /* every stripe samples as a single job would */
+  GstVspmFilterStripe stripes[VSPM_MAX_STRIPES];
+
+  T_VSP_IN src_par;
+  T_VSP_ALPHA src_alpha_par;
+  T_VSP_OUT dst_par;
+  T_VSP_CTRL ctrl_par;
+  T_VSP_UDS uds_par;
+  T_VSP_BRU bru_par;
+  T_VSP_BLEND_VIRTUAL virt_par;
+  T_VSP_BLEND_CONTROL blend_par;
+  VSPM_VSP_PAR vsp_par;
+} GstVspmFilterJobTemplate;
+
+/* Scale ratios beyond one UDS pass are reached in up to VSPM_MAX_PASSES
+ * VSP jobs, all but the last writing to a pooled intermediate frame in
+ * the input format */
+#define VSPM_MAX_PASSES         3
 
+typedef struct {
+  GstVideoInfo info;        /* of the frame the pass writes */
+  GstBufferPool *pool;
+  GstVspmFilterJobTemplate tmpl;
+} GstVspmFilterPass;
 
 /**
  * GstVspmFilter:
@@ -180,17 +297,36 @@ struct _GstVspmFilter {
   GstVideoFilter element;
 
   GstVspmFilterVspInfo *vsp_info;
-  GstAllocator *allocator;
   guint use_dmabuf;
   guint outbuf_allocate;
   VspmBufferInfo buf_info;
   GstBufferPool *in_port_pool, *out_port_pool;
-  Vspm_mmng_ar *vspm_in;
-  Vspm_mmng_ar *vspm_out;
-  VspmbufArray *vspm_outbuf;
-  GQueue *mmngr_import_list;
+  /* mmngr staging for frames the VSP can not address */
+  GstBufferPool *bounce_in_pool, *bounce_out_pool;
   gint first_buff;
-  sem_t smp_wait;
+  guint max_inflight;
+  guint min_buffers;
+  guint max_buffers;
+  GQueue *pending_jobs;
+  guint crop_left, crop_right, crop_top, crop_bottom;
+  gboolean add_borders;
+  guint border_color;
+  gint vsp_channel;
+  GstVspmFilterJobTemplate job_tmpl;
+  guint n_passes;
+  GstVspmFilterPass passes[VSPM_MAX_PASSES - 1];
+  gboolean software_fallback;
+  GstVspmSoftware *software;
+  gboolean split_frame;
+
+  /* smoothed submit to callback time, protected by the object lock */
+  GstClockTime job_time;
+  GstClockTime reported_job_time;
+  GstClockTime earliest_time;
+  guint64 qos_processed, qos_dropped;
+
+  /* frame path statistics, protected by the object lock */
+  GstVspmFilterStats stats;
 };
 
 struct _GstVspmFilterClass
@@ -200,6 +336,36 @@ struct _GstVspmFilterClass
 
 GType gst_vspmfilter_buffer_pool_get_type (void);
 
+/* Shared with the other VSPM elements of the plugin */
+GstBufferPool *gst_vspmfilter_buffer_pool_new (GstElement * element,
+    gboolean use_dmabuf);
+gboolean gst_vspmfilter_buffer_pool_reconfigure (GstBufferPool ** pool,
+    GstStructure * config);
+void gst_vspm_filter_set_buffer_info (VspmBufferInfo * buf_info,
+    GstVideoInfo * info, GstVideoAlignment * align);
+GstCaps *gst_vspm_caps_new (gboolean output);
+gint gst_vspm_set_colorspace (GstVideoFormat vid_fmt, guint * format,
+    guint * fswap);
+gint gst_vspm_set_colorspace_output (GstVideoFormat vid_fmt, guint * format,
+    guint * fswap);
+gpointer gst_vspm_frame_plane_address (int mmngr_fd, GstVideoFrame * frame,
+    gint plane);
+void gst_vspm_init_in_par (T_VSP_IN * src_par, T_VSP_ALPHA * alpha_par,
+    void *addr[3], gint stride, gint stride_c, gint width, gint height,
+    guint format, guint swap);
+void gst_vspm_init_out_par (T_VSP_OUT * dst_par, void *addr[3],
+    gint stride, gint stride_c, gint width, gint height, guint format,
+    guint swap);
+gboolean gst_vspm_uds_fits (gint in_width, gint in_height, gint out_width,
+    gint out_height);
+gboolean gst_vspm_session_acquire (unsigned long * vspm_handle,
+    int * mmngr_fd);
+void gst_vspm_session_release (void);
+long gst_vspm_entry (unsigned long handle, gint * channel,
+    unsigned long * jobid, VSPM_IP_PAR * vspm_ip, unsigned long user_data,
+    PFN_VSPM_COMPLETE_CALLBACK cb);
+void gst_vspm_channel_release (gint channel);
+
 G_END_DECLS
 
 #endif /* __GST_VSPMFILTER_H__ */
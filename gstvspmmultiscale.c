@@ -0,0 +1,843 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * SECTION:element-vspmmultiscale
+ *
+ * Convert one video stream to several sizes and formats at once. Every
+ * request src pad negotiates its own caps; the input buffer is translated
+ * to hardware addresses once and one VSPM job per output is queued back to
+ * back.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 videotestsrc ! video/x-raw,width=1920,height=1080 ! \
+ *     vspmmultiscale name=m \
+ *     m. ! video/x-raw,width=1280,height=720 ! queue ! fakesink \
+ *     m. ! video/x-raw,format=BGRx,width=224,height=224 ! queue ! fakesink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include "gstvspmmultiscale.h"
+
+#include <stdio.h>
+#include <string.h>
+
+GST_DEBUG_CATEGORY_STATIC (vspmmultiscale_debug);
+#define GST_CAT_DEFAULT vspmmultiscale_debug
+
+/* buffers the pools keep for a downstream which does not say */
+#define MIN_OUTPUT_BUFFERS 2
+
+enum
+{
+  PROP_0,
+  PROP_VSP_CHANNEL
+};
+
+G_DEFINE_TYPE (GstVspmMultiscalePad, gst_vspm_multiscale_pad, GST_TYPE_PAD);
+#define gst_vspm_multiscale_parent_class parent_class
+G_DEFINE_TYPE (GstVspmMultiscale, gst_vspm_multiscale, GST_TYPE_ELEMENT);
+
+static void
+gst_vspm_multiscale_pad_finalize (GObject * object)
+{
+  GstVspmMultiscalePad *pad = GST_VSPM_MULTISCALE_PAD (object);
+
+  if (pad->pool) {
+    gst_buffer_pool_set_active (pad->pool, FALSE);
+    gst_object_unref (pad->pool);
+  }
+  sem_destroy (&pad->smp_wait);
+
+  G_OBJECT_CLASS (gst_vspm_multiscale_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_vspm_multiscale_pad_class_init (GstVspmMultiscalePadClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+
+  gobject_class->finalize = gst_vspm_multiscale_pad_finalize;
+}
+
+static void
+gst_vspm_multiscale_pad_init (GstVspmMultiscalePad * pad)
+{
+  gst_video_info_init (&pad->info);
+  pad->negotiated = FALSE;
+  pad->flow = GST_FLOW_OK;
+  sem_init (&pad->smp_wait, 0, 0);
+}
+
+/* callback function */
+static void
+gst_vspm_multiscale_cb (unsigned long uwJobId, long wResult,
+    unsigned long uwUserData)
+{
+  GstVspmMultiscalePad *pad = (GstVspmMultiscalePad *) uwUserData;
+
+  if (wResult != 0) {
+    GST_ERROR ("VSPM: error end. (%ld)\n", wResult);
+  }
+  pad->result = wResult;
+  if (pad->channel >= 0)
+    gst_vspm_channel_release (pad->channel);
+  sem_post (&pad->smp_wait);
+}
+
+static GList *
+gst_vspm_multiscale_get_src_pads (GstVspmMultiscale * self)
+{
+  GList *pads;
+
+  GST_OBJECT_LOCK (self);
+  pads = g_list_copy (GST_ELEMENT (self)->srcpads);
+  g_list_foreach (pads, (GFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (self);
+
+  return pads;
+}
+
+/* Pick caps for one output from what its peer accepts, push them and set
+ * up the pool of the output */
+static gboolean
+gst_vspm_multiscale_negotiate_pad (GstVspmMultiscale * self,
+    GstVspmMultiscalePad * pad)
+{
+  GstVideoInfo *in_info = &self->in_info;
+  GstCaps *templ, *caps;
+  GstStructure *s;
+  GstQuery *query;
+  GstStructure *config;
+  guint min = 0, max = 0;
+
+  pad->negotiated = FALSE;
+
+  templ = gst_pad_get_pad_template_caps (GST_PAD (pad));
+  caps = gst_pad_peer_query_caps (GST_PAD (pad), templ);
+  gst_caps_unref (templ);
+  if (gst_caps_is_empty (caps)) {
+    GST_WARNING_OBJECT (pad, "no caps accepted downstream");
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+
+  /* prefer what the input has for anything downstream leaves open */
+  caps = gst_caps_truncate (caps);
+  caps = gst_caps_make_writable (caps);
+  s = gst_caps_get_structure (caps, 0);
+  gst_structure_fixate_field_nearest_int (s, "width",
+      GST_VIDEO_INFO_WIDTH (in_info));
+  gst_structure_fixate_field_nearest_int (s, "height",
+      GST_VIDEO_INFO_HEIGHT (in_info));
+  gst_structure_fixate_field_string (s, "format",
+      gst_video_format_to_string (GST_VIDEO_INFO_FORMAT (in_info)));
+  if (gst_structure_has_field (s, "pixel-aspect-ratio"))
+    gst_structure_fixate_field_nearest_fraction (s, "pixel-aspect-ratio",
+        GST_VIDEO_INFO_PAR_N (in_info), GST_VIDEO_INFO_PAR_D (in_info));
+  /* one output frame per input frame */
+  gst_structure_set (s, "framerate", GST_TYPE_FRACTION,
+      GST_VIDEO_INFO_FPS_N (in_info), GST_VIDEO_INFO_FPS_D (in_info), NULL);
+  caps = gst_caps_fixate (caps);
+
+  if (!gst_video_info_from_caps (&pad->info, caps) ||
+      gst_vspm_set_colorspace_output (GST_VIDEO_INFO_FORMAT (&pad->info),
+          &pad->vsp_format, &pad->vsp_swap)) {
+    GST_WARNING_OBJECT (pad, "can not output %" GST_PTR_FORMAT, caps);
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+
+  /* one job per output: no stripes, and ratios the UDS registers hold */
+  if (!gst_vspm_uds_fits (GST_VIDEO_INFO_WIDTH (in_info),
+          GST_VIDEO_INFO_HEIGHT (in_info), GST_VIDEO_INFO_WIDTH (&pad->info),
+          GST_VIDEO_INFO_HEIGHT (&pad->info))) {
+    GST_WARNING_OBJECT (pad, "can not scale %dx%d to %" GST_PTR_FORMAT,
+        GST_VIDEO_INFO_WIDTH (in_info), GST_VIDEO_INFO_HEIGHT (in_info), caps);
+    gst_caps_unref (caps);
+    return FALSE;
+  }
+
+  GST_DEBUG_OBJECT (pad, "negotiated %" GST_PTR_FORMAT, caps);
+  gst_pad_push_event (GST_PAD (pad), gst_event_new_caps (caps));
+
+  query = gst_query_new_allocation (caps, TRUE);
+  if (gst_pad_peer_query (GST_PAD (pad), query) &&
+      gst_query_get_n_allocation_pools (query) > 0)
+    gst_query_parse_nth_allocation_pool (query, 0, NULL, NULL, &min, &max);
+  gst_query_unref (query);
+
+  min = MAX (min, MIN_OUTPUT_BUFFERS);
+  if (max)
+    max = MAX (max, min);
+
+  /* On a renegotiation an idle pool is reconfigured, so the memory of its
+   * old buffers is reused when it is large enough. A pool with buffers
+   * still downstream is replaced, see gst_vspmfilter_buffer_pool_reconfigure */
+  if (pad->pool == NULL)
+    pad->pool = gst_vspmfilter_buffer_pool_new (GST_ELEMENT (self), FALSE);
+  config = gst_buffer_pool_get_config (pad->pool);
+  gst_buffer_pool_config_set_params (config, caps,
+      GST_VIDEO_INFO_SIZE (&pad->info), min, max);
+  gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  gst_caps_unref (caps);
+  /* On failure the pad keeps a pool and negotiates again on the next frame */
+  if (!gst_vspmfilter_buffer_pool_reconfigure (&pad->pool, config) ||
+      !gst_buffer_pool_set_active (pad->pool, TRUE)) {
+    GST_WARNING_OBJECT (pad, "failed to set up the output pool");
+    return FALSE;
+  }
+
+  pad->negotiated = TRUE;
+
+  return TRUE;
+}
+
+/* Queue the job converting the input to one output, without waiting */
+static GstFlowReturn
+gst_vspm_multiscale_queue_job (GstVspmMultiscale * self,
+    GstVspmMultiscalePad * pad, GstVideoFrame * in_frame, void *src_addr[3])
+{
+  gint in_width = GST_VIDEO_FRAME_WIDTH (in_frame);
+  gint in_height = GST_VIDEO_FRAME_HEIGHT (in_frame);
+  gint out_width = GST_VIDEO_INFO_WIDTH (&pad->info);
+  gint out_height = GST_VIDEO_INFO_HEIGHT (&pad->info);
+  void *dst_addr[3] = { 0 };
+  unsigned long use_module = 0;
+  unsigned long jobid;
+  GstFlowReturn ret;
+  long ercd;
+  guint i;
+
+  ret = gst_buffer_pool_acquire_buffer (pad->pool, &pad->outbuf, NULL);
+  if (ret != GST_FLOW_OK)
+    return ret;
+
+  if (!gst_video_frame_map (&pad->out_frame, &pad->info, pad->outbuf,
+          GST_MAP_WRITE)) {
+    gst_buffer_unref (pad->outbuf);
+    pad->outbuf = NULL;
+    return GST_FLOW_ERROR;
+  }
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&pad->out_frame); i++) {
+    dst_addr[i] = gst_vspm_frame_plane_address (self->mmngr_fd,
+        &pad->out_frame, i);
+    if (!dst_addr[i]) {
+      GST_ERROR_OBJECT (pad,
+          "Can not find physical address of output buffer for planar %u", i + 1);
+      ret = GST_FLOW_ERROR;
+      goto error;
+    }
+  }
+
+  if ((in_width != out_width) || (in_height != out_height)) {
+    /* UDS scaling */
+    use_module = VSP_UDS_USE;
+  }
+
+  gst_vspm_init_in_par (&pad->src_par, &pad->src_alpha_par, src_addr,
+      GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 0),
+      GST_VIDEO_FRAME_PLANE_STRIDE (in_frame, 1),
+      in_width, in_height, self->in_format, self->in_swap);
+  pad->src_par.connect = use_module;
+
+  gst_vspm_init_out_par (&pad->dst_par, dst_addr,
+      GST_VIDEO_FRAME_PLANE_STRIDE (&pad->out_frame, 0),
+      GST_VIDEO_FRAME_PLANE_STRIDE (&pad->out_frame, 1),
+      out_width, out_height, pad->vsp_format, pad->vsp_swap);
+  /* convert if format in and out different in color space */
+  if (!GST_VIDEO_FORMAT_INFO_IS_YUV (in_frame->info.finfo) !=
+      !GST_VIDEO_INFO_IS_YUV (&pad->info))
+    pad->dst_par.csc = VSP_CSC_ON;
+
+  memset (&pad->ctrl_par, 0, sizeof (T_VSP_CTRL));
+  if (use_module == VSP_UDS_USE) {
+    memset (&pad->uds_par, 0, sizeof (T_VSP_UDS));
+    pad->uds_par.fmd          = VSP_FMD_NO;
+    pad->uds_par.amd          = VSP_AMD;
+    pad->uds_par.clip         = VSP_CLIP_OFF;
+    pad->uds_par.alpha        = VSP_ALPHA_ON;
+    pad->uds_par.complement   = VSP_COMPLEMENT_BIL;
+    /* in range, negotiate_pad checked it */
+    pad->uds_par.x_ratio      = (unsigned short)( (in_width << 12) / out_width );
+    pad->uds_par.y_ratio      = (unsigned short)( (in_height << 12) / out_height );
+    pad->uds_par.out_cwidth   = (unsigned short)out_width;
+    pad->uds_par.out_cheight  = (unsigned short)out_height;
+    pad->ctrl_par.uds = &pad->uds_par;
+  }
+
+  memset (&pad->vsp_par, 0, sizeof (VSPM_VSP_PAR));
+  pad->vsp_par.rpf_num        = 1;
+  pad->vsp_par.use_module     = use_module;
+  pad->vsp_par.src1_par       = &pad->src_par;
+  pad->vsp_par.dst_par        = &pad->dst_par;
+  pad->vsp_par.ctrl_par       = &pad->ctrl_par;
+
+  memset (&pad->vspm_ip, 0, sizeof (VSPM_IP_PAR));
+  pad->vspm_ip.unionIpParam.ptVsp = &pad->vsp_par;
+
+  /* with vsp-channel=-1 the outputs of a frame spread over the channels */
+  pad->channel = self->vsp_channel;
+  ercd = gst_vspm_entry (self->vspm_handle, &pad->channel, &jobid,
+      &pad->vspm_ip, (unsigned long) pad, gst_vspm_multiscale_cb);
+  if (ercd) {
+    GST_ELEMENT_ERROR (self, RESOURCE, FAILED, (NULL),
+        ("VSPM_lib_Entry() failed for %s, ercd=%ld", GST_PAD_NAME (pad),
+            ercd));
+    ret = GST_FLOW_ERROR;
+    goto error;
+  }
+  pad->queued = TRUE;
+
+  return GST_FLOW_OK;
+
+error:
+  gst_video_frame_unmap (&pad->out_frame);
+  gst_buffer_unref (pad->outbuf);
+  pad->outbuf = NULL;
+
+  return ret;
+}
+
+static void
+gst_vspm_multiscale_bounce_clear (GstVspmMultiscale * self)
+{
+  if (self->bounce_pool) {
+    gst_buffer_pool_set_active (self->bounce_pool, FALSE);
+    gst_object_unref (self->bounce_pool);
+    self->bounce_pool = NULL;
+  }
+}
+
+/* Copy an input frame the VSP can not address to an mmngr buffer, set up
+ * for the input caps the first time. bounce is left mapped and addr holds
+ * its plane addresses */
+static gboolean
+gst_vspm_multiscale_bounce_in (GstVspmMultiscale * self,
+    GstVideoFrame * in_frame, GstVideoFrame * bounce, void *addr[3])
+{
+  GstStructure *config;
+  GstCaps *caps;
+  GstBuffer *buf = NULL;
+  guint i;
+
+  if (self->bounce_pool == NULL) {
+    self->bounce_pool =
+        gst_vspmfilter_buffer_pool_new (GST_ELEMENT (self), FALSE);
+    caps = gst_video_info_to_caps (&self->in_info);
+    config = gst_buffer_pool_get_config (self->bounce_pool);
+    gst_buffer_pool_config_set_params (config, caps,
+        GST_VIDEO_INFO_SIZE (&self->in_info), 0, 0);
+    gst_caps_unref (caps);
+    if (!gst_buffer_pool_set_config (self->bounce_pool, config) ||
+        !gst_buffer_pool_set_active (self->bounce_pool, TRUE)) {
+      GST_WARNING_OBJECT (self, "failed to set up the bounce pool");
+      gst_vspm_multiscale_bounce_clear (self);
+      return FALSE;
+    }
+  }
+
+  if (gst_buffer_pool_acquire_buffer (self->bounce_pool, &buf, NULL) !=
+      GST_FLOW_OK)
+    return FALSE;
+  if (!gst_video_frame_map (bounce, &self->in_info, buf, GST_MAP_READWRITE)) {
+    gst_buffer_unref (buf);
+    return FALSE;
+  }
+  /* the frame holds its own reference */
+  gst_buffer_unref (buf);
+
+  if (!gst_video_frame_copy (bounce, in_frame))
+    goto error;
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (bounce); i++) {
+    addr[i] = gst_vspm_frame_plane_address (self->mmngr_fd, bounce, i);
+    if (!addr[i])
+      goto error;
+  }
+
+  GST_LOG_OBJECT (self, "input staged in bounce buffer %p", bounce->buffer);
+
+  return TRUE;
+
+error:
+  gst_video_frame_unmap (bounce);
+  return FALSE;
+}
+
+static GstFlowReturn
+gst_vspm_multiscale_chain (GstPad * sinkpad, GstObject * parent,
+    GstBuffer * inbuf)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (parent);
+  GstVideoFrame in_frame, bounce;
+  GstVideoFrame *src_frame = &in_frame;
+  void *src_addr[3] = { 0 };
+  GstFlowReturn ret;
+  GList *pads, *l;
+  guint i;
+
+  if (!self->have_info) {
+    gst_buffer_unref (inbuf);
+    return GST_FLOW_NOT_NEGOTIATED;
+  }
+
+  if (!gst_video_frame_map (&in_frame, &self->in_info, inbuf, GST_MAP_READ)) {
+    gst_buffer_unref (inbuf);
+    return GST_FLOW_ERROR;
+  }
+
+  for (i = 0; i < GST_VIDEO_FRAME_N_PLANES (&in_frame); i++) {
+    src_addr[i] = gst_vspm_frame_plane_address (self->mmngr_fd, &in_frame, i);
+    if (!src_addr[i])
+      break;
+  }
+
+  /* memory the VSP can not address is copied to a buffer it can */
+  if (i < GST_VIDEO_FRAME_N_PLANES (&in_frame)) {
+    if (!gst_vspm_multiscale_bounce_in (self, &in_frame, &bounce, src_addr)) {
+      GST_ELEMENT_ERROR (self, RESOURCE, FAILED,
+          ("Could not stage the input in memory the VSP can address"),
+          (NULL));
+      gst_video_frame_unmap (&in_frame);
+      gst_buffer_unref (inbuf);
+      return GST_FLOW_ERROR;
+    }
+    src_frame = &bounce;
+  }
+
+  pads = gst_vspm_multiscale_get_src_pads (self);
+
+  /* The input was translated once, queue all the jobs back to back */
+  for (l = pads; l; l = l->next) {
+    GstVspmMultiscalePad *pad = l->data;
+
+    pad->queued = FALSE;
+    if (gst_pad_check_reconfigure (GST_PAD (pad)) || !pad->negotiated) {
+      if (!gst_vspm_multiscale_negotiate_pad (self, pad)) {
+        pad->flow = GST_FLOW_NOT_NEGOTIATED;
+        continue;
+      }
+    }
+    pad->flow = gst_vspm_multiscale_queue_job (self, pad, src_frame, src_addr);
+  }
+
+  for (l = pads; l; l = l->next) {
+    GstVspmMultiscalePad *pad = l->data;
+
+    if (!pad->queued)
+      continue;
+
+    /* Wait for callback */
+    sem_wait (&pad->smp_wait);
+    gst_video_frame_unmap (&pad->out_frame);
+
+    if (pad->result != 0) {
+      /* one bad frame, as vspmfilter the stream goes on without it */
+      GST_ELEMENT_WARNING (self, STREAM, FAILED, (NULL),
+          ("VSP job of %s failed (%ld), frame dropped", GST_PAD_NAME (pad),
+              pad->result));
+      gst_buffer_unref (pad->outbuf);
+      pad->flow = GST_FLOW_OK;
+    } else {
+      gst_buffer_copy_into (pad->outbuf, inbuf,
+          GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
+      pad->flow = gst_pad_push (GST_PAD (pad), pad->outbuf);
+    }
+    pad->outbuf = NULL;
+  }
+
+  if (src_frame == &bounce)
+    gst_video_frame_unmap (&bounce);
+  gst_video_frame_unmap (&in_frame);
+  gst_buffer_unref (inbuf);
+
+  /* Not linked or not negotiated only when no output is, EOS only when all
+   * are, any other error stops the stream */
+  ret = GST_FLOW_NOT_LINKED;
+  for (l = pads; l; l = l->next) {
+    GstFlowReturn flow = GST_VSPM_MULTISCALE_PAD (l->data)->flow;
+
+    if (flow == GST_FLOW_FLUSHING || flow < GST_FLOW_NOT_NEGOTIATED) {
+      ret = flow;
+      break;
+    }
+    if (flow == GST_FLOW_NOT_NEGOTIATED) {
+      if (ret == GST_FLOW_NOT_LINKED)
+        ret = flow;
+    } else if (flow == GST_FLOW_OK || (flow == GST_FLOW_EOS &&
+            (ret == GST_FLOW_NOT_LINKED || ret == GST_FLOW_NOT_NEGOTIATED))) {
+      ret = flow;
+    }
+  }
+  g_list_free_full (pads, gst_object_unref);
+
+  return ret;
+}
+
+static gboolean
+gst_vspm_multiscale_sink_event (GstPad * pad, GstObject * parent,
+    GstEvent * event)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (parent);
+
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_CAPS:
+    {
+      GstCaps *caps;
+      GstVideoInfo info;
+      GList *pads, *l;
+
+      gst_event_parse_caps (event, &caps);
+      if (!gst_video_info_from_caps (&info, caps) ||
+          gst_vspm_set_colorspace (GST_VIDEO_INFO_FORMAT (&info),
+              &self->in_format, &self->in_swap)) {
+        GST_ERROR_OBJECT (self, "input format is non-support.");
+        gst_event_unref (event);
+        return FALSE;
+      }
+      self->in_info = info;
+      self->have_info = TRUE;
+      gst_vspm_multiscale_bounce_clear (self);
+      gst_event_unref (event);
+
+      /* Every output gets its own caps, in place of the input ones. A
+       * failure is reported by the next chain */
+      pads = gst_vspm_multiscale_get_src_pads (self);
+      for (l = pads; l; l = l->next)
+        gst_vspm_multiscale_negotiate_pad (self, l->data);
+      g_list_free_full (pads, gst_object_unref);
+
+      return TRUE;
+    }
+    default:
+      break;
+  }
+
+  return gst_pad_event_default (pad, parent, event);
+}
+
+static gboolean
+gst_vspm_multiscale_query_caps (GstPad * pad, GstQuery * query)
+{
+  GstCaps *filter, *caps;
+
+  gst_query_parse_caps (query, &filter);
+  caps = gst_pad_get_pad_template_caps (pad);
+  if (filter) {
+    GstCaps *tmp = caps;
+
+    caps = gst_caps_intersect_full (filter, tmp, GST_CAPS_INTERSECT_FIRST);
+    gst_caps_unref (tmp);
+  }
+  gst_query_set_caps_result (query, caps);
+  gst_caps_unref (caps);
+
+  return TRUE;
+}
+
+/* Offer upstream a pool of mmngr buffers, whose hardware addresses are
+ * known without any translation */
+static gboolean
+gst_vspm_multiscale_propose_allocation (GstVspmMultiscale * self,
+    GstQuery * query)
+{
+  GstBufferPool *pool;
+  GstStructure *config;
+  GstCaps *caps;
+  GstVideoInfo info;
+  gboolean need_pool;
+  guint size;
+
+  gst_query_parse_allocation (query, &caps, &need_pool);
+  if (caps == NULL || !gst_video_info_from_caps (&info, caps))
+    return FALSE;
+
+  gst_query_add_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+
+  if (!need_pool)
+    return TRUE;
+
+  pool = gst_vspmfilter_buffer_pool_new (GST_ELEMENT (self), FALSE);
+  config = gst_buffer_pool_get_config (pool);
+  gst_buffer_pool_config_set_params (config, caps, info.size,
+      MIN_OUTPUT_BUFFERS, 0);
+  gst_buffer_pool_config_add_option (config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+  if (!gst_buffer_pool_set_config (pool, config)) {
+    GST_WARNING_OBJECT (self, "failed to set input pool configuration");
+    gst_object_unref (pool);
+    return TRUE;
+  }
+
+  size = GST_VSPMFILTER_BUFFER_POOL_CAST (pool)->buf_info.outbuf_size;
+  gst_query_add_allocation_pool (query, pool, size, MIN_OUTPUT_BUFFERS, 0);
+  gst_object_unref (pool);
+
+  return TRUE;
+}
+
+static gboolean
+gst_vspm_multiscale_sink_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (parent);
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:
+      /* any input can be scaled to what the outputs want */
+      return gst_vspm_multiscale_query_caps (pad, query);
+    case GST_QUERY_ALLOCATION:
+      return gst_vspm_multiscale_propose_allocation (self, query);
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+static gboolean
+gst_vspm_multiscale_src_query (GstPad * pad, GstObject * parent,
+    GstQuery * query)
+{
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_CAPS:
+      return gst_vspm_multiscale_query_caps (pad, query);
+    default:
+      return gst_pad_query_default (pad, parent, query);
+  }
+}
+
+/* Bring a new output up to date with the stream, with caps of its own */
+static gboolean
+gst_vspm_multiscale_forward_sticky (GstPad * pad, GstEvent ** event,
+    gpointer user_data)
+{
+  GstVspmMultiscalePad *srcpad = user_data;
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (GST_PAD_PARENT (pad));
+
+  if (GST_EVENT_TYPE (*event) == GST_EVENT_CAPS)
+    gst_vspm_multiscale_negotiate_pad (self, srcpad);
+  else
+    gst_pad_store_sticky_event (GST_PAD (srcpad), *event);
+
+  return TRUE;
+}
+
+static GstPad *
+gst_vspm_multiscale_request_new_pad (GstElement * element,
+    GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (element);
+  GstPad *srcpad;
+  gchar *pad_name;
+  guint index;
+
+  /* unnamed pads are numbered after any the application named */
+  GST_OBJECT_LOCK (self);
+  if (name && sscanf (name, "src_%u", &index) == 1) {
+    pad_name = g_strdup (name);
+    self->pad_count = MAX (self->pad_count, index + 1);
+  } else {
+    pad_name = g_strdup_printf ("src_%u", self->pad_count);
+    self->pad_count++;
+  }
+  GST_OBJECT_UNLOCK (self);
+
+  srcpad = g_object_new (GST_TYPE_VSPM_MULTISCALE_PAD, "name", pad_name,
+      "direction", GST_PAD_SRC, "template", templ, NULL);
+  g_free (pad_name);
+
+  gst_pad_set_query_function (srcpad,
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_src_query));
+
+  if (!gst_element_add_pad (element, srcpad)) {
+    gst_object_unref (srcpad);
+    return NULL;
+  }
+
+  gst_pad_sticky_events_foreach (self->sinkpad,
+      gst_vspm_multiscale_forward_sticky, srcpad);
+
+  return srcpad;
+}
+
+static void
+gst_vspm_multiscale_release_pad (GstElement * element, GstPad * pad)
+{
+  gst_element_remove_pad (element, pad);
+}
+
+static GstStateChangeReturn
+gst_vspm_multiscale_change_state (GstElement * element,
+    GstStateChange transition)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (element);
+  GstStateChangeReturn ret;
+  GList *pads, *l;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      if (!gst_vspm_session_acquire (&self->vspm_handle, &self->mmngr_fd)) {
+        GST_ELEMENT_ERROR (self, RESOURCE, OPEN_READ_WRITE,
+            ("Could not open the VSPM driver"), (NULL));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      self->is_init_vspm = TRUE;
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      self->have_info = FALSE;
+      gst_vspm_multiscale_bounce_clear (self);
+      pads = gst_vspm_multiscale_get_src_pads (self);
+      for (l = pads; l; l = l->next) {
+        GstVspmMultiscalePad *pad = l->data;
+
+        pad->negotiated = FALSE;
+        if (pad->pool) {
+          gst_buffer_pool_set_active (pad->pool, FALSE);
+          gst_object_unref (pad->pool);
+          pad->pool = NULL;
+        }
+      }
+      g_list_free_full (pads, gst_object_unref);
+
+      if (self->is_init_vspm) {
+        gst_vspm_session_release ();
+        self->is_init_vspm = FALSE;
+        self->mmngr_fd = -1;
+      }
+      break;
+    default:
+      break;
+  }
+
+  return ret;
+}
+
+static void
+gst_vspm_multiscale_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (object);
+
+  switch (prop_id) {
+    case PROP_VSP_CHANNEL:
+      self->vsp_channel = g_value_get_int (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vspm_multiscale_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstVspmMultiscale *self = GST_VSPM_MULTISCALE (object);
+
+  switch (prop_id) {
+    case PROP_VSP_CHANNEL:
+      g_value_set_int (value, self->vsp_channel);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_vspm_multiscale_class_init (GstVspmMultiscaleClass * klass)
+{
+  GObjectClass *gobject_class = (GObjectClass *) klass;
+  GstElementClass *gstelement_class = (GstElementClass *) klass;
+  GstCaps *caps;
+
+  GST_DEBUG_CATEGORY_INIT (vspmmultiscale_debug, "vspmmultiscale", 0,
+      "One to many Video Size Converter with VSPM");
+
+  gobject_class->set_property = gst_vspm_multiscale_set_property;
+  gobject_class->get_property = gst_vspm_multiscale_get_property;
+
+  g_object_class_install_property (gobject_class, PROP_VSP_CHANNEL,
+      g_param_spec_int ("vsp-channel", "VSP channel",
+        "VSP channel to run the jobs on "
+        "(-1 = the one with the fewest jobs in flight)",
+        -1, MAX_DEVICES - 1, DEFAULT_VSP_CHANNEL,
+        G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+        G_PARAM_STATIC_STRINGS));
+
+  caps = gst_vspm_caps_new (FALSE);
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_pad_template_new ("sink", GST_PAD_SINK, GST_PAD_ALWAYS, caps));
+  gst_caps_unref (caps);
+
+  caps = gst_vspm_caps_new (TRUE);
+  gst_element_class_add_pad_template (gstelement_class,
+      gst_pad_template_new ("src_%u", GST_PAD_SRC, GST_PAD_REQUEST, caps));
+  gst_caps_unref (caps);
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "Multi-output Video Size Converter with VSPM",
+      "Filter/Converter/Video",
+      "Converts one video to several colorspaces and sizes at once",
+      "Renesas Corporation");
+
+  gstelement_class->request_new_pad =
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_request_new_pad);
+  gstelement_class->release_pad =
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_release_pad);
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_change_state);
+}
+
+static void
+gst_vspm_multiscale_init (GstVspmMultiscale * self)
+{
+  GstPadTemplate *templ;
+
+  templ = gst_element_class_get_pad_template (GST_ELEMENT_GET_CLASS (self),
+      "sink");
+  self->sinkpad = gst_pad_new_from_template (templ, "sink");
+  gst_pad_set_chain_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_chain));
+  gst_pad_set_event_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_sink_event));
+  gst_pad_set_query_function (self->sinkpad,
+      GST_DEBUG_FUNCPTR (gst_vspm_multiscale_sink_query));
+  gst_element_add_pad (GST_ELEMENT (self), self->sinkpad);
+
+  gst_video_info_init (&self->in_info);
+  self->have_info = FALSE;
+  self->mmngr_fd = -1;
+  self->is_init_vspm = FALSE;
+  self->pad_count = 0;
+  self->vsp_channel = DEFAULT_VSP_CHANNEL;
+}
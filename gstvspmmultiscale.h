@@ -0,0 +1,114 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_VSPM_MULTISCALE_H__
+#define __GST_VSPM_MULTISCALE_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+#include <semaphore.h>
+
+#include "gstvspmfilter.h"
+
+G_BEGIN_DECLS
+
+#define GST_TYPE_VSPM_MULTISCALE_PAD          (gst_vspm_multiscale_pad_get_type())
+#define GST_VSPM_MULTISCALE_PAD(obj)          (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VSPM_MULTISCALE_PAD,GstVspmMultiscalePad))
+#define GST_IS_VSPM_MULTISCALE_PAD(obj)       (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VSPM_MULTISCALE_PAD))
+
+#define GST_TYPE_VSPM_MULTISCALE              (gst_vspm_multiscale_get_type())
+#define GST_VSPM_MULTISCALE(obj)              (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_VSPM_MULTISCALE,GstVspmMultiscale))
+#define GST_VSPM_MULTISCALE_CLASS(klass)      (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_VSPM_MULTISCALE,GstVspmMultiscaleClass))
+#define GST_IS_VSPM_MULTISCALE(obj)           (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_VSPM_MULTISCALE))
+
+typedef struct _GstVspmMultiscale GstVspmMultiscale;
+typedef struct _GstVspmMultiscaleClass GstVspmMultiscaleClass;
+typedef struct _GstVspmMultiscalePad GstVspmMultiscalePad;
+typedef struct _GstVspmMultiscalePadClass GstVspmMultiscalePadClass;
+
+/* One output of the element, with the VSPM job writing to it. The job
+ * parameters live here as they must stay valid until cb_func */
+struct _GstVspmMultiscalePad
+{
+  GstPad parent;
+
+  GstVideoInfo info;
+  gboolean negotiated;
+  GstBufferPool *pool;
+  guint vsp_format;
+  guint vsp_swap;
+
+  /* current job */
+  GstBuffer *outbuf;
+  GstVideoFrame out_frame;
+  GstFlowReturn flow;
+  gboolean queued;
+  long result;
+  gint channel;
+  sem_t smp_wait;
+
+  VSPM_IP_PAR vspm_ip;
+  VSPM_VSP_PAR vsp_par;
+  T_VSP_IN src_par;
+  T_VSP_ALPHA src_alpha_par;
+  T_VSP_OUT dst_par;
+  T_VSP_CTRL ctrl_par;
+  T_VSP_UDS uds_par;
+};
+
+struct _GstVspmMultiscalePadClass
+{
+  GstPadClass parent_class;
+};
+
+/**
+ * GstVspmMultiscale:
+ *
+ * Opaque object data structure.
+ */
+struct _GstVspmMultiscale
+{
+  GstElement element;
+
+  GstPad *sinkpad;
+  GstVideoInfo in_info;
+  gboolean have_info;
+  guint in_format;
+  guint in_swap;
+  GstBufferPool *bounce_pool;   /* input the VSP can not address */
+
+  unsigned long vspm_handle;
+  gboolean is_init_vspm;
+  int mmngr_fd;   /* mmngr open id */
+  guint pad_count;
+  gint vsp_channel;
+};
+
+struct _GstVspmMultiscaleClass
+{
+  GstElementClass parent_class;
+};
+
+GType gst_vspm_multiscale_pad_get_type (void);
+GType gst_vspm_multiscale_get_type (void);
+
+G_END_DECLS
+
+#endif /* __GST_VSPM_MULTISCALE_H__ */
@@ -0,0 +1,131 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The software path runs GstVideoConverter, whose line kernels are Orc
+ * programs compiled at run time to NEON on aarch64 and SSE/AVX on x86.
+ * The lines of a frame are shared out between one thread per CPU. The
+ * scaler is the bilinear one, as the UDS of the VSP */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstvspmsoftware.h"
+
+#include <string.h>
+
+GST_DEBUG_CATEGORY_EXTERN (vspmfilter_debug);
+#define GST_CAT_DEFAULT vspmfilter_debug
+
+struct _GstVspmSoftware
+{
+  GstVideoConverter *convert;
+  GstVideoInfo in_info, out_info;
+  gint rect[8];                 /* source, then destination x, y, w, h */
+  guint border_argb;
+};
+
+GstVspmSoftware *
+gst_vspm_software_new (void)
+{
+  return g_new0 (GstVspmSoftware, 1);
+}
+
+void
+gst_vspm_software_free (GstVspmSoftware * sw)
+{
+  if (sw == NULL)
+    return;
+  if (sw->convert)
+    gst_video_converter_free (sw->convert);
+  g_free (sw);
+}
+
+/* The converter is kept as long as the caps, the rectangles and the
+ * border colour stay the same */
+static gboolean
+gst_vspm_software_setup (GstVspmSoftware * sw, GstVideoInfo * in_info,
+    GstVideoInfo * out_info, gint rect[8], guint border_argb)
+{
+  GstStructure *config;
+
+  if (sw->convert && gst_video_info_is_equal (&sw->in_info, in_info) &&
+      gst_video_info_is_equal (&sw->out_info, out_info) &&
+      memcmp (sw->rect, rect, sizeof (sw->rect)) == 0 &&
+      sw->border_argb == border_argb)
+    return TRUE;
+
+  if (sw->convert)
+    gst_video_converter_free (sw->convert);
+
+  config = gst_structure_new ("GstVspmSoftware",
+      GST_VIDEO_CONVERTER_OPT_SRC_X, G_TYPE_INT, rect[0],
+      GST_VIDEO_CONVERTER_OPT_SRC_Y, G_TYPE_INT, rect[1],
+      GST_VIDEO_CONVERTER_OPT_SRC_WIDTH, G_TYPE_INT, rect[2],
+      GST_VIDEO_CONVERTER_OPT_SRC_HEIGHT, G_TYPE_INT, rect[3],
+      GST_VIDEO_CONVERTER_OPT_DEST_X, G_TYPE_INT, rect[4],
+      GST_VIDEO_CONVERTER_OPT_DEST_Y, G_TYPE_INT, rect[5],
+      GST_VIDEO_CONVERTER_OPT_DEST_WIDTH, G_TYPE_INT, rect[6],
+      GST_VIDEO_CONVERTER_OPT_DEST_HEIGHT, G_TYPE_INT, rect[7],
+      GST_VIDEO_CONVERTER_OPT_FILL_BORDER, G_TYPE_BOOLEAN, TRUE,
+      GST_VIDEO_CONVERTER_OPT_BORDER_ARGB, G_TYPE_UINT, border_argb,
+      GST_VIDEO_CONVERTER_OPT_RESAMPLER_METHOD,
+      GST_TYPE_VIDEO_RESAMPLER_METHOD, GST_VIDEO_RESAMPLER_METHOD_LINEAR,
+      GST_VIDEO_CONVERTER_OPT_THREADS, G_TYPE_UINT, g_get_num_processors (),
+      NULL);
+
+  sw->convert = gst_video_converter_new (in_info, out_info, config);
+  if (sw->convert == NULL) {
+    GST_WARNING ("no software conversion from %s to %s",
+        GST_VIDEO_INFO_NAME (in_info), GST_VIDEO_INFO_NAME (out_info));
+    return FALSE;
+  }
+
+  sw->in_info = *in_info;
+  sw->out_info = *out_info;
+  memcpy (sw->rect, rect, sizeof (sw->rect));
+  sw->border_argb = border_argb;
+
+  GST_DEBUG ("software conversion %s %dx%d -> %s %dx%d",
+      GST_VIDEO_INFO_NAME (in_info), rect[2], rect[3],
+      GST_VIDEO_INFO_NAME (out_info), rect[6], rect[7]);
+
+  return TRUE;
+}
+
+/* Convert the in_x, in_y, in_width x in_height area of in_frame to the
+ * dst_* area of out_frame, filling the rest of out_frame with border_argb */
+gboolean
+gst_vspm_software_convert (GstVspmSoftware * sw, GstVideoFrame * in_frame,
+    GstVideoFrame * out_frame, gint in_x, gint in_y, gint in_width,
+    gint in_height, gint dst_x, gint dst_y, gint dst_width, gint dst_height,
+    guint border_argb)
+{
+  gint rect[8] = { in_x, in_y, in_width, in_height,
+    dst_x, dst_y, dst_width, dst_height
+  };
+
+  if (!gst_vspm_software_setup (sw, &in_frame->info, &out_frame->info, rect,
+          border_argb))
+    return FALSE;
+
+  gst_video_converter_frame (sw->convert, in_frame, out_frame);
+
+  return TRUE;
+}
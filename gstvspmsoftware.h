@@ -0,0 +1,42 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_VSPM_SOFTWARE_H__
+#define __GST_VSPM_SOFTWARE_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+G_BEGIN_DECLS
+
+/* CPU conversion of the frames the VSP can not handle. Only built with
+ * HAVE_VSPM_SOFTWARE */
+typedef struct _GstVspmSoftware GstVspmSoftware;
+
+GstVspmSoftware *gst_vspm_software_new (void);
+void gst_vspm_software_free (GstVspmSoftware * sw);
+gboolean gst_vspm_software_convert (GstVspmSoftware * sw,
+    GstVideoFrame * in_frame, GstVideoFrame * out_frame,
+    gint in_x, gint in_y, gint in_width, gint in_height,
+    gint dst_x, gint dst_y, gint dst_width, gint dst_height,
+    guint border_argb);
+
+G_END_DECLS
+
+#endif /* __GST_VSPM_SOFTWARE_H__ */
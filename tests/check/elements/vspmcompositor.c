@@ -0,0 +1,195 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* vspmcompositor against the VSPM emulation, "make check" */
+
+#include <gst/check/gstcheck.h>
+
+#include "vspmref.h"
+
+#define OUT_CAPS "video/x-raw,format=BGRA,width=64,height=48"
+/* videotestsrc draws into the mmngr pool the sink pads propose */
+#define LAYER(color, w, h) \
+    "videotestsrc num-buffers=1 pattern=solid-color foreground-color=" \
+    color " ! video/x-raw,format=BGRA,width=" w ",height=" h \
+    ",framerate=30/1 ! c. "
+
+/* Run the pipeline to EOS and map the last frame out of it */
+static GstSample *
+run_pipeline (const gchar * launch, GstVideoFrame * frame)
+{
+  GstElement *pipeline, *sink;
+  GstMessage *msg;
+  GstSample *sample = NULL;
+  GstVideoInfo info;
+  GError *error = NULL;
+
+  pipeline = gst_parse_launch (launch, &error);
+  fail_unless (pipeline != NULL, "%s", error ? error->message : "");
+
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  msg = gst_bus_timed_pop_filtered (GST_ELEMENT_BUS (pipeline),
+      GST_CLOCK_TIME_NONE, GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "s");
+  g_object_get (sink, "last-sample", &sample, NULL);
+  gst_object_unref (sink);
+  fail_unless (sample != NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  fail_unless (gst_video_info_from_caps (&info,
+          gst_sample_get_caps (sample)));
+  fail_unless (gst_video_frame_map (frame, &info,
+          gst_sample_get_buffer (sample), GST_MAP_READ));
+
+  return sample;
+}
+
+/* A layer placed over the background */
+GST_START_TEST (test_layer)
+{
+  GstVideoFrame frame;
+  GstSample *sample;
+
+  sample = run_pipeline ("vspmcompositor name=c background=0xff0000ff "
+      "sink_0::xpos=16 sink_0::ypos=8 ! " OUT_CAPS " ! "
+      "fakesink name=s sync=false " LAYER ("0xffff0000", "32", "24"),
+      &frame);
+
+  vspm_ref_check_solid (&frame, 16, 8, 32, 24, 0x00, 0x00, 0xff);
+  vspm_ref_check_solid (&frame, 0, 0, 64, 8, 0xff, 0x00, 0x00);
+  vspm_ref_check_solid (&frame, 0, 32, 64, 16, 0xff, 0x00, 0x00);
+  vspm_ref_check_solid (&frame, 0, 8, 16, 24, 0xff, 0x00, 0x00);
+  vspm_ref_check_solid (&frame, 48, 8, 16, 24, 0xff, 0x00, 0x00);
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+}
+
+GST_END_TEST;
+
+/* Two layers, the second one scaled by the UDS of its RPF and on top */
+GST_START_TEST (test_two_layers)
+{
+  GstVideoFrame frame;
+  GstSample *sample;
+
+  sample = run_pipeline ("vspmcompositor name=c background=0xff000000 "
+      "sink_0::xpos=0 sink_0::ypos=0 "
+      "sink_1::xpos=32 sink_1::ypos=24 sink_1::width=32 sink_1::height=24 ! "
+      OUT_CAPS " ! fakesink name=s sync=false "
+      LAYER ("0xff00ff00", "64", "48") LAYER ("0xffffffff", "16", "12"),
+      &frame);
+
+  vspm_ref_check_solid (&frame, 0, 0, 64, 24, 0x00, 0xff, 0x00);
+  vspm_ref_check_solid (&frame, 0, 24, 32, 24, 0x00, 0xff, 0x00);
+  vspm_ref_check_solid (&frame, 32, 24, 32, 24, 0xff, 0xff, 0xff);
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+}
+
+GST_END_TEST;
+
+/* A layer with half transparent pixels, and an opaque one blended at
+ * half the alpha of its pad */
+GST_START_TEST (test_alpha)
+{
+  GstVideoFrame frame;
+  GstSample *sample;
+
+  sample = run_pipeline ("vspmcompositor name=c background=0xff0000ff "
+      "sink_1::xpos=32 sink_1::ypos=24 sink_1::alpha=0.5 ! " OUT_CAPS " ! "
+      "fakesink name=s sync=false "
+      LAYER ("0x80ff0000", "32", "24") LAYER ("0xffffffff", "32", "24"),
+      &frame);
+
+  vspm_ref_check_solid (&frame, 0, 0, 32, 24, 0x7f, 0x00, 0x80);
+  vspm_ref_check_solid (&frame, 32, 24, 32, 24, 0xff, 0x7f, 0x7f);
+  vspm_ref_check_solid (&frame, 32, 0, 32, 24, 0xff, 0x00, 0x00);
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+}
+
+GST_END_TEST;
+
+/* A layer in system memory, which is copied to a bounce buffer */
+GST_START_TEST (test_bounce)
+{
+  GstVideoFrame frame;
+  GstSample *sample;
+
+  sample = run_pipeline ("vspmcompositor name=c background=0xff0000ff "
+      "sink_0::xpos=16 sink_0::ypos=8 ! " OUT_CAPS " ! "
+      "fakesink name=s sync=false "
+      "videotestsrc num-buffers=1 pattern=solid-color "
+      "foreground-color=0xffff0000 ! video/x-raw,format=BGRA,width=32,"
+      "height=24,framerate=30/1 ! identity drop-allocation=true ! c. ",
+      &frame);
+
+  vspm_ref_check_solid (&frame, 16, 8, 32, 24, 0x00, 0x00, 0xff);
+  vspm_ref_check_solid (&frame, 0, 0, 64, 8, 0xff, 0x00, 0x00);
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+}
+
+GST_END_TEST;
+
+/* No layer to blend: the output is the background alone */
+GST_START_TEST (test_background)
+{
+  GstVideoFrame frame;
+  GstSample *sample;
+
+  sample = run_pipeline ("vspmcompositor name=c background=0xff00ff00 "
+      "sink_0::alpha=0.0 ! " OUT_CAPS " ! fakesink name=s sync=false "
+      LAYER ("0xffff0000", "64", "48"), &frame);
+
+  vspm_ref_check_solid (&frame, 0, 0, 64, 48, 0x00, 0xff, 0x00);
+
+  gst_video_frame_unmap (&frame);
+  gst_sample_unref (sample);
+}
+
+GST_END_TEST;
+
+static Suite *
+vspmcompositor_suite (void)
+{
+  Suite *s = suite_create ("vspmcompositor");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_layer);
+  tcase_add_test (tc_chain, test_two_layers);
+  tcase_add_test (tc_chain, test_alpha);
+  tcase_add_test (tc_chain, test_bounce);
+  tcase_add_test (tc_chain, test_background);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vspmcompositor);
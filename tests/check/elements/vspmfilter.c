@@ -0,0 +1,377 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* vspmfilter against the VSPM emulation, "make check". The output frames
+ * are compared with what the VSP computes for them. software-fallback is
+ * off, a conversion the VSP can not do fails instead of running on the
+ * CPU. The input buffers come from the mmngr pool vspmfilter proposes and
+ * with outbuf-alloc it writes to its own, so no frame is bounced */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#include "vspmref.h"
+
+#define CAPS_FMT "video/x-raw,format=BGRA,width=%d,height=%d,framerate=30/1"
+
+typedef struct {
+  GstHarness *h;
+  GstVideoInfo in_info, out_info;
+  GstBuffer *inbuf, *outbuf;
+  GstVideoFrame in, out;
+} Conversion;
+
+static void
+conversion_setup (Conversion * conv, const gchar * props, gint in_w,
+    gint in_h, gint out_w, gint out_h)
+{
+  gchar *launch, *caps;
+
+  launch = g_strdup_printf ("vspmfilter software-fallback=false "
+      "outbuf-alloc=true %s", props);
+  conv->h = gst_harness_new_parse (launch);
+  g_free (launch);
+
+  gst_video_info_set_format (&conv->in_info, GST_VIDEO_FORMAT_BGRA, in_w,
+      in_h);
+  gst_video_info_set_format (&conv->out_info, GST_VIDEO_FORMAT_BGRA, out_w,
+      out_h);
+
+  /* the output caps first, the input ones negotiate the element */
+  caps = g_strdup_printf (CAPS_FMT, out_w, out_h);
+  gst_harness_set_sink_caps_str (conv->h, caps);
+  g_free (caps);
+  caps = g_strdup_printf (CAPS_FMT, in_w, in_h);
+  gst_harness_set_src_caps_str (conv->h, caps);
+  g_free (caps);
+
+  conv->outbuf = NULL;
+  /* from the mmngr pool vspmfilter proposed to the harness */
+  conv->inbuf = gst_harness_create_buffer (conv->h, conv->in_info.size);
+  fail_unless (gst_video_frame_map (&conv->in, &conv->in_info, conv->inbuf,
+          GST_MAP_READWRITE));
+}
+
+/* Push the input frame, keeping it mapped for the checks */
+static void
+conversion_run (Conversion * conv)
+{
+  conv->outbuf = gst_harness_push_and_pull (conv->h,
+      gst_buffer_ref (conv->inbuf));
+  fail_unless (conv->outbuf != NULL);
+  fail_unless (gst_video_frame_map (&conv->out, &conv->out_info,
+          conv->outbuf, GST_MAP_READ));
+}
+
+static guint64
+conversion_stat (Conversion * conv, const gchar * field)
+{
+  GstElement *filter;
+  GstStructure *stats;
+  guint64 v = 0;
+
+  filter = gst_harness_find_element (conv->h, "vspmfilter");
+  g_object_get (filter, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, field, &v));
+  gst_structure_free (stats);
+  gst_object_unref (filter);
+
+  return v;
+}
+
+static void
+conversion_teardown (Conversion * conv)
+{
+  /* the VSP did it all, on the pool buffers */
+  fail_unless_equals_uint64 (conversion_stat (conv, "software-count"), 0);
+  fail_unless_equals_uint64 (conversion_stat (conv, "skipped"), 0);
+  fail_unless_equals_uint64 (conversion_stat (conv, "bounce-count"), 0);
+
+  if (conv->outbuf) {
+    gst_video_frame_unmap (&conv->out);
+    gst_buffer_unref (conv->outbuf);
+  }
+  gst_video_frame_unmap (&conv->in);
+  gst_buffer_unref (conv->inbuf);
+  gst_harness_teardown (conv->h);
+}
+
+GST_START_TEST (test_scale)
+{
+  Conversion conv;
+
+  conversion_setup (&conv, "", 320, 240, 200, 150);
+  vspm_ref_fill (&conv.in);
+  conversion_run (&conv);
+
+  vspm_ref_check_scaled (&conv.in, 0, 0, 320, 240, &conv.out);
+  fail_unless_equals_uint64 (conversion_stat (&conv, "job-count"), 1);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crop)
+{
+  Conversion conv;
+
+  conversion_setup (&conv,
+      "crop-left=16 crop-right=8 crop-top=4 crop-bottom=12", 64, 48, 40, 32);
+  vspm_ref_fill (&conv.in);
+  conversion_run (&conv);
+
+  vspm_ref_check_scaled (&conv.in, 16, 4, 40, 32, &conv.out);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crop_scale)
+{
+  Conversion conv;
+
+  conversion_setup (&conv, "crop-left=32 crop-top=16", 160, 120, 64, 52);
+  vspm_ref_fill (&conv.in);
+  conversion_run (&conv);
+
+  vspm_ref_check_scaled (&conv.in, 32, 16, 128, 104, &conv.out);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_borders)
+{
+  Conversion conv;
+
+  /* 4:3 into 8:3, pillarboxed: 32 picture columns in the middle */
+  conversion_setup (&conv, "add-borders=true border-color=0xff00ff00",
+      64, 48, 64, 24);
+  vspm_ref_fill_solid (&conv.in, 0x20, 0x40, 0xc0);
+  conversion_run (&conv);
+
+  vspm_ref_check_solid (&conv.out, 0, 0, 16, 24, 0x00, 0xff, 0x00);
+  vspm_ref_check_solid (&conv.out, 16, 0, 32, 24, 0x20, 0x40, 0xc0);
+  vspm_ref_check_solid (&conv.out, 48, 0, 16, 24, 0x00, 0xff, 0x00);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+/* Wider than the 2048 columns of one UDS pass: two stripes, whose seam
+ * must not show */
+GST_START_TEST (test_stripes)
+{
+  Conversion conv;
+
+  conversion_setup (&conv, "", 3072, 16, 2048, 12);
+  vspm_ref_fill (&conv.in);
+  conversion_run (&conv);
+
+  vspm_ref_check_scaled (&conv.in, 0, 0, 3072, 16, &conv.out);
+  fail_unless_equals_uint64 (conversion_stat (&conv, "job-count"), 1);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+/* split-frame against a single pass of the same frame: the stripes, one
+ * per VSP, must sample the input at the same positions */
+static void
+check_split_frame (gint in_w, gint in_h, gint out_w, gint out_h)
+{
+  Conversion single, split;
+  gint y;
+
+  conversion_setup (&single, "", in_w, in_h, out_w, out_h);
+  conversion_setup (&split, "split-frame=true", in_w, in_h, out_w, out_h);
+  vspm_ref_fill (&single.in);
+  vspm_ref_fill (&split.in);
+  conversion_run (&single);
+  conversion_run (&split);
+
+  for (y = 0; y < out_h; y++)
+    fail_unless (memcmp (vspm_ref_pixel (&single.out, 0, y),
+            vspm_ref_pixel (&split.out, 0, y), out_w * 4) == 0,
+        "line %d of %dx%d -> %dx%d differs when split", y, in_w, in_h,
+        out_w, out_h);
+  vspm_ref_check_scaled (&split.in, 0, 0, in_w, in_h, &split.out);
+
+  conversion_teardown (&split);
+  conversion_teardown (&single);
+}
+
+GST_START_TEST (test_split_frame)
+{
+  check_split_frame (1920, 32, 1280, 24);
+  check_split_frame (1920, 32, 1366, 20);
+  check_split_frame (720, 16, 1920, 40);
+  check_split_frame (3072, 16, 2048, 12);
+}
+
+GST_END_TEST;
+
+/* 32x down is beyond one UDS pass, it takes two */
+GST_START_TEST (test_passes)
+{
+  Conversion conv;
+
+  conversion_setup (&conv, "", 1024, 256, 32, 8);
+  vspm_ref_fill_solid (&conv.in, 0x10, 0x80, 0xf0);
+  conversion_run (&conv);
+
+  vspm_ref_check_solid (&conv.out, 0, 0, 32, 8, 0x10, 0x80, 0xf0);
+  fail_unless (conversion_stat (&conv, "passes-count") > 0);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+/* Both frames in mmngr pools: converted by transform_buffer without being
+ * mapped, from the addresses the pools know */
+GST_START_TEST (test_zero_copy)
+{
+  Conversion conv;
+
+  conversion_setup (&conv, "", 64, 48, 32, 24);
+  vspm_ref_fill (&conv.in);
+  conversion_run (&conv);
+
+  vspm_ref_check_scaled (&conv.in, 0, 0, 64, 48, &conv.out);
+  fail_unless (conversion_stat (&conv, "zero-copy") > 0);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+/* With several jobs in flight the frames still leave in order, and the
+ * ones queued at EOS are pushed before it */
+GST_START_TEST (test_inflight)
+{
+  Conversion conv;
+  GstVideoFrame frame;
+  GstBuffer *buf;
+  gint i;
+
+  conversion_setup (&conv, "max-inflight=3", 64, 48, 32, 24);
+
+  for (i = 0; i < 5; i++) {
+    buf = gst_harness_create_buffer (conv.h, conv.in_info.size);
+    fail_unless (gst_video_frame_map (&frame, &conv.in_info, buf,
+            GST_MAP_WRITE));
+    vspm_ref_fill_solid (&frame, i * 0x20, 0x80, 0xff - i * 0x20);
+    gst_video_frame_unmap (&frame);
+    GST_BUFFER_PTS (buf) = i * GST_SECOND / 30;
+    fail_unless_equals_int (gst_harness_push (conv.h, buf), GST_FLOW_OK);
+  }
+
+  fail_unless (gst_harness_push_event (conv.h, gst_event_new_eos ()));
+  fail_unless_equals_int (gst_harness_buffers_received (conv.h), 5);
+
+  for (i = 0; i < 5; i++) {
+    buf = gst_harness_pull (conv.h);
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (buf), i * GST_SECOND / 30);
+    fail_unless (gst_video_frame_map (&frame, &conv.out_info, buf,
+            GST_MAP_READ));
+    vspm_ref_check_solid (&frame, 0, 0, 32, 24, i * 0x20, 0x80,
+        0xff - i * 0x20);
+    gst_video_frame_unmap (&frame);
+    gst_buffer_unref (buf);
+  }
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+/* New input caps while a job is in flight: the frame of the old caps goes
+ * out before them, the next one is converted at the new size */
+GST_START_TEST (test_caps_change)
+{
+  Conversion conv;
+  GstVideoFrame frame;
+  GstBuffer *buf;
+
+  conversion_setup (&conv, "max-inflight=2", 64, 48, 32, 24);
+  vspm_ref_fill (&conv.in);
+  fail_unless_equals_int (gst_harness_push (conv.h,
+          gst_buffer_ref (conv.inbuf)), GST_FLOW_OK);
+
+  gst_harness_set_src_caps_str (conv.h,
+      "video/x-raw,format=BGRA,width=96,height=64,framerate=30/1");
+  fail_unless_equals_int (gst_harness_buffers_received (conv.h), 1);
+
+  buf = gst_harness_pull (conv.h);
+  fail_unless (gst_video_frame_map (&frame, &conv.out_info, buf,
+          GST_MAP_READ));
+  vspm_ref_check_scaled (&conv.in, 0, 0, 64, 48, &frame);
+  gst_video_frame_unmap (&frame);
+  gst_buffer_unref (buf);
+
+  /* the next frame, at the new size */
+  gst_video_frame_unmap (&conv.in);
+  gst_buffer_unref (conv.inbuf);
+  gst_video_info_set_format (&conv.in_info, GST_VIDEO_FORMAT_BGRA, 96, 64);
+  conv.inbuf = gst_harness_create_buffer (conv.h, conv.in_info.size);
+  fail_unless (gst_video_frame_map (&conv.in, &conv.in_info, conv.inbuf,
+          GST_MAP_READWRITE));
+  vspm_ref_fill (&conv.in);
+  fail_unless_equals_int (gst_harness_push (conv.h,
+          gst_buffer_ref (conv.inbuf)), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (conv.h, gst_event_new_eos ()));
+
+  conv.outbuf = gst_harness_pull (conv.h);
+  fail_unless (gst_video_frame_map (&conv.out, &conv.out_info, conv.outbuf,
+          GST_MAP_READ));
+  vspm_ref_check_scaled (&conv.in, 0, 0, 96, 64, &conv.out);
+
+  conversion_teardown (&conv);
+}
+
+GST_END_TEST;
+
+static Suite *
+vspmfilter_suite (void)
+{
+  Suite *s = suite_create ("vspmfilter");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_scale);
+  tcase_add_test (tc_chain, test_crop);
+  tcase_add_test (tc_chain, test_crop_scale);
+  tcase_add_test (tc_chain, test_borders);
+  tcase_add_test (tc_chain, test_stripes);
+  tcase_add_test (tc_chain, test_split_frame);
+  tcase_add_test (tc_chain, test_passes);
+  tcase_add_test (tc_chain, test_zero_copy);
+  tcase_add_test (tc_chain, test_inflight);
+  tcase_add_test (tc_chain, test_caps_change);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vspmfilter);
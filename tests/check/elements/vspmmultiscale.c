@@ -0,0 +1,212 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* vspmmultiscale against the VSPM emulation, "make check" */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#include "vspmref.h"
+
+#define CAPS_FMT "video/x-raw,format=BGRA,width=%d,height=%d,framerate=30/1"
+
+static void
+set_caps (GstHarness * h, gboolean src, gint width, gint height)
+{
+  gchar *caps = g_strdup_printf (CAPS_FMT, width, height);
+
+  if (src)
+    gst_harness_set_src_caps_str (h, caps);
+  else
+    gst_harness_set_sink_caps_str (h, caps);
+  g_free (caps);
+}
+
+static void
+check_output (GstHarness * h, GstVideoFrame * in, gint width, gint height)
+{
+  GstVideoInfo info;
+  GstVideoFrame out;
+  GstBuffer *buf;
+
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_BGRA, width, height);
+  fail_unless (gst_video_frame_map (&out, &info, buf, GST_MAP_READ));
+  vspm_ref_check_scaled (in, 0, 0, GST_VIDEO_FRAME_WIDTH (in),
+      GST_VIDEO_FRAME_HEIGHT (in), &out);
+  gst_video_frame_unmap (&out);
+  gst_buffer_unref (buf);
+}
+
+/* One input, two sizes out of it */
+GST_START_TEST (test_two_outputs)
+{
+  GstHarness *h, *h2;
+  GstVideoInfo info;
+  GstVideoFrame in;
+  GstBuffer *buf;
+
+  h = gst_harness_new_with_padnames ("vspmmultiscale", "sink", "src_0");
+  h2 = gst_harness_new_with_element (h->element, NULL, "src_1");
+  set_caps (h, FALSE, 160, 120);
+  set_caps (h2, FALSE, 64, 48);
+  set_caps (h, TRUE, 320, 240);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_BGRA, 320, 240);
+  buf = gst_harness_create_buffer (h, info.size);
+  fail_unless (gst_video_frame_map (&in, &info, buf, GST_MAP_READWRITE));
+  vspm_ref_fill (&in);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (buf)),
+      GST_FLOW_OK);
+  check_output (h, &in, 160, 120);
+  check_output (h2, &in, 64, 48);
+
+  gst_video_frame_unmap (&in);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h2);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* System memory, which the VSP can not address: staged through a bounce
+ * buffer instead of being dropped */
+GST_START_TEST (test_bounce)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+  GstVideoFrame in;
+  GstBuffer *buf;
+
+  h = gst_harness_new_with_padnames ("vspmmultiscale", "sink", "src_0");
+  set_caps (h, FALSE, 100, 75);
+  set_caps (h, TRUE, 200, 150);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_BGRA, 200, 150);
+  buf = gst_buffer_new_allocate (NULL, info.size, NULL);
+  fail_unless (gst_video_frame_map (&in, &info, buf, GST_MAP_READWRITE));
+  vspm_ref_fill (&in);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (buf)),
+      GST_FLOW_OK);
+  check_output (h, &in, 100, 75);
+
+  gst_video_frame_unmap (&in);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* 20x down is beyond the UDS ratios, the output is not negotiated */
+GST_START_TEST (test_ratio_out_of_range)
+{
+  GstHarness *h;
+  GstVideoInfo info;
+
+  h = gst_harness_new_with_padnames ("vspmmultiscale", "sink", "src_0");
+  set_caps (h, FALSE, 16, 12);
+  set_caps (h, TRUE, 320, 240);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_BGRA, 320, 240);
+  fail_unless_equals_int (gst_harness_push (h,
+          gst_harness_create_buffer (h, info.size)), GST_FLOW_NOT_NEGOTIATED);
+  fail_unless_equals_int (gst_harness_buffers_received (h), 0);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* An output out of range does not stop the others */
+GST_START_TEST (test_one_output_out_of_range)
+{
+  GstHarness *h, *h2;
+  GstVideoInfo info;
+  GstVideoFrame in;
+  GstBuffer *buf;
+
+  h = gst_harness_new_with_padnames ("vspmmultiscale", "sink", "src_0");
+  h2 = gst_harness_new_with_element (h->element, NULL, "src_1");
+  set_caps (h, FALSE, 160, 120);
+  set_caps (h2, FALSE, 16, 12);
+  set_caps (h, TRUE, 320, 240);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_BGRA, 320, 240);
+  buf = gst_harness_create_buffer (h, info.size);
+  fail_unless (gst_video_frame_map (&in, &info, buf, GST_MAP_READWRITE));
+  vspm_ref_fill (&in);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (buf)),
+      GST_FLOW_OK);
+  check_output (h, &in, 160, 120);
+  fail_unless_equals_int (gst_harness_buffers_received (h2), 0);
+
+  gst_video_frame_unmap (&in);
+  gst_buffer_unref (buf);
+  gst_harness_teardown (h2);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* Pads requested without a name are numbered after the named ones */
+GST_START_TEST (test_pad_names)
+{
+  GstElement *element;
+  GstPad *named, *unnamed;
+
+  element = gst_element_factory_make ("vspmmultiscale", NULL);
+  fail_unless (element != NULL);
+
+  named = gst_element_get_request_pad (element, "src_1");
+  fail_unless (named != NULL);
+  unnamed = gst_element_get_request_pad (element, "src_%u");
+  fail_unless (unnamed != NULL);
+  fail_unless_equals_string (GST_PAD_NAME (unnamed), "src_2");
+
+  gst_element_release_request_pad (element, unnamed);
+  gst_object_unref (unnamed);
+  gst_element_release_request_pad (element, named);
+  gst_object_unref (named);
+  gst_object_unref (element);
+}
+
+GST_END_TEST;
+
+static Suite *
+vspmmultiscale_suite (void)
+{
+  Suite *s = suite_create ("vspmmultiscale");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_two_outputs);
+  tcase_add_test (tc_chain, test_bounce);
+  tcase_add_test (tc_chain, test_ratio_out_of_range);
+  tcase_add_test (tc_chain, test_one_output_out_of_range);
+  tcase_add_test (tc_chain, test_pad_names);
+
+  return s;
+}
+
+GST_CHECK_MAIN (vspmmultiscale);
@@ -0,0 +1,155 @@
+/* GStreamer
+ * Copyright (C) 2026 Renesas Electronics Corporation
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Helpers of the element tests, which run against the VSPM emulation.
+ * The frames are BGRA, so that no colour conversion is involved and the
+ * output can be compared byte for byte with a reference */
+
+#ifndef __VSPM_REF_H__
+#define __VSPM_REF_H__
+
+#include <gst/gst.h>
+#include <gst/video/video.h>
+
+/* Test picture: every pixel different, opaque */
+static inline void
+vspm_ref_fill (GstVideoFrame * frame)
+{
+  gint x, y;
+
+  for (y = 0; y < GST_VIDEO_FRAME_HEIGHT (frame); y++) {
+    guint8 *p = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (frame, 0) +
+        y * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+
+    for (x = 0; x < GST_VIDEO_FRAME_WIDTH (frame); x++, p += 4) {
+      p[0] = (guint8) (x * 7 + y * 3);
+      p[1] = (guint8) (x ^ (y * 5));
+      p[2] = (guint8) (255 - x - y);
+      p[3] = 0xff;
+    }
+  }
+}
+
+static inline void
+vspm_ref_fill_solid (GstVideoFrame * frame, guint8 b, guint8 g, guint8 r)
+{
+  gint x, y;
+
+  for (y = 0; y < GST_VIDEO_FRAME_HEIGHT (frame); y++) {
+    guint8 *p = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA (frame, 0) +
+        y * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+
+    for (x = 0; x < GST_VIDEO_FRAME_WIDTH (frame); x++, p += 4) {
+      p[0] = b;
+      p[1] = g;
+      p[2] = r;
+      p[3] = 0xff;
+    }
+  }
+}
+
+static inline const guint8 *
+vspm_ref_pixel (GstVideoFrame * frame, gint x, gint y)
+{
+  return (const guint8 *) GST_VIDEO_FRAME_PLANE_DATA (frame, 0) +
+      y * GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0) + x * 4;
+}
+
+/* One channel of the UDS as the emulation runs it: bilinear, the centre
+ * of an output pixel sampling the input at x * ratio + ratio / 2 - 2048,
+ * ratios being 4.12 fixed point input / output sizes */
+static inline guint8
+vspm_ref_uds (GstVideoFrame * in, gint in_x, gint in_y, gint in_w,
+    gint in_h, gint out_w, gint out_h, gint x, gint y, gint c)
+{
+  gint64 rx = ((gint64) in_w << 12) / out_w;
+  gint64 ry = ((gint64) in_h << 12) / out_h;
+  gint64 fx = x * rx + rx / 2 - 2048;
+  gint64 fy = y * ry + ry / 2 - 2048;
+  gint x0, x1, y0, y1, wx, wy, top, bottom;
+
+  fx = MAX (fx, 0);
+  fy = MAX (fy, 0);
+  x0 = fx >> 12;
+  wx = (fx & 4095) >> 4;
+  if (x0 >= in_w - 1) {
+    x0 = in_w - 1;
+    wx = 0;
+  }
+  y0 = fy >> 12;
+  wy = (fy & 4095) >> 4;
+  if (y0 >= in_h - 1) {
+    y0 = in_h - 1;
+    wy = 0;
+  }
+  x1 = x0 + (wx ? 1 : 0);
+  y1 = y0 + (wy ? 1 : 0);
+
+  top = vspm_ref_pixel (in, in_x + x0, in_y + y0)[c] * (256 - wx) +
+      vspm_ref_pixel (in, in_x + x1, in_y + y0)[c] * wx;
+  bottom = vspm_ref_pixel (in, in_x + x0, in_y + y1)[c] * (256 - wx) +
+      vspm_ref_pixel (in, in_x + x1, in_y + y1)[c] * wx;
+
+  return (top * (256 - wy) + bottom * wy + 32768) >> 16;
+}
+
+/* Check the colour channels of out against the UDS scaling the in_* area
+ * of in, as a single VSP job does */
+static inline void
+vspm_ref_check_scaled (GstVideoFrame * in, gint in_x, gint in_y, gint in_w,
+    gint in_h, GstVideoFrame * out)
+{
+  gint out_w = GST_VIDEO_FRAME_WIDTH (out);
+  gint out_h = GST_VIDEO_FRAME_HEIGHT (out);
+  gint x, y, c;
+
+  for (y = 0; y < out_h; y++) {
+    for (x = 0; x < out_w; x++) {
+      const guint8 *p = vspm_ref_pixel (out, x, y);
+
+      for (c = 0; c < 3; c++) {
+        guint8 expected = (in_w == out_w && in_h == out_h) ?
+            vspm_ref_pixel (in, in_x + x, in_y + y)[c] :
+            vspm_ref_uds (in, in_x, in_y, in_w, in_h, out_w, out_h, x, y, c);
+
+        fail_unless (p[c] == expected,
+            "pixel %d,%d channel %d is %u, not %u", x, y, c, p[c], expected);
+      }
+    }
+  }
+}
+
+static inline void
+vspm_ref_check_solid (GstVideoFrame * frame, gint x, gint y, gint w, gint h,
+    guint8 b, guint8 g, guint8 r)
+{
+  gint i, j;
+
+  for (j = y; j < y + h; j++) {
+    for (i = x; i < x + w; i++) {
+      const guint8 *p = vspm_ref_pixel (frame, i, j);
+
+      fail_unless (p[0] == b && p[1] == g && p[2] == r,
+          "pixel %d,%d is %02x%02x%02x, not %02x%02x%02x", i, j,
+          p[2], p[1], p[0], r, g, b);
+    }
+  }
+}
+
+#endif /* __VSPM_REF_H__ */